@@ -283,11 +283,10 @@ void verify_authority_accounts_exist(
    }
 }
 
-void initialize_account_object( account_object& acc, const account_name_type& name, const public_key_type& key,
-   const dynamic_global_property_object& props, bool mined, const account_name_type& recovery_account, uint32_t hardfork )
+void initialize_account_object( account_object& acc, const account_name_type& name,
+   const dynamic_global_property_object& props, bool mined, uint32_t hardfork )
 {
    acc.name = name;
-   acc.memo_key = key;
    acc.created = props.time;
    acc.voting_manabar.last_update_time = props.time.sec_since_epoch();
    acc.mined = mined;
@@ -296,18 +295,25 @@ void initialize_account_object( account_object& acc, const account_name_type& na
    {
       acc.voting_manabar.current_mana = BEARS_100_PERCENT;
    }
+}
+
+void initialize_account_metadata( account_metadata_object& meta, const account_name_type& name, const public_key_type& key,
+   const account_name_type& recovery_account, uint32_t hardfork )
+{
+   meta.account = name;
+   meta.memo_key = key;
 
    if( hardfork >= BEARS_HARDFORK_0_11 )
    {
       FC_TODO( "If after HF 20, there are no temp account creations, the HF check can be removed." )
       if( ( hardfork < BEARS_HARDFORK_0_20__1782 ) || ( recovery_account != BEARS_TEMP_ACCOUNT ) )
       {
-         acc.recovery_account = recovery_account;
+         meta.recovery_account = recovery_account;
       }
    }
    else
    {
-      acc.recovery_account = "bears";
+      meta.recovery_account = "bears";
    }
 }
 
@@ -370,9 +376,14 @@ void account_create_evaluator::do_apply( const account_create_operation& o )
 
    const auto& new_account = _db.create< account_object >( [&]( account_object& acc )
    {
-      initialize_account_object( acc, o.new_account_name, o.memo_key, props, false /*mined*/, o.creator, _db.get_hardfork() );
+      initialize_account_object( acc, o.new_account_name, props, false /*mined*/, _db.get_hardfork() );
+   });
+
+   _db.create< account_metadata_object >( [&]( account_metadata_object& meta )
+   {
+      initialize_account_metadata( meta, o.new_account_name, o.memo_key, o.creator, _db.get_hardfork() );
       #ifndef IS_LOW_MEM
-         from_string( acc.json_metadata, o.json_metadata );
+         from_string( meta.json_metadata, o.json_metadata );
       #endif
    });
 
@@ -464,11 +475,15 @@ void account_create_with_delegation_evaluator::do_apply( const account_create_wi
 
    const auto& new_account = _db.create< account_object >( [&]( account_object& acc )
    {
-      initialize_account_object( acc, o.new_account_name, o.memo_key, props, false /*mined*/, o.creator, _db.get_hardfork() );
+      initialize_account_object( acc, o.new_account_name, props, false /*mined*/, _db.get_hardfork() );
       acc.received_coining_shares = o.delegation;
+   });
 
+   _db.create< account_metadata_object >( [&]( account_metadata_object& meta )
+   {
+      initialize_account_metadata( meta, o.new_account_name, o.memo_key, o.creator, _db.get_hardfork() );
       #ifndef IS_LOW_MEM
-         from_string( acc.json_metadata, o.json_metadata );
+         from_string( meta.json_metadata, o.json_metadata );
       #endif
    });
 
@@ -536,16 +551,16 @@ void account_update_evaluator::do_apply( const account_update_operation& o )
    if( o.posting && ( _db.has_hardfork( BEARS_HARDFORK_0_15__465 ) ) )
       verify_authority_accounts_exist( _db, *o.posting, o.account, authority::posting );
 
-   _db.modify( account, [&]( account_object& acc )
+   _db.modify( _db.get< account_metadata_object, by_account >( o.account ), [&]( account_metadata_object& meta )
    {
       if( o.memo_key != public_key_type() )
-            acc.memo_key = o.memo_key;
+            meta.memo_key = o.memo_key;
 
-      acc.last_account_update = _db.head_block_time();
+      meta.last_account_update = _db.head_block_time();
 
       #ifndef IS_LOW_MEM
         if ( o.json_metadata.size() > 0 )
-            from_string( acc.json_metadata, o.json_metadata );
+            from_string( meta.json_metadata, o.json_metadata );
       #endif
    });
 
@@ -686,8 +701,7 @@ void comment_evaluator::do_apply( const comment_operation& o )
    if( _db.has_hardfork( BEARS_HARDFORK_0_5__55 ) )
       FC_ASSERT( o.title.size() + o.body.size() + o.json_metadata.size(), "Cannot update comment because nothing appears to be changing." );
 
-   const auto& by_permlink_idx = _db.get_index< comment_index >().indices().get< by_permlink >();
-   auto itr = by_permlink_idx.find( boost::make_tuple( o.author, o.permlink ) );
+   const comment_object* existing = _db.find_comment( o.author, o.permlink );
 
    const auto& auth = _db.get_account( o.author ); /// prove it exists
 
@@ -707,7 +721,7 @@ void comment_evaluator::do_apply( const comment_operation& o )
 
    auto now = _db.head_block_time();
 
-   if ( itr == by_permlink_idx.end() )
+   if ( existing == nullptr )
    {
       if( o.parent_author != BEARS_ROOT_POST_PARENT )
       {
@@ -810,17 +824,21 @@ void comment_evaluator::do_apply( const comment_operation& o )
       id = new_comment.id;
 
    #ifndef IS_LOW_MEM
-      _db.create< comment_content_object >( [&]( comment_content_object& con )
+      if( _db.get_comment_content_mode() != database::comment_content_disabled )
       {
-         con.comment = id;
-
-         from_string( con.title, o.title );
-         if( o.body.size() < 1024*1024*128 )
+         _db.create< comment_content_object >( [&]( comment_content_object& con )
          {
-            from_string( con.body, o.body );
-         }
-         from_string( con.json_metadata, o.json_metadata );
-      });
+            con.comment = id;
+
+            from_string( con.title, o.title );
+            if( o.body.size() < 1024*1024*128 )
+            {
+               from_string( con.body, o.body );
+            }
+            from_string( con.json_metadata, o.json_metadata );
+            con.last_write_block = _db.head_block_num() + 1;
+         });
+      }
    #endif
 
 
@@ -842,7 +860,7 @@ void comment_evaluator::do_apply( const comment_operation& o )
    }
    else // start edit case
    {
-      const auto& comment = *itr;
+      const auto& comment = *existing;
 
       if( !_db.has_hardfork( BEARS_HARDFORK_0_17__772 ) )
       {
@@ -869,32 +887,51 @@ void comment_evaluator::do_apply( const comment_operation& o )
          }
       });
    #ifndef IS_LOW_MEM
-      _db.modify( _db.get< comment_content_object, by_comment >( comment.id ), [&]( comment_content_object& con )
+      const auto* content = _db.find< comment_content_object, by_comment >( comment.id );
+      if( content != nullptr && _db.get_comment_content_mode() != database::comment_content_disabled )
       {
-         if( o.title.size() )         from_string( con.title, o.title );
-         if( o.json_metadata.size() )
-            from_string( con.json_metadata, o.json_metadata );
+         // Archived content is patched in shared memory and archived again once irreversible
+         optional< comment_content > archived;
+         if( content->is_archived() )
+            archived = _db.find_comment_content( comment.id );
 
-         if( o.body.size() ) {
-            try {
-            diff_match_patch<std::wstring> dmp;
-            auto patch = dmp.patch_fromText( utf8_to_wstring(o.body) );
-            if( patch.size() ) {
-               auto result = dmp.patch_apply( patch, utf8_to_wstring( to_string( con.body ) ) );
-               auto patched_body = wstring_to_utf8(result.first);
-               if( !fc::is_utf8( patched_body ) ) {
-                  idump(("invalid utf8")(patched_body));
-                  from_string( con.body, fc::prune_invalid_utf8(patched_body) );
-               } else { from_string( con.body, patched_body ); }
-            }
-            else { // replace
-               from_string( con.body, o.body );
+         _db.modify( *content, [&]( comment_content_object& con )
+         {
+            if( archived )
+            {
+               from_string( con.title, archived->title );
+               from_string( con.body, archived->body );
+               from_string( con.json_metadata, archived->json_metadata );
+               con.archive_pos = 0;
+               con.archive_size = 0;
             }
-            } catch ( ... ) {
-               from_string( con.body, o.body );
+            con.last_write_block = _db.head_block_num() + 1;
+
+            if( o.title.size() )         from_string( con.title, o.title );
+            if( o.json_metadata.size() )
+               from_string( con.json_metadata, o.json_metadata );
+
+            if( o.body.size() ) {
+               try {
+               diff_match_patch<std::wstring> dmp;
+               auto patch = dmp.patch_fromText( utf8_to_wstring(o.body) );
+               if( patch.size() ) {
+                  auto result = dmp.patch_apply( patch, utf8_to_wstring( to_string( con.body ) ) );
+                  auto patched_body = wstring_to_utf8(result.first);
+                  if( !fc::is_utf8( patched_body ) ) {
+                     idump(("invalid utf8")(patched_body));
+                     from_string( con.body, fc::prune_invalid_utf8(patched_body) );
+                  } else { from_string( con.body, patched_body ); }
+               }
+               else { // replace
+                  from_string( con.body, o.body );
+               }
+               } catch ( ... ) {
+                  from_string( con.body, o.body );
+               }
             }
-         }
-      });
+         });
+      }
    #endif
 
 
@@ -2111,7 +2148,12 @@ void pow_apply( database& db, Operation o )
    {
       db.create< account_object >( [&]( account_object& acc )
       {
-         initialize_account_object( acc, o.get_worker_account(), o.work.worker, dgp, true /*mined*/, account_name_type(), db.get_hardfork() );
+         initialize_account_object( acc, o.get_worker_account(), dgp, true /*mined*/, db.get_hardfork() );
+      });
+
+      db.create< account_metadata_object >( [&]( account_metadata_object& meta )
+      {
+         initialize_account_metadata( meta, o.get_worker_account(), o.work.worker, account_name_type(), db.get_hardfork() );
          // ^ empty recovery account parameter means highest voted witness at time of recovery
       });
 
@@ -2131,7 +2173,10 @@ void pow_apply( database& db, Operation o )
    FC_ASSERT( worker_auth.active.key_auths.begin()->first == o.work.worker, "Work must be performed by key that signed the work." );
    FC_ASSERT( o.block_id == db.head_block_id(), "pow not for last block" );
    if( db.has_hardfork( BEARS_HARDFORK_0_13__256 ) )
-      FC_ASSERT( worker_account.last_account_update < db.head_block_time(), "Worker account must not have updated their account this block." );
+   {
+      const auto& worker_meta = db.get< account_metadata_object, by_account >( o.get_worker_account() );
+      FC_ASSERT( worker_meta.last_account_update < db.head_block_time(), "Worker account must not have updated their account this block." );
+   }
 
    fc::sha256 target = db.get_pow_target();
 
@@ -2224,7 +2269,12 @@ void pow2_evaluator::do_apply( const pow2_operation& o )
       FC_ASSERT( o.new_owner_key.valid(), "New owner key is not valid." );
       db.create< account_object >( [&]( account_object& acc )
       {
-         initialize_account_object( acc, worker_account, *o.new_owner_key, dgp, true /*mined*/, account_name_type(), _db.get_hardfork() );
+         initialize_account_object( acc, worker_account, dgp, true /*mined*/, _db.get_hardfork() );
+      });
+
+      db.create< account_metadata_object >( [&]( account_metadata_object& meta )
+      {
+         initialize_account_metadata( meta, worker_account, *o.new_owner_key, account_name_type(), _db.get_hardfork() );
          // ^ empty recovery account parameter means highest voted witness at time of recovery
       });
 
@@ -2466,9 +2516,14 @@ void create_claimed_account_evaluator::do_apply( const create_claimed_account_op
 
    _db.create< account_object >( [&]( account_object& acc )
    {
-      initialize_account_object( acc, o.new_account_name, o.memo_key, props, false /*mined*/, o.creator, _db.get_hardfork() );
+      initialize_account_object( acc, o.new_account_name, props, false /*mined*/, _db.get_hardfork() );
+   });
+
+   _db.create< account_metadata_object >( [&]( account_metadata_object& meta )
+   {
+      initialize_account_metadata( meta, o.new_account_name, o.memo_key, o.creator, _db.get_hardfork() );
       #ifndef IS_LOW_MEM
-         from_string( acc.json_metadata, o.json_metadata );
+         from_string( meta.json_metadata, o.json_metadata );
       #endif
    });
 
@@ -2485,7 +2540,7 @@ void create_claimed_account_evaluator::do_apply( const create_claimed_account_op
 
 void request_account_recovery_evaluator::do_apply( const request_account_recovery_operation& o )
 {
-   const auto& account_to_recover = _db.get_account( o.account_to_recover );
+   const auto& account_to_recover = _db.get< account_metadata_object, by_account >( o.account_to_recover );
 
    if ( account_to_recover.recovery_account.length() )   // Make sure recovery matches expected recovery account
    {
@@ -2553,9 +2608,10 @@ void request_account_recovery_evaluator::do_apply( const request_account_recover
 void recover_account_evaluator::do_apply( const recover_account_operation& o )
 {
    const auto& account = _db.get_account( o.account_to_recover );
+   const auto& account_meta = _db.get< account_metadata_object, by_account >( o.account_to_recover );
 
    if( _db.has_hardfork( BEARS_HARDFORK_0_12 ) )
-      FC_ASSERT( _db.head_block_time() - account.last_account_recovery > BEARS_OWNER_UPDATE_LIMIT, "Owner authority can only be updated once an hour." );
+      FC_ASSERT( _db.head_block_time() - account_meta.last_account_recovery > BEARS_OWNER_UPDATE_LIMIT, "Owner authority can only be updated once an hour." );
 
    const auto& recovery_request_idx = _db.get_index< account_recovery_request_index >().indices().get< by_account >();
    auto request = recovery_request_idx.find( o.account_to_recover );
@@ -2578,16 +2634,16 @@ void recover_account_evaluator::do_apply( const recover_account_operation& o )
 
    _db.remove( *request ); // Remove first, update_owner_authority may invalidate iterator
    _db.update_owner_authority( account, o.new_owner_authority );
-   _db.modify( account, [&]( account_object& a )
+   _db.modify( account_meta, [&]( account_metadata_object& meta )
    {
-      a.last_account_recovery = _db.head_block_time();
+      meta.last_account_recovery = _db.head_block_time();
    });
 }
 
 void change_recovery_account_evaluator::do_apply( const change_recovery_account_operation& o )
 {
    _db.get_account( o.new_recovery_account ); // Simply validate account exists
-   const auto& account_to_recover = _db.get_account( o.account_to_recover );
+   const auto& account_to_recover = _db.get< account_metadata_object, by_account >( o.account_to_recover );
 
    const auto& change_recovery_idx = _db.get_index< change_recovery_account_request_index >().indices().get< by_account >();
    auto request = change_recovery_idx.find( o.account_to_recover );
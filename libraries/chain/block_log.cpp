@@ -287,6 +287,131 @@ namespace bears { namespace chain {
       FC_LOG_AND_RETHROW()
    }
 
+   optional< signed_block_view > block_log::read_block_view_by_num( uint32_t block_num )const
+   {
+      try
+      {
+         scoped_lock lock( my->mtx, defer_lock );
+
+         if( my->use_locking )
+         {
+            lock.lock();;
+         }
+
+         optional< signed_block_view > b;
+         uint64_t pos = get_block_pos_helper( block_num );
+         if( pos != npos )
+         {
+            b = signed_block_view( read_raw_block_helper( block_num, pos ) );
+            FC_ASSERT( b->block_num() == block_num , "Wrong block was read from block log.", ( "returned", b->block_num() )( "expected", block_num ));
+         }
+         return b;
+      }
+      FC_LOG_AND_RETHROW()
+   }
+
+   std::vector< char > block_log::read_raw_block_helper( uint32_t block_num, uint64_t pos )const
+   {
+      try
+      {
+         // Every block is followed by its 8 byte position, so the block ends 8 bytes before the
+         // next block starts. The head block ends 8 bytes before the end of the file.
+         uint64_t end_pos;
+         if( block_num < protocol::block_header::num_from_id( my->head_id ) )
+         {
+            end_pos = get_block_pos_helper( block_num + 1 ) - sizeof( uint64_t );
+            my->check_block_read();
+         }
+         else
+         {
+            my->check_block_read();
+            my->block_stream.seekg( 0, std::ios::end );
+            end_pos = uint64_t( my->block_stream.tellg() ) - sizeof( uint64_t );
+         }
+
+         FC_ASSERT( end_pos > pos, "Invalid block position in block log.", ("pos", pos)("end_pos", end_pos) );
+
+         std::vector< char > data( end_pos - pos );
+         my->block_stream.seekg( pos );
+         my->block_stream.read( data.data(), data.size() );
+         return data;
+      }
+      FC_LOG_AND_RETHROW()
+   }
+
+   uint32_t block_log::read_raw_blocks( uint32_t first_block_num, uint64_t max_bytes,
+                                        std::vector< char >& data, uint64_t& first_block_pos )const
+   {
+      try
+      {
+         scoped_lock lock( my->mtx, defer_lock );
+
+         if( my->use_locking )
+         {
+            lock.lock();;
+         }
+
+         data.clear();
+         first_block_pos = get_block_pos_helper( first_block_num );
+         if( first_block_pos == npos )
+            return 0;
+
+         // Every block ends where the next one starts, the head block ends at the end of the file
+         uint32_t head_num = protocol::block_header::num_from_id( my->head_id );
+         uint64_t end_pos = first_block_pos;
+         uint32_t count = 0;
+         while( first_block_num + count <= head_num )
+         {
+            uint64_t next_pos;
+            if( first_block_num + count < head_num )
+            {
+               next_pos = get_block_pos_helper( first_block_num + count + 1 );
+            }
+            else
+            {
+               my->check_block_read();
+               my->block_stream.seekg( 0, std::ios::end );
+               next_pos = uint64_t( my->block_stream.tellg() );
+            }
+
+            if( count && next_pos - first_block_pos > max_bytes )
+               break;
+            end_pos = next_pos;
+            ++count;
+         }
+
+         FC_ASSERT( end_pos > first_block_pos, "Invalid block position in block log.", ("pos", first_block_pos)("end_pos", end_pos) );
+
+         my->check_block_read();
+         data.resize( end_pos - first_block_pos );
+         my->block_stream.seekg( first_block_pos );
+         my->block_stream.read( data.data(), data.size() );
+         return count;
+      }
+      FC_LOG_AND_RETHROW()
+   }
+
+   std::vector< signed_block > block_log::unpack_raw_blocks( const std::vector< char >& data, uint64_t first_block_pos )
+   {
+      try
+      {
+         std::vector< signed_block > blocks;
+         fc::datastream< const char* > ds( data.data(), data.size() );
+         while( ds.remaining() )
+         {
+            uint64_t expected_pos = first_block_pos + ds.tellp();
+            blocks.emplace_back();
+            fc::raw::unpack( ds, blocks.back() );
+            uint64_t pos;
+            fc::raw::unpack( ds, pos );
+            FC_ASSERT( pos == expected_pos, "Block is followed by the wrong position.",
+               ("block_num", blocks.back().block_num())("pos", pos)("expected", expected_pos) );
+         }
+         return blocks;
+      }
+      FC_CAPTURE_AND_RETHROW( (first_block_pos) )
+   }
+
    uint64_t block_log::get_block_pos( uint32_t block_num ) const
    {
       scoped_lock lock( my->mtx, defer_lock );
@@ -0,0 +1,133 @@
+#include <bears/chain/comment_content_store.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/raw.hpp>
+
+#include <fstream>
+#include <mutex>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define STORE_READ  (std::ios::in | std::ios::binary)
+#define STORE_WRITE (std::ios::out | std::ios::binary | std::ios::app)
+
+namespace bears { namespace chain {
+
+   namespace detail {
+      class comment_content_store_impl {
+         public:
+            fc::path          file;
+            std::ofstream     write_stream;
+            std::ifstream     read_stream;
+            uint64_t          end_pos = 0;
+
+            mutable std::mutex mtx;
+      };
+   }
+
+   comment_content_store::comment_content_store()
+   :my( new detail::comment_content_store_impl() )
+   {
+      my->write_stream.exceptions( std::fstream::failbit | std::fstream::badbit );
+      my->read_stream.exceptions( std::fstream::failbit | std::fstream::badbit );
+   }
+
+   comment_content_store::~comment_content_store()
+   {
+      if( is_open() )
+         flush();
+   }
+
+   void comment_content_store::open( const fc::path& file )
+   { try {
+      close();
+
+      std::lock_guard< std::mutex > lock( my->mtx );
+      my->file = file;
+      my->write_stream.open( file.generic_string().c_str(), STORE_WRITE );
+      my->read_stream.open( file.generic_string().c_str(), STORE_READ );
+      my->end_pos = fc::file_size( file );
+   } FC_CAPTURE_AND_RETHROW( (file) ) }
+
+   void comment_content_store::close()
+   {
+      if( is_open() )
+         flush();
+
+      std::lock_guard< std::mutex > lock( my->mtx );
+      if( my->write_stream.is_open() )
+         my->write_stream.close();
+      if( my->read_stream.is_open() )
+         my->read_stream.close();
+      my->end_pos = 0;
+   }
+
+   bool comment_content_store::is_open()const
+   {
+      return my->write_stream.is_open();
+   }
+
+   uint64_t comment_content_store::append( const comment_content& content, uint32_t& size )
+   { try {
+      auto data = fc::raw::pack_to_vector( content );
+
+      std::lock_guard< std::mutex > lock( my->mtx );
+      FC_ASSERT( my->write_stream.is_open(), "Comment content store is not open" );
+
+      uint64_t pos = my->end_pos;
+      my->write_stream.write( data.data(), data.size() );
+      // Archived content can be read back right away, hand it to the OS before returning
+      my->write_stream.flush();
+      my->end_pos += data.size();
+
+      size = data.size();
+      return pos;
+   } FC_LOG_AND_RETHROW() }
+
+   comment_content comment_content_store::read( uint64_t pos, uint32_t size )const
+   { try {
+      std::vector< char > data( size );
+
+      {
+         std::lock_guard< std::mutex > lock( my->mtx );
+         FC_ASSERT( my->read_stream.is_open(), "Comment content store is not open" );
+         FC_ASSERT( pos + size <= my->end_pos, "Comment content record is past the end of the store",
+            ("pos", pos)("size", size)("end", my->end_pos) );
+
+         my->read_stream.clear();
+         my->read_stream.seekg( pos );
+         my->read_stream.read( data.data(), size );
+      }
+
+      return fc::raw::unpack_from_vector< comment_content >( data );
+   } FC_CAPTURE_AND_RETHROW( (pos)(size) ) }
+
+   void comment_content_store::flush()
+   {
+      std::lock_guard< std::mutex > lock( my->mtx );
+      if( my->write_stream.is_open() )
+         my->write_stream.flush();
+   }
+
+   void comment_content_store::sync()
+   {
+      flush();
+
+#ifndef WIN32
+      std::lock_guard< std::mutex > lock( my->mtx );
+      if( !my->write_stream.is_open() )
+         return;
+
+      // The stream does not expose its descriptor, syncing any descriptor of the file writes it back
+      int fd = ::open( my->file.generic_string().c_str(), O_RDONLY );
+      FC_ASSERT( fd >= 0, "Could not open comment content store to sync it", ("file", my->file) );
+      int result = fsync( fd );
+      ::close( fd );
+      FC_ASSERT( result == 0, "Could not sync comment content store", ("file", my->file) );
+#endif
+   }
+
+} } // bears::chain
@@ -1,4 +1,5 @@
 #include <bears/protocol/bears_operations.hpp>
+#include <bears/protocol/signature_cache.hpp>
 
 #include <bears/chain/block_summary_object.hpp>
 #include <bears/chain/compound.hpp>
@@ -99,12 +100,27 @@ database::~database()
    clear_pending();
 }
 
+/// Blocks replayed from the block log were fully validated when they were first applied
+static const uint32_t replay_skip_flags =
+   database::skip_witness_signature |
+   database::skip_transaction_signatures |
+   database::skip_transaction_dupe_check |
+   database::skip_tapos_check |
+   database::skip_merkle_check |
+   database::skip_witness_schedule_check |
+   database::skip_authority_check |
+   database::skip_validate | /// no need to validate operations
+   database::skip_validate_invariants |
+   database::skip_block_log;
+
 void database::open( const open_args& args )
 {
    try
    {
       init_schema();
       chainbase::database::open( args.shared_mem_dir, args.chainbase_flags, args.shared_file_size );
+      if( opened_after_crash() )
+         wlog( "Shared memory file was not closed by the last run, continuing from the state it left" );
 
       initialize_indexes();
       initialize_evaluators();
@@ -119,6 +135,12 @@ void database::open( const open_args& args )
 
       _block_log.open( args.data_dir / "block_log" );
 
+      _slim_transaction_index = args.slim_transaction_index;
+      _comment_content_mode = args.comment_content;
+      _archived_comment_content.clear();
+      if( _comment_content_mode == comment_content_archived )
+         _comment_content_store.open( args.shared_mem_dir / "comment_content" );
+
       auto log_head = _block_log.head();
 
       // Rewind all undo state. This should return us to the state at the last irreversible block.
@@ -127,6 +149,15 @@ void database::open( const open_args& args )
          undo_all();
          FC_ASSERT( revision() == head_block_num(), "Chainbase revision does not match head block num",
             ("rev", revision())("head_block", head_block_num()) );
+
+         // Content kept in or moved out of the state under one mode is not where another mode looks for it
+         const auto* content_store = find< comment_content_store_object >();
+         if( content_store == nullptr )
+            create< comment_content_store_object >( [&]( comment_content_store_object& s ) { s.mode = _comment_content_mode; } );
+         else
+            FC_ASSERT( content_store->mode == _comment_content_mode,
+               "The state was built with another comment-content-store setting. Please reindex blockchain.",
+               ("state_mode", uint32_t( content_store->mode ))("mode", uint32_t( _comment_content_mode )) );
          if (args.do_validate_invariants)
             validate_invariants();
       });
@@ -145,6 +176,10 @@ void database::open( const open_args& args )
          init_hardforks(); // Writes to local state, but reads from db
       });
 
+      // A state restored from a checkpoint is behind the block log
+      if( head_block_num() && log_head && log_head->block_num() > head_block_num() )
+         replay_block_log_tail();
+
       if (args.benchmark.first)
       {
          args.benchmark.second(0, get_abstract_index_cntr());
@@ -192,18 +227,6 @@ uint32_t database::reindex( const open_args& args )
 
       ilog( "Replaying blocks..." );
 
-      uint64_t skip_flags =
-         skip_witness_signature |
-         skip_transaction_signatures |
-         skip_transaction_dupe_check |
-         skip_tapos_check |
-         skip_merkle_check |
-         skip_witness_schedule_check |
-         skip_authority_check |
-         skip_validate | /// no need to validate operations
-         skip_validate_invariants |
-         skip_block_log;
-
       with_write_lock( [&]()
       {
          _block_log.set_locking( false );
@@ -222,14 +245,18 @@ uint32_t database::reindex( const open_args& args )
             if( cur_block_num % 100000 == 0 )
                std::cerr << "   " << double( cur_block_num * 100 ) / last_block_num << "%   " << cur_block_num << " of " << last_block_num <<
                "   (" << (get_free_memory() / (1024*1024)) << "M free)\n";
-            apply_block( itr.first, skip_flags );
+            itr.first.memoize( get_chain_id() );
+            apply_block( itr.first, replay_skip_flags );
+            check_free_memory( false, cur_block_num );
+            archive_comment_content();
 
             if( (args.benchmark.first > 0) && (cur_block_num % args.benchmark.first == 0) )
                args.benchmark.second( cur_block_num, get_abstract_index_cntr() );
             itr = _block_log.read_block( itr.second );
          }
 
-         apply_block( itr.first, skip_flags );
+         itr.first.memoize( get_chain_id() );
+         apply_block( itr.first, replay_skip_flags );
          note.last_block_number = itr.first.block_num();
 
          if( (args.benchmark.first > 0) && (note.last_block_number % args.benchmark.first == 0) )
@@ -256,6 +283,7 @@ void database::wipe( const fc::path& data_dir, const fc::path& shared_mem_dir, b
 {
    close();
    chainbase::database::wipe( shared_mem_dir );
+   fc::remove_all( shared_mem_dir / "comment_content" );
    if( include_blocks )
    {
       fc::remove_all( data_dir / "block_log" );
@@ -272,10 +300,12 @@ void database::close(bool rewind)
       // DB state (issue #336).
       clear_pending();
 
+      _comment_content_store.flush();
       chainbase::database::flush();
       chainbase::database::close();
 
       _block_log.close();
+      _comment_content_store.close();
 
       _fork_db.reset();
    }
@@ -316,7 +346,7 @@ block_id_type database::find_block_id_for_num( uint32_t block_num )const
       }
 
       // Next we query the block log.   Irreversible blocks are here.
-      auto b = _block_log.read_block_by_num( block_num );
+      auto b = _block_log.read_block_view_by_num( block_num );
       if( b.valid() )
          return b->id();
 
@@ -368,15 +398,80 @@ optional<signed_block> database::fetch_block_by_number( uint32_t block_num )cons
    return b;
 } FC_LOG_AND_RETHROW() }
 
+/**
+ * Irreversible blocks are viewed directly over the packed bytes in the block log, reversible
+ * blocks are packed from the fork database. Either way transactions are not unpacked.
+ */
+optional<signed_block_view> database::fetch_block_view_by_id( const block_id_type& id )const
+{ try {
+   optional< signed_block_view > result;
+   auto b = _fork_db.fetch_block( id );
+   if( b )
+   {
+      result = signed_block_view( fc::raw::pack_to_vector( b->data ) );
+      return result;
+   }
+
+   result = _block_log.read_block_view_by_num( protocol::block_header::num_from_id( id ) );
+   if( result && result->id() != id )
+      result.reset();
+
+   return result;
+} FC_CAPTURE_AND_RETHROW() }
+
+optional<signed_block_header> database::fetch_block_header_by_number( uint32_t block_num )const
+{ try {
+   optional< signed_block_header > h;
+   shared_ptr< fork_item > fitem = _fork_db.fetch_block_on_main_branch_by_number( block_num );
+
+   if( fitem )
+   {
+      h = fitem->data;
+   }
+   else
+   {
+      auto b = _block_log.read_block_view_by_num( block_num );
+      if( b )
+         h = b->header();
+   }
+
+   return h;
+} FC_LOG_AND_RETHROW() }
+
 const signed_transaction database::get_recent_transaction( const transaction_id_type& trx_id ) const
 { try {
    auto& index = get_index<transaction_index>().indices().get<by_trx_id>();
    auto itr = index.find(trx_id);
    FC_ASSERT(itr != index.end());
    signed_transaction trx;
-   fc::raw::unpack_from_buffer( itr->packed_trx, trx );
-   return trx;;
-} FC_CAPTURE_AND_RETHROW() }
+   if( itr->packed_trx.size() )
+   {
+      fc::raw::unpack_from_buffer( itr->packed_trx, trx );
+      return trx;
+   }
+
+   // Slim transaction index, the transaction is either still pending or in the block it was applied in
+   if( itr->block_num > head_block_num() )
+   {
+      for( const auto& pending : _pending_tx )
+      {
+         if( pending.id() == trx_id )
+            return pending;
+      }
+      FC_ASSERT( false, "Pending transaction not found" );
+   }
+
+   // Only the ids are hashed from the packed block, the transaction itself is the only one unpacked
+   auto block = fetch_block_view_by_id( get_block_id_for_num( itr->block_num ) );
+   FC_ASSERT( block.valid(), "Block ${n} of the transaction is not available", ("n", itr->block_num) );
+
+   for( uint32_t i = 0; i < block->transaction_count(); ++i )
+   {
+      if( block->transaction_id( i ) == trx_id )
+         return block->transaction( i );
+   }
+   FC_ASSERT( false, "Transaction not found in block ${n}", ("n", itr->block_num) );
+} FC_CAPTURE_AND_RETHROW( (trx_id) ) }
 
 std::vector< block_id_type > database::get_block_ids_on_fork( block_id_type head_of_fork ) const
 { try {
@@ -419,6 +514,7 @@ void database::foreach_block(std::function<bool(const signed_block_header&, cons
    while( itr.first.block_num() != last_block_num )
    {
       const signed_block& b = itr.first;
+      b.memoize( get_chain_id() );
       if(processor(previousBlockHeader, b) == false)
          return;
 
@@ -426,6 +522,7 @@ void database::foreach_block(std::function<bool(const signed_block_header&, cons
       itr = _block_log.read_block( itr.second );
    }
 
+   itr.first.memoize( get_chain_id() );
    processor(previousBlockHeader, itr.first);
 }
 
@@ -487,28 +584,65 @@ const account_object* database::find_account( const account_name_type& name )con
    return find< account_object, by_name >( name );
 }
 
+/**
+ * Comments are looked up by the hash of their author and permlink. Only on a hash collision more
+ * than one permlink is compared, by_permlink is left for range queries.
+ */
+template< typename PermlinkType >
+static const comment_object* find_comment_by_hash( const database& db, const account_name_type& author, const PermlinkType& permlink )
+{
+   const auto& hash_idx = db.get_index< comment_index, by_permlink_hash >();
+   auto range = hash_idx.equal_range( comment_permlink_hash( author, permlink.c_str() ) );
+   for( ; range.first != range.second; ++range.first )
+   {
+      if( range.first->author == author && std::strcmp( range.first->permlink.c_str(), permlink.c_str() ) == 0 )
+         return &*range.first;
+   }
+   return nullptr;
+}
+
 const comment_object& database::get_comment( const account_name_type& author, const shared_string& permlink )const
 { try {
-   return get< comment_object, by_permlink >( boost::make_tuple( author, permlink ) );
+   const comment_object* comment = find_comment_by_hash( *this, author, permlink );
+   FC_ASSERT( comment != nullptr, "Comment does not exist" );
+   return *comment;
 } FC_CAPTURE_AND_RETHROW( (author)(permlink) ) }
 
 const comment_object* database::find_comment( const account_name_type& author, const shared_string& permlink )const
 {
-   return find< comment_object, by_permlink >( boost::make_tuple( author, permlink ) );
+   return find_comment_by_hash( *this, author, permlink );
 }
 
 #ifndef ENABLE_STD_ALLOCATOR
       const comment_object& database::get_comment( const account_name_type& author, const string& permlink )const
       { try {
-      return get< comment_object, by_permlink >( boost::make_tuple( author, permlink) );
+      const comment_object* comment = find_comment_by_hash( *this, author, permlink );
+      FC_ASSERT( comment != nullptr, "Comment does not exist" );
+      return *comment;
       } FC_CAPTURE_AND_RETHROW( (author)(permlink) ) }
 
       const comment_object* database::find_comment( const account_name_type& author, const string& permlink )const
       {
-      return find< comment_object, by_permlink >( boost::make_tuple( author, permlink ) );
+      return find_comment_by_hash( *this, author, permlink );
       }
 #endif
 
+optional< comment_content > database::find_comment_content( const comment_id_type& comment )const
+{ try {
+   const auto* con = find< comment_content_object, by_comment >( comment );
+   if( con == nullptr )
+      return optional< comment_content >();
+
+   if( con->is_archived() )
+      return _comment_content_store.read( con->archive_pos, con->archive_size );
+
+   comment_content result;
+   result.title = to_string( con->title );
+   result.body = to_string( con->body );
+   result.json_metadata = to_string( con->json_metadata );
+   return result;
+} FC_CAPTURE_AND_RETHROW( (comment) ) }
+
 const escrow_object& database::get_escrow( const account_name_type& name, uint32_t escrow_id )const
 { try {
    return get< escrow_object, by_from_id >( boost::make_tuple( name, escrow_id ) );
@@ -796,7 +930,7 @@ void database::push_transaction( const signed_transaction& trx, uint32_t skip )
    {
       try
       {
-         FC_ASSERT( fc::raw::pack_size(trx) <= (get_dynamic_global_properties().maximum_block_size - 256) );
+         FC_ASSERT( trx.packed_size() <= (get_dynamic_global_properties().maximum_block_size - 256) );
          set_producing( true );
          set_pending_tx( true );
          detail::with_skip_flags( *this, skip,
@@ -829,9 +963,14 @@ void database::_push_transaction( const signed_transaction& trx )
    // _apply_transaction fails.  If we make it to merge(), we
    // apply the changes.
 
+   // The pending copy is owned by the database and never edited, so memoize its encoding.
+   // Re-applying pending transactions and generating blocks then reuse its id and digests.
+   signed_transaction pending_trx( trx );
+   pending_trx.memoize( get_chain_id() );
+
    auto temp_session = start_undo_session();
-   _apply_transaction( trx );
-   _pending_tx.push_back( trx );
+   _apply_transaction( pending_trx );
+   _pending_tx.push_back( std::move( pending_trx ) );
 
    notify_changed_objects();
    // The transaction applied successfully. Merge its changes into the pending block session.
@@ -942,7 +1081,7 @@ signed_block database::_generate_block(
       if( tx.expiration < when )
          continue;
 
-      uint64_t new_total_size = total_block_size + fc::raw::pack_size( tx );
+      uint64_t new_total_size = total_block_size + tx.packed_size();
 
       // postpone transaction if it would make block too big
       if( new_total_size >= maximum_block_size )
@@ -957,7 +1096,7 @@ signed_block database::_generate_block(
          _apply_transaction( tx );
          temp_session.squash();
 
-         total_block_size += fc::raw::pack_size( tx );
+         total_block_size += tx.packed_size();
          pending_block.transactions.push_back( tx );
       }
       catch ( const fc::exception& e )
@@ -2559,7 +2698,7 @@ void database::account_recovery_processing()
 
    while( change_req != change_req_idx.end() && change_req->effective_on <= head_block_time() )
    {
-      modify( get_account( change_req->account_to_recover ), [&]( account_object& a )
+      modify( get< account_metadata_object, by_account >( change_req->account_to_recover ), [&]( account_metadata_object& a )
       {
          a.recovery_account = change_req->recovery_account;
       });
@@ -2721,6 +2860,7 @@ void database::initialize_indexes()
 {
    add_core_index< dynamic_global_property_index           >(*this);
    add_core_index< account_index                           >(*this);
+   add_core_index< account_metadata_index                  >(*this);
    add_core_index< account_authority_index                 >(*this);
    add_core_index< witness_index                           >(*this);
    add_core_index< transaction_index                       >(*this);
@@ -2728,6 +2868,7 @@ void database::initialize_indexes()
    add_core_index< witness_schedule_index                  >(*this);
    add_core_index< comment_index                           >(*this);
    add_core_index< comment_content_index                   >(*this);
+   add_core_index< comment_content_store_index             >(*this);
    add_core_index< comment_vote_index                      >(*this);
    add_core_index< witness_vote_index                      >(*this);
    add_core_index< limit_order_index                       >(*this);
@@ -2847,6 +2988,10 @@ void database::init_genesis( uint64_t init_supply )
       {
          a.name = BEARS_MINER_ACCOUNT;
       } );
+      create< account_metadata_object >( [&]( account_metadata_object& meta )
+      {
+         meta.account = BEARS_MINER_ACCOUNT;
+      });
       create< account_authority_object >( [&]( account_authority_object& auth )
       {
          auth.account = BEARS_MINER_ACCOUNT;
@@ -2858,6 +3003,10 @@ void database::init_genesis( uint64_t init_supply )
       {
          a.name = BEARS_NULL_ACCOUNT;
       } );
+      create< account_metadata_object >( [&]( account_metadata_object& meta )
+      {
+         meta.account = BEARS_NULL_ACCOUNT;
+      });
       create< account_authority_object >( [&]( account_authority_object& auth )
       {
          auth.account = BEARS_NULL_ACCOUNT;
@@ -2869,6 +3018,10 @@ void database::init_genesis( uint64_t init_supply )
       {
          a.name = BEARS_TEMP_ACCOUNT;
       } );
+      create< account_metadata_object >( [&]( account_metadata_object& meta )
+      {
+         meta.account = BEARS_TEMP_ACCOUNT;
+      });
       create< account_authority_object >( [&]( account_authority_object& auth )
       {
          auth.account = BEARS_TEMP_ACCOUNT;
@@ -2881,11 +3034,16 @@ void database::init_genesis( uint64_t init_supply )
          create< account_object >( [&]( account_object& a )
          {
             a.name = BEARS_INIT_MINER_NAME + ( i ? fc::to_string( i ) : std::string() );
-            a.memo_key = init_public_key;
             a.balance  = asset( i ? 0 : BEARS_INIT_SUPPLY, BEARS_SYMBOL );
             a.bsd_balance = asset( i ? 0 : BEARS_INIT_SUPPLY, BSD_SYMBOL );
          } );
 
+         create< account_metadata_object >( [&]( account_metadata_object& meta )
+         {
+            meta.account = BEARS_INIT_MINER_NAME + ( i ? fc::to_string( i ) : std::string() );
+            meta.memo_key = init_public_key;
+         });
+
          create< account_authority_object >( [&]( account_authority_object& auth )
          {
             auth.account = BEARS_INIT_MINER_NAME + ( i ? fc::to_string( i ) : std::string() );
@@ -3003,6 +3161,12 @@ void database::set_flush_interval( uint32_t flush_blocks )
    _next_flush_block = 0;
 }
 
+void database::set_checkpoint_interval( uint32_t checkpoint_blocks, const fc::path& checkpoint_dir )
+{
+   _checkpoint_blocks = checkpoint_blocks;
+   _checkpoint_dir = checkpoint_dir;
+}
+
 //////////////////// private methods ////////////////////
 
 void database::apply_block( const signed_block& next_block, uint32_t skip )
@@ -3026,7 +3190,8 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
 
    //fc::time_point end_time = fc::time_point::now();
    //fc::microseconds dt = end_time - begin_time;
-   if( _flush_blocks != 0 )
+   // The background flush writes the file back continuously, a periodic flush would only stall
+   if( _flush_blocks != 0 && background_flush_rate() == 0 )
    {
       if( _next_flush_block == 0 )
       {
@@ -3049,12 +3214,112 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
       {
          _next_flush_block = 0;
          //ilog( "Flushing database shared memory at block ${b}", ("b", block_num) );
+         _comment_content_store.flush();
          chainbase::database::flush();
       }
    }
 
+   // The revision only follows the head block while blocks are applied in undo sessions, not on replay
+   if( _checkpoint_blocks != 0 && block_num % _checkpoint_blocks == 0 && revision() == int64_t( block_num ) )
+      _checkpoint_due = true;
+
 } FC_CAPTURE_AND_RETHROW( (next_block) ) }
 
+void database::replay_block_log_tail()
+{ try {
+   auto last_block_num = _block_log.head()->block_num();
+   ilog( "Replaying blocks ${b} to ${e} from the block log", ("b", head_block_num() + 1)("e", last_block_num) );
+
+   _fork_db.reset();
+   with_write_lock( [&]()
+   {
+      _block_log.set_locking( false );
+      auto itr = _block_log.read_block( _block_log.get_block_pos( head_block_num() + 1 ) );
+      while( true )
+      {
+         itr.first.memoize( get_chain_id() );
+         apply_block( itr.first, replay_skip_flags );
+         if( itr.first.block_num() == last_block_num )
+            break;
+         itr = _block_log.read_block( itr.second );
+      }
+      set_revision( head_block_num() );
+      _block_log.set_locking( true );
+   });
+   _fork_db.start_block( *_block_log.head() );
+} FC_CAPTURE_AND_RETHROW() }
+
+uint32_t database::read_raw_block_log( uint32_t first_block_num, uint64_t max_bytes,
+                                      std::vector< char >& data, uint64_t& first_block_pos )const
+{
+   return _block_log.read_raw_blocks( first_block_num, max_bytes, data, first_block_pos );
+}
+
+uint32_t database::import_irreversible_blocks( const std::vector< signed_block >& blocks )
+{ try {
+   if( blocks.empty() )
+      return head_block_num();
+
+   uint32_t log_head_num = _block_log.head() ? _block_log.head()->block_num() : 0;
+   FC_ASSERT( head_block_num() == log_head_num, "Blocks can only be imported while every applied block is in the block log",
+      ("head", head_block_num())("block_log_head", log_head_num) );
+
+   block_id_type previous = head_block_id();
+   for( const auto& b : blocks )
+   {
+      FC_ASSERT( b.previous == previous, "Imported block does not link to the block before it",
+         ("block_num", b.block_num())("previous", b.previous)("expected", previous) );
+      previous = b.id();
+   }
+
+   // The witness signature and merkle root tie the contents of each block to a scheduled witness
+   const uint32_t skip = replay_skip_flags & ~( skip_witness_signature | skip_merkle_check | skip_witness_schedule_check );
+
+   clear_pending();
+   _fork_db.reset();
+
+   for( const auto& b : blocks )
+   {
+      b.memoize( get_chain_id() );
+
+      auto session = start_undo_session();
+      apply_block( b, skip );
+      session.push();
+
+      _block_log.append( b );
+   }
+   _block_log.flush();
+
+   // Every imported block is irreversible, none of them can be undone
+   commit( head_block_num() );
+   _fork_db.start_block( blocks.back() );
+
+   return head_block_num();
+} FC_CAPTURE_AND_RETHROW( (blocks.size()) ) }
+
+void database::create_due_checkpoint()
+{
+   if( !_checkpoint_due )
+      return;
+
+   // Later writes under the same lock may have moved the head past the block that was due
+   _checkpoint_due = false;
+   create_checkpoint( head_block_num() );
+}
+
+void database::create_checkpoint( uint32_t block_num )
+{ try {
+   auto start = fc::time_point::now();
+
+   // Archived comment content the checkpoint refers to has to be on disk before it
+   if( _comment_content_store.is_open() )
+      _comment_content_store.sync();
+   chainbase::database::checkpoint( _checkpoint_dir );
+
+   ilog( "Checkpointed shared memory at block ${b} in ${t} ms",
+      ("b", block_num)("t", ( fc::time_point::now() - start ).count() / 1000) );
+} FC_CAPTURE_AND_LOG( (block_num)(_checkpoint_dir) ) }
+
 void database::check_free_memory( bool force_print, uint32_t current_block_num )
 {
    uint64_t free_mem = get_free_memory();
@@ -3066,7 +3331,12 @@ void database::check_free_memory( bool force_print, uint32_t current_block_num )
 
       wlog( "Memory is almost full, increasing to ${mem}M", ("mem", new_max / (1024*1024)) );
 
-      resize( new_max );
+      // Growing in place keeps every object where it is, remapping the file is the last resort
+      if( !grow( new_max ) )
+      {
+         wlog( "Shared memory file cannot grow in place, remapping it" );
+         resize( new_max );
+      }
 
       uint32_t free_mb = uint32_t( get_free_memory() / (1024*1024) );
       wlog( "Free memory is now ${free}M", ("free", free_mb) );
@@ -3204,6 +3474,10 @@ void database::_apply_block( const signed_block& next_block )
       );
    }
 
+   // Recover the keys of all signatures in the block at once, so the transactions below find them cached
+   if( !( skip & ( skip_transaction_signatures | skip_authority_check ) ) )
+      signature_cache::instance().prefetch( next_block.transactions, get_chain_id() );
+
    for( const auto& trx : next_block.transactions )
    {
       /* We do not need to push the undo state for each transaction
@@ -3224,6 +3498,7 @@ void database::_apply_block( const signed_block& next_block )
    update_signing_witness(signing_witness, next_block);
 
    update_last_irreversible_block();
+   update_archived_comment_content();
 
    create_block_summary(next_block);
    clear_expired_transactions();
@@ -3472,7 +3747,18 @@ void database::_apply_transaction(const signed_transaction& trx)
       create<transaction_object>([&](transaction_object& transaction) {
          transaction.trx_id = trx_id;
          transaction.expiration = trx.expiration;
-         fc::raw::pack_to_buffer( transaction.packed_trx, trx );
+         transaction.block_num = head_block_num() + 1;
+         if( _slim_transaction_index )
+            return;
+         if( trx.is_memoized() )
+         {
+            auto packed = trx.pack();
+            transaction.packed_trx.assign( packed.begin(), packed.end() );
+         }
+         else
+         {
+            fc::raw::pack_to_buffer( transaction.packed_trx, trx );
+         }
       });
    }
 
@@ -3855,6 +4141,64 @@ void database::update_last_irreversible_block()
    }
 } FC_CAPTURE_AND_RETHROW() }
 
+void database::archive_comment_content()
+{ try {
+   // The records appended by the last call are not in the state yet, appending them again would only grow the store
+   if( _comment_content_mode != comment_content_archived || !_archived_comment_content.empty() )
+      return;
+
+   const auto last_irreversible = get_dynamic_global_properties().last_irreversible_block_num;
+   const auto& content_idx = get_index< comment_content_index, by_last_write_block >();
+
+   // Bound the work per call, and so the work of the block that moves the content out of the state
+   for( auto itr = content_idx.begin();
+        itr != content_idx.end() && itr->last_write_block <= last_irreversible && _archived_comment_content.size() < 10000;
+        ++itr )
+   {
+      comment_content content;
+      content.title = to_string( itr->title );
+      content.body = to_string( itr->body );
+      content.json_metadata = to_string( itr->json_metadata );
+
+      archived_comment_content archived;
+      archived.id = itr->id;
+      archived.last_write_block = itr->last_write_block;
+      archived.pos = _comment_content_store.append( content, archived.size );
+      _archived_comment_content.push_back( archived );
+   }
+} FC_CAPTURE_AND_RETHROW() }
+
+/**
+ * Moves the content appended to the comment content store by archive_comment_content() out of
+ * shared memory. This is part of applying the block, if the block is popped the comment content
+ * objects return to shared memory and the appended records are never referenced.
+ */
+void database::update_archived_comment_content()
+{ try {
+   for( const auto& archived : _archived_comment_content )
+   {
+      // Content edited or deleted since it was appended stays in the state
+      const auto* con = find< comment_content_object >( archived.id );
+      if( con == nullptr || con->last_write_block != archived.last_write_block )
+         continue;
+
+      modify( *con, [&]( comment_content_object& c )
+      {
+         c.title.clear();
+         c.title.shrink_to_fit();
+         c.body.clear();
+         c.body.shrink_to_fit();
+         c.json_metadata.clear();
+         c.json_metadata.shrink_to_fit();
+         c.last_write_block = std::numeric_limits< uint32_t >::max();
+         c.archive_pos = archived.pos;
+         c.archive_size = archived.size;
+      });
+   }
+
+   _archived_comment_content.clear();
+} FC_CAPTURE_AND_RETHROW() }
+
 void database::migrate_irreversible_state()
 {
    // This method should happen atomically. We cannot prevent unclean shutdown in the middle
@@ -17,6 +17,10 @@ namespace bears { namespace chain {
 
    using bears::protocol::authority;
 
+   /**
+    * Fields that are read or written by most operations on an account. The first modify in an undo
+    * session records the old value, rarely used fields belong in account_metadata_object instead.
+    */
    class account_object : public object< account_object_type, account_object >
    {
       account_object() = delete;
@@ -24,7 +28,6 @@ namespace bears { namespace chain {
       public:
          template<typename Constructor, typename Allocator>
          account_object( Constructor&& c, allocator< Allocator > a )
-            :json_metadata( a )
          {
             c(*this);
          };
@@ -32,17 +35,10 @@ namespace bears { namespace chain {
          id_type           id;
 
          account_name_type name;
-         public_key_type   memo_key;
-         shared_string     json_metadata;
          account_name_type proxy;
 
-         time_point_sec    last_account_update;
-
          time_point_sec    created;
          bool              mined = true;
-         account_name_type recovery_account;
-         account_name_type reset_account = BEARS_NULL_ACCOUNT;
-         time_point_sec    last_account_recovery;
          uint32_t          comment_count = 0;
          uint32_t          lifetime_vote_count = 0;
          uint32_t          post_count = 0;
@@ -123,6 +119,34 @@ namespace bears { namespace chain {
          }
    };
 
+   /**
+    * Account data that only changes on account updates and recovery
+    */
+   class account_metadata_object : public object< account_metadata_object_type, account_metadata_object >
+   {
+      account_metadata_object() = delete;
+
+      public:
+         template< typename Constructor, typename Allocator >
+         account_metadata_object( Constructor&& c, allocator< Allocator > a )
+            :json_metadata( a )
+         {
+            c( *this );
+         }
+
+         id_type           id;
+
+         account_name_type account;
+         public_key_type   memo_key;
+         shared_string     json_metadata;
+
+         time_point_sec    last_account_update;
+
+         account_name_type recovery_account;
+         account_name_type reset_account = BEARS_NULL_ACCOUNT;
+         time_point_sec    last_account_recovery;
+   };
+
    class account_authority_object : public object< account_authority_object_type, account_authority_object >
    {
       account_authority_object() = delete;
@@ -261,7 +285,7 @@ namespace bears { namespace chain {
             > /// composite key by_next_coining_withdrawal
          >
       >,
-      allocator< account_object >
+      node_allocator< account_object >
    > account_index;
 
    struct by_account;
@@ -280,9 +304,20 @@ namespace bears { namespace chain {
             composite_key_compare< std::less< account_name_type >, std::less< time_point_sec >, std::less< owner_authority_history_id_type > >
          >
       >,
-      allocator< owner_authority_history_object >
+      node_allocator< owner_authority_history_object >
    > owner_authority_history_index;
 
+   typedef multi_index_container <
+      account_metadata_object,
+      indexed_by <
+         ordered_unique< tag< by_id >,
+            member< account_metadata_object, account_metadata_id_type, &account_metadata_object::id > >,
+         ordered_unique< tag< by_account >,
+            member< account_metadata_object, account_name_type, &account_metadata_object::account > >
+      >,
+      node_allocator< account_metadata_object >
+   > account_metadata_index;
+
    struct by_last_owner_update;
 
    typedef multi_index_container <
@@ -305,7 +340,7 @@ namespace bears { namespace chain {
             composite_key_compare< std::greater< time_point_sec >, std::less< account_authority_id_type > >
          >
       >,
-      allocator< account_authority_object >
+      node_allocator< account_authority_object >
    > account_authority_index;
 
    struct by_delegation;
@@ -323,7 +358,7 @@ namespace bears { namespace chain {
             composite_key_compare< std::less< account_name_type >, std::less< account_name_type > >
          >
       >,
-      allocator< coining_delegation_object >
+      node_allocator< coining_delegation_object >
    > coining_delegation_index;
 
    struct by_expiration;
@@ -350,7 +385,7 @@ namespace bears { namespace chain {
             composite_key_compare< std::less< account_name_type >, std::less< time_point_sec >, std::less< coining_delegation_expiration_id_type > >
          >
       >,
-      allocator< coining_delegation_expiration_object >
+      node_allocator< coining_delegation_expiration_object >
    > coining_delegation_expiration_index;
 
    struct by_expiration;
@@ -374,7 +409,7 @@ namespace bears { namespace chain {
             composite_key_compare< std::less< time_point_sec >, std::less< account_name_type > >
          >
       >,
-      allocator< account_recovery_request_object >
+      node_allocator< account_recovery_request_object >
    > account_recovery_request_index;
 
    struct by_effective_date;
@@ -398,14 +433,13 @@ namespace bears { namespace chain {
             composite_key_compare< std::less< time_point_sec >, std::less< account_name_type > >
          >
       >,
-      allocator< change_recovery_account_request_object >
+      node_allocator< change_recovery_account_request_object >
    > change_recovery_account_request_index;
 } }
 
 FC_REFLECT( bears::chain::account_object,
-             (id)(name)(memo_key)(json_metadata)(proxy)(last_account_update)
+             (id)(name)(proxy)
              (created)(mined)
-             (recovery_account)(last_account_recovery)(reset_account)
              (comment_count)(lifetime_vote_count)(post_count)(can_vote)(voting_manabar)
              (balance)
              (savings_balance)
@@ -423,6 +457,12 @@ FC_REFLECT( bears::chain::account_object,
 
 CHAINBASE_SET_INDEX_TYPE( bears::chain::account_object, bears::chain::account_index )
 
+FC_REFLECT( bears::chain::account_metadata_object,
+             (id)(account)(memo_key)(json_metadata)(last_account_update)
+             (recovery_account)(reset_account)(last_account_recovery)
+          )
+CHAINBASE_SET_INDEX_TYPE( bears::chain::account_metadata_object, bears::chain::account_metadata_index )
+
 FC_REFLECT( bears::chain::account_authority_object,
              (id)(account)(owner)(active)(posting)(last_owner_update)
 )
@@ -20,6 +20,7 @@ using boost::multi_index_container;
 using chainbase::object;
 using chainbase::oid;
 using chainbase::allocator;
+using chainbase::node_allocator;
 
 using bears::protocol::block_id_type;
 using bears::protocol::transaction_id_type;
@@ -68,6 +69,8 @@ enum object_type
    coining_delegation_expiration_object_type,
    pending_required_action_object_type,
    pending_optional_action_object_type,
+   account_metadata_object_type,
+   comment_content_store_object_type,
 #ifdef BEARS_ENABLE_SMT
    // SMT objects
    smt_token_object_type,
@@ -108,6 +111,8 @@ class coining_delegation_object;
 class coining_delegation_expiration_object;
 class pending_required_action_object;
 class pending_optional_action_object;
+class account_metadata_object;
+class comment_content_store_object;
 
 #ifdef BEARS_ENABLE_SMT
 class smt_token_object;
@@ -147,6 +152,8 @@ typedef oid< coining_delegation_object              > coining_delegation_id_type
 typedef oid< coining_delegation_expiration_object   > coining_delegation_expiration_id_type;
 typedef oid< pending_required_action_object         > pending_required_action_id_type;
 typedef oid< pending_optional_action_object         > pending_optional_action_id_type;
+typedef oid< account_metadata_object                > account_metadata_id_type;
+typedef oid< comment_content_store_object            > comment_content_store_id_type;
 
 #ifdef BEARS_ENABLE_SMT
 typedef oid< smt_token_object                       > smt_token_id_type;
@@ -247,6 +254,8 @@ FC_REFLECT_ENUM( bears::chain::object_type,
                  (coining_delegation_expiration_object_type)
                  (pending_required_action_object_type)
                  (pending_optional_action_object_type)
+                 (account_metadata_object_type)
+                 (comment_content_store_object_type)
 
 #ifdef BEARS_ENABLE_SMT
                  (smt_token_object_type)
@@ -299,7 +299,7 @@ namespace bears { namespace chain {
             >
          >
       >,
-      allocator< limit_order_object >
+      node_allocator< limit_order_object >
    > limit_order_index;
 
    struct by_owner;
@@ -321,7 +321,7 @@ namespace bears { namespace chain {
             >
          >
       >,
-      allocator< convert_request_object >
+      node_allocator< convert_request_object >
    > convert_request_index;
 
    struct by_owner;
@@ -340,7 +340,7 @@ namespace bears { namespace chain {
             composite_key_compare< std::greater< fc::uint128 >, std::less< account_id_type > >
          >
       >,
-      allocator< liquidity_reward_balance_object >
+      node_allocator< liquidity_reward_balance_object >
    > liquidity_reward_balance_index;
 
    typedef multi_index_container<
@@ -348,7 +348,7 @@ namespace bears { namespace chain {
       indexed_by<
          ordered_unique< tag< by_id >, member< feed_history_object, feed_history_id_type, &feed_history_object::id > >
       >,
-      allocator< feed_history_object >
+      node_allocator< feed_history_object >
    > feed_history_index;
 
    struct by_withdraw_route;
@@ -371,7 +371,7 @@ namespace bears { namespace chain {
             >
          >
       >,
-      allocator< withdraw_coining_route_object >
+      node_allocator< withdraw_coining_route_object >
    > withdraw_coining_route_index;
 
    struct by_from_id;
@@ -395,7 +395,7 @@ namespace bears { namespace chain {
             composite_key_compare< std::less< bool >, std::less< time_point_sec >, std::less< escrow_id_type > >
          >
       >,
-      allocator< escrow_object >
+      node_allocator< escrow_object >
    > escrow_index;
 
    struct by_from_rid;
@@ -426,7 +426,7 @@ namespace bears { namespace chain {
             >
          >
       >,
-      allocator< savings_withdraw_object >
+      node_allocator< savings_withdraw_object >
    > savings_withdraw_index;
 
    struct by_account;
@@ -446,7 +446,7 @@ namespace bears { namespace chain {
             composite_key_compare< std::less< time_point_sec >, std::less< account_name_type > >
          >
       >,
-      allocator< decline_voting_rights_request_object >
+      node_allocator< decline_voting_rights_request_object >
    > decline_voting_rights_request_index;
 
    typedef multi_index_container<
@@ -455,7 +455,7 @@ namespace bears { namespace chain {
          ordered_unique< tag< by_id >, member< reward_fund_object, reward_fund_id_type, &reward_fund_object::id > >,
          ordered_unique< tag< by_name >, member< reward_fund_object, reward_fund_name_type, &reward_fund_object::name > >
       >,
-      allocator< reward_fund_object >
+      node_allocator< reward_fund_object >
    > reward_fund_index;
 
 } } // bears::chain
@@ -1,6 +1,7 @@
 #pragma once
 #include <fc/filesystem.hpp>
 #include <bears/protocol/block.hpp>
+#include <bears/protocol/signed_block_view.hpp>
 
 namespace bears { namespace chain {
 
@@ -47,6 +48,27 @@ namespace bears { namespace chain {
          std::pair< signed_block, uint64_t > read_block( uint64_t file_pos )const;
          optional< signed_block > read_block_by_num( uint32_t block_num )const;
 
+         /**
+          * Reads the packed bytes of a block without unpacking its transactions.
+          * Returns an empty optional if the block is not in the log.
+          */
+         optional< signed_block_view > read_block_view_by_num( uint32_t block_num )const;
+
+         /**
+          * Reads consecutive blocks starting at first_block_num exactly as they are stored in the log,
+          * each packed block followed by its position. Reads at least one block and stops before
+          * max_bytes would be exceeded. The position of the first block is written to first_block_pos.
+          * Returns the number of blocks read, 0 if first_block_num is not in the log.
+          */
+         uint32_t read_raw_blocks( uint32_t first_block_num, uint64_t max_bytes,
+                                   std::vector< char >& data, uint64_t& first_block_pos )const;
+
+         /**
+          * Unpacks blocks read by read_raw_blocks(), checking that the position following each block
+          * is where the block started in the log it was read from.
+          */
+         static std::vector< signed_block > unpack_raw_blocks( const std::vector< char >& data, uint64_t first_block_pos );
+
          /**
           * Return offset of block in file, or block_log::npos if it does not exist.
           */
@@ -66,6 +88,7 @@ namespace bears { namespace chain {
          void construct_index();
 
          std::pair< signed_block, uint64_t > read_block_helper( uint64_t file_pos )const;
+         std::vector< char > read_raw_block_helper( uint32_t block_num, uint64_t file_pos )const;
          uint64_t get_block_pos_helper( uint32_t block_num ) const;
 
          std::unique_ptr<detail::block_log_impl> my;
@@ -35,7 +35,7 @@ namespace bears { namespace chain {
          ordered_unique< tag< by_id >,
             member< block_summary_object, block_summary_object::id_type, &block_summary_object::id > >
       >,
-      allocator< block_summary_object >
+      node_allocator< block_summary_object >
    > block_summary_index;
 
 } } // bears::chain
@@ -0,0 +1,58 @@
+#pragma once
+#include <fc/filesystem.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <string>
+
+namespace bears { namespace chain {
+
+   namespace detail { class comment_content_store_impl; }
+
+   /** Title, body and json metadata of a comment, outside of shared memory */
+   struct comment_content
+   {
+      std::string title;
+      std::string body;
+      std::string json_metadata;
+   };
+
+   /* The comment content store is an external append only file holding the content of comments
+    * that are no longer kept in the shared memory file. Content is only written once the block
+    * that last changed it is irreversible, so the file never has to be rewritten. Editing an
+    * archived comment moves its content back into shared memory, the old record simply becomes
+    * unreachable.
+    *
+    * +-----------------------+-----------------------+-----+
+    * | Packed comment_content | Packed comment_content | ... |
+    * +-----------------------+-----------------------+-----+
+    *
+    * The file does not index itself. The comment_content_object of each archived comment keeps
+    * the position and size of its record, and because these are only changed through chainbase
+    * they follow the undo state of the chain. Records appended by blocks that are later popped
+    * are never referenced and are ignored.
+    */
+   class comment_content_store
+   {
+      public:
+         comment_content_store();
+         ~comment_content_store();
+
+         void open( const fc::path& file );
+         void close();
+         bool is_open()const;
+
+         /** Appends the content and returns the position of the record, its size is written to size */
+         uint64_t append( const comment_content& content, uint32_t& size );
+         comment_content read( uint64_t pos, uint32_t size )const;
+
+         void flush();
+         /** Flushes the store and waits until its content is on disk */
+         void sync();
+
+      private:
+         std::unique_ptr< detail::comment_content_store_impl > my;
+   };
+
+} }
+
+FC_REFLECT( bears::chain::comment_content, (title)(body)(json_metadata) )
@@ -6,7 +6,10 @@
 #include <bears/chain/bears_object_types.hpp>
 #include <bears/chain/witness_objects.hpp>
 
+#include <fc/crypto/city.hpp>
+
 #include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
 
 
 namespace bears { namespace chain {
@@ -44,6 +47,17 @@ namespace bears { namespace chain {
          }
    };
 
+   /**
+    * Hash of the author and permlink of a comment, kept in the state so it has to be stable across builds.
+    * The permlink is hashed up to its first null character to match the comparison of strcmp_less.
+    */
+   inline uint64_t comment_permlink_hash( const account_name_type& author, const char* permlink )
+   {
+      std::string author_str = author;
+      return fc::city_hash64( permlink, std::strlen( permlink ) )
+         ^ ( fc::city_hash64( author_str.data(), author_str.size() ) * 0x9E3779B97F4A7C15ull );
+   }
+
    class comment_object : public object < comment_object_type, comment_object >
    {
       comment_object() = delete;
@@ -57,6 +71,7 @@ namespace bears { namespace chain {
 #endif
          {
             c( *this );
+            permlink_hash = comment_permlink_hash( author, permlink.c_str() );
          }
 
          id_type           id;
@@ -66,6 +81,7 @@ namespace bears { namespace chain {
          shared_string     parent_permlink;
          account_name_type author;
          shared_string     permlink;
+         uint64_t          permlink_hash = 0; ///< comment_permlink_hash of author and permlink, for by_permlink_hash
 
          time_point_sec    last_update;
          time_point_sec    created;
@@ -132,6 +148,34 @@ namespace bears { namespace chain {
          shared_string     title;
          shared_string     body;
          shared_string     json_metadata;
+
+         /// Block that last wrote the content, max once the content is archived
+         uint32_t          last_write_block = 0;
+
+         /// Position of the content in the comment_content_store, archive_size is 0 while it is in shared memory
+         uint64_t          archive_pos = 0;
+         uint32_t          archive_size = 0;
+
+         bool is_archived()const { return archive_size != 0; }
+   };
+
+   /**
+    * Records how the state keeps comment content, the content of the state is only consistent with
+    * the mode it was built with.
+    */
+   class comment_content_store_object : public object< comment_content_store_object_type, comment_content_store_object >
+   {
+      public:
+         template< typename Constructor, typename Allocator >
+         comment_content_store_object( Constructor&& c, allocator< Allocator > )
+         {
+            c( *this );
+         }
+
+         id_type           id;
+
+         /// A database::comment_content_mode
+         uint8_t           mode = 0;
    };
 
    /**
@@ -177,12 +221,13 @@ namespace bears { namespace chain {
             >
          >
       >,
-      allocator< comment_vote_object >
+      node_allocator< comment_vote_object >
    > comment_vote_index;
 
 
    struct by_cashout_time; /// cashout_time
    struct by_permlink; /// author, perm
+   struct by_permlink_hash; /// hash of author, perm
    struct by_root;
    struct by_parent;
    struct by_last_update; /// parent_auth, last_update
@@ -209,6 +254,8 @@ namespace bears { namespace chain {
             >,
             composite_key_compare< std::less< account_name_type >, strcmp_less >
          >,
+         /// Point lookups of by_permlink without string compares in the tree, see database::find_comment
+         hashed_non_unique< tag< by_permlink_hash >, member< comment_object, uint64_t, &comment_object::permlink_hash > >,
          ordered_unique< tag< by_root >,
             composite_key< comment_object,
                member< comment_object, comment_id_type, &comment_object::root_comment >,
@@ -244,20 +291,35 @@ namespace bears { namespace chain {
          >
 #endif
       >,
-      allocator< comment_object >
+      node_allocator< comment_object >
    > comment_index;
 
    struct by_comment;
+   struct by_last_write_block;
 
    typedef multi_index_container<
       comment_content_object,
       indexed_by<
          ordered_unique< tag< by_id >, member< comment_content_object, comment_content_id_type, &comment_content_object::id > >,
-         ordered_unique< tag< by_comment >, member< comment_content_object, comment_id_type, &comment_content_object::comment > >
+         ordered_unique< tag< by_comment >, member< comment_content_object, comment_id_type, &comment_content_object::comment > >,
+         ordered_unique< tag< by_last_write_block >,
+            composite_key< comment_content_object,
+               member< comment_content_object, uint32_t, &comment_content_object::last_write_block >,
+               member< comment_content_object, comment_content_id_type, &comment_content_object::id >
+            >
+         >
       >,
-      allocator< comment_content_object >
+      node_allocator< comment_content_object >
    > comment_content_index;
 
+   typedef multi_index_container<
+      comment_content_store_object,
+      indexed_by<
+         ordered_unique< tag< by_id >, member< comment_content_store_object, comment_content_store_id_type, &comment_content_store_object::id > >
+      >,
+      node_allocator< comment_content_store_object >
+   > comment_content_store_index;
+
 } } // bears::chain
 
 #ifdef BEARS_ENABLE_SMT
@@ -286,11 +348,19 @@ FC_REFLECT( bears::chain::comment_object,
           )
 #endif
 CHAINBASE_SET_INDEX_TYPE( bears::chain::comment_object, bears::chain::comment_index )
+// The static_variants of allowed_vote_assets cannot be restored as bytes, with SMT comments are copied whole
+#ifndef BEARS_ENABLE_SMT
+CHAINBASE_SET_DELTA_UNDO_MEMBERS( bears::chain::comment_object,
+   (category)(parent_permlink)(permlink)(beneficiaries) )
+#endif
 
 FC_REFLECT( bears::chain::comment_content_object,
-            (id)(comment)(title)(body)(json_metadata) )
+            (id)(comment)(title)(body)(json_metadata)(last_write_block)(archive_pos)(archive_size) )
 CHAINBASE_SET_INDEX_TYPE( bears::chain::comment_content_object, bears::chain::comment_content_index )
 
+FC_REFLECT( bears::chain::comment_content_store_object, (id)(mode) )
+CHAINBASE_SET_INDEX_TYPE( bears::chain::comment_content_store_object, bears::chain::comment_content_store_index )
+
 FC_REFLECT( bears::chain::comment_vote_object,
              (id)(voter)(comment)(weight)(rshares)(vote_percent)(last_update)(num_changes)
           )
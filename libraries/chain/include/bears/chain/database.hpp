@@ -3,6 +3,7 @@
  */
 #pragma once
 #include <bears/chain/block_log.hpp>
+#include <bears/chain/comment_content_store.hpp>
 #include <bears/chain/fork_database.hpp>
 #include <bears/chain/global_property_object.hpp>
 #include <bears/chain/hardfork_property_object.hpp>
@@ -92,6 +93,13 @@ namespace bears { namespace chain {
             skip_block_log              = 1 << 13  ///< used to skip block logging on reindex
          };
 
+         enum comment_content_mode
+         {
+            comment_content_in_state = 0, ///< comment content is kept in the shared memory file
+            comment_content_archived = 1, ///< comment content moves to the comment content store once irreversible
+            comment_content_disabled = 2  ///< comment content is not stored, for consensus only nodes
+         };
+
          typedef std::function<void(uint32_t, const abstract_index_cntr_t&)> TBenchmarkMidReport;
          typedef std::pair<uint32_t, TBenchmarkMidReport> TBenchmark;
 
@@ -106,6 +114,9 @@ namespace bears { namespace chain {
             uint32_t chainbase_flags = 0;
             bool do_validate_invariants = false;
             bool benchmark_is_enabled = false;
+            comment_content_mode comment_content = comment_content_in_state;
+            /// Keep only the id, expiration and block number of applied transactions for the dedupe check
+            bool slim_transaction_index = false;
 
             // The following fields are only used on reindexing
             uint32_t stop_replay_at = 0;
@@ -155,6 +166,8 @@ namespace bears { namespace chain {
          block_id_type              get_block_id_for_num( uint32_t block_num )const;
          optional<signed_block>     fetch_block_by_id( const block_id_type& id )const;
          optional<signed_block>     fetch_block_by_number( uint32_t num )const;
+         optional<signed_block_view> fetch_block_view_by_id( const block_id_type& id )const;
+         optional<signed_block_header> fetch_block_header_by_number( uint32_t num )const;
          const signed_transaction   get_recent_transaction( const transaction_id_type& trx_id )const;
          std::vector<block_id_type> get_block_ids_on_fork(block_id_type head_of_fork) const;
 
@@ -189,6 +202,10 @@ namespace bears { namespace chain {
          const comment_object*  find_comment( const account_name_type& author, const string& permlink )const;
 #endif
 
+         /** Content of the comment, read from shared memory or the comment content store */
+         optional< comment_content > find_comment_content( const comment_id_type& comment )const;
+         comment_content_mode        get_comment_content_mode()const { return _comment_content_mode; }
+
          const escrow_object&   get_escrow(  const account_name_type& name, uint32_t escrow_id )const;
          const escrow_object*   find_escrow( const account_name_type& name, uint32_t escrow_id )const;
 
@@ -242,6 +259,19 @@ namespace bears { namespace chain {
          void pop_block();
          void clear_pending();
 
+         /** Reads blocks from the block log as they are stored, see block_log::read_raw_blocks() */
+         uint32_t read_raw_block_log( uint32_t first_block_num, uint64_t max_bytes,
+                                      std::vector< char >& data, uint64_t& first_block_pos )const;
+
+         /**
+          *  Applies blocks that are irreversible on another node, taken from its block log, and
+          *  appends them to the block log. Only possible while every applied block is in the block
+          *  log. The blocks have to link to the head block and to each other, and their witness
+          *  signatures and merkle roots are checked, everything else is skipped like in a replay.
+          *  Returns the new head block number.
+          */
+         uint32_t import_irreversible_blocks( const std::vector< signed_block >& blocks );
+
          void push_virtual_operation( const operation& op );
          void pre_push_virtual_operation( const operation& op );
          void post_push_virtual_operation( const operation& op );
@@ -473,6 +503,28 @@ namespace bears { namespace chain {
          const std::string& get_json_schema() const;
 
          void set_flush_interval( uint32_t flush_blocks );
+
+         /**
+          * Checkpoints the shared memory file to checkpoint_dir every checkpoint_blocks blocks, 0
+          * disables checkpoints. A state restored from a checkpoint is rewound to the last
+          * irreversible block of the checkpoint on open and then catches up with the block log.
+          */
+         void set_checkpoint_interval( uint32_t checkpoint_blocks, const fc::path& checkpoint_dir );
+
+         /**
+          * Takes the checkpoint that a block applied since the last call is due for. Writing back
+          * the file for it would stall readers, call this after releasing the write lock and before
+          * the next write.
+          */
+         void create_due_checkpoint();
+
+         /**
+          * Appends the content of comments last written by an irreversible block to the comment
+          * content store. The next applied block moves the appended content out of shared memory.
+          * Call this from the thread that writes to the database after releasing the write lock,
+          * or between blocks of a replay.
+          */
+         void archive_comment_content();
          void check_free_memory( bool force_print, uint32_t current_block_num );
 
 #ifdef IS_TEST_NET
@@ -503,6 +555,8 @@ namespace bears { namespace chain {
          optional< chainbase::database::session > _pending_tx_session;
 
          void apply_block( const signed_block& next_block, uint32_t skip = skip_nothing );
+         void replay_block_log_tail();
+         void create_checkpoint( uint32_t block_num );
          void apply_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
          void _apply_block( const signed_block& next_block );
          void _apply_transaction( const signed_transaction& trx );
@@ -520,6 +574,7 @@ namespace bears { namespace chain {
          void update_global_dynamic_data( const signed_block& b );
          void update_signing_witness(const witness_object& signing_witness, const signed_block& new_block);
          void update_last_irreversible_block();
+         void update_archived_comment_content();
          void migrate_irreversible_state();
          void clear_expired_transactions();
          void clear_expired_orders();
@@ -557,6 +612,21 @@ namespace bears { namespace chain {
 
          block_log                     _block_log;
 
+         comment_content_store         _comment_content_store;
+         comment_content_mode          _comment_content_mode = comment_content_in_state;
+         bool                          _slim_transaction_index = false;
+
+         /// A comment content record appended by archive_comment_content() that is not in the state yet
+         struct archived_comment_content
+         {
+            comment_content_id_type    id;
+            uint32_t                   last_write_block = 0;
+            uint64_t                   pos = 0;
+            uint32_t                   size = 0;
+         };
+
+         vector< archived_comment_content > _archived_comment_content;
+
          // this function needs access to _plugin_index_signal
          template< typename MultiIndexType >
          friend void add_plugin_index( database& db );
@@ -576,6 +646,10 @@ namespace bears { namespace chain {
          uint32_t                      _flush_blocks = 0;
          uint32_t                      _next_flush_block = 0;
 
+         uint32_t                      _checkpoint_blocks = 0;
+         fc::path                      _checkpoint_dir;
+         bool                          _checkpoint_due = false;
+
          uint32_t                      _last_free_gb_printed = 0;
          /// For Initial value see appropriate comment where get_smt_next_identifier is implemented.
          uint32_t                      _next_available_nai = SMT_MIN_NON_RESERVED_NAI;
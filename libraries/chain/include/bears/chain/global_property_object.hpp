@@ -133,7 +133,7 @@ namespace bears { namespace chain {
          ordered_unique< tag< by_id >,
             member< dynamic_global_property_object, dynamic_global_property_object::id_type, &dynamic_global_property_object::id > >
       >,
-      allocator< dynamic_global_property_object >
+      node_allocator< dynamic_global_property_object >
    > dynamic_global_property_index;
 
 } } // bears::chain
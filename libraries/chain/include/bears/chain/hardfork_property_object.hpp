@@ -34,7 +34,7 @@ namespace bears { namespace chain {
       indexed_by<
          ordered_unique< member< hardfork_property_object, hardfork_property_object::id_type, &hardfork_property_object::id > >
       >,
-      allocator< hardfork_property_object >
+      node_allocator< hardfork_property_object >
    > hardfork_property_index;
 
 } } // bears::chain
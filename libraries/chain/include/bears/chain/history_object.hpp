@@ -55,7 +55,7 @@ namespace bears { namespace chain {
          >
 #endif
       >,
-      allocator< operation_object >
+      node_allocator< operation_object >
    > operation_index;
 
    class account_history_object : public object< account_history_object_type, account_history_object >
@@ -88,7 +88,7 @@ namespace bears { namespace chain {
             composite_key_compare< std::less< account_name_type >, std::greater< uint32_t > >
          >
       >,
-      allocator< account_history_object >
+      node_allocator< account_history_object >
    > account_history_index;
 } }
 
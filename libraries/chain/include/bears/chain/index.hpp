@@ -6,6 +6,13 @@
 
 #include <bears/chain/database.hpp>
 
+#include <boost/core/demangle.hpp>
+
+#include <algorithm>
+#include <typeinfo>
+#include <type_traits>
+#include <vector>
+
 namespace bears { namespace chain {
 
 using bears::schema::abstract_schema;
@@ -34,9 +41,57 @@ struct index_info_impl
    std::shared_ptr< abstract_schema > _schema;
 };
 
+/// Containers that allocate, such as shared_string and the interprocess vectors, maps and sets
+template< typename T, typename = void >
+struct has_allocator : std::false_type {};
+
+template< typename T >
+struct has_allocator< T, typename std::conditional< false, typename T::allocator_type, void >::type > : std::true_type {};
+
+/**
+ * Visits the reflected members of an object undone from deltas. A member that allocates has to be
+ * one of the delta_undo_members of the object, or undo would restore the bytes of its pointers.
+ */
+template< typename T >
+struct delta_undo_member_checker
+{
+   const T&                            object;
+   const std::vector< const void* >&   listed;
+
+   template< typename Member, class Class, Member (Class::*member) >
+   void operator()( const char* name )const
+   {
+      FC_ASSERT( !has_allocator< Member >::value ||
+                 std::find( listed.begin(), listed.end(), &( object.*member ) ) != listed.end(),
+         "${type}::${member} has to be listed with CHAINBASE_SET_DELTA_UNDO_MEMBERS",
+         ("type", boost::core::demangle( typeid( T ).name() ))("member", name) );
+   }
+};
+
+template< typename T >
+void check_delta_undo_members( std::false_type ) {}
+
+template< typename T >
+void check_delta_undo_members( std::true_type )
+{
+   // Only the addresses of the members are taken, the object is never constructed
+   typename std::aligned_storage< sizeof( T ), alignof( T ) >::type storage;
+   const T& object = *reinterpret_cast< const T* >( &storage );
+
+   std::vector< const void* > listed;
+   chainbase::delta_undo_members< T >::visit( object, [&]( uint32_t, const auto& m ) { listed.push_back( &m ); } );
+   fc::reflector< T >::visit( delta_undo_member_checker< T >{ object, listed } );
+}
+
 template< typename MultiIndexType >
 void _add_index_impl( database& db )
 {
+#ifndef NDEBUG
+   typedef typename MultiIndexType::value_type value_type;
+   check_delta_undo_members< value_type >( std::integral_constant< bool,
+      chainbase::use_delta_undo< value_type >::value && chainbase::delta_undo_members< value_type >::value >() );
+#endif
+
    db.add_index< MultiIndexType >();
    std::shared_ptr< chainbase::index_extension > ext =
       std::make_shared< index_info_impl< MultiIndexType > >();
@@ -30,7 +30,7 @@ typedef multi_index_container<
    indexed_by<
       ordered_unique< tag< by_id >, member< pending_optional_action_object, pending_optional_action_id_type, &pending_optional_action_object::id > >
    >,
-   allocator< pending_optional_action_object >
+   node_allocator< pending_optional_action_object >
 > pending_optional_action_index;
 
 } } //bears::chain
@@ -30,7 +30,7 @@ typedef multi_index_container<
    indexed_by<
       ordered_unique< tag< by_id >, member< pending_required_action_object, pending_required_action_id_type, &pending_required_action_object::id > >
    >,
-   allocator< pending_required_action_object >
+   node_allocator< pending_required_action_object >
 > pending_required_action_index;
 
 } } //bears::chain
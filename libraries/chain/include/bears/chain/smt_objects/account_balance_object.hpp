@@ -123,7 +123,7 @@ typedef multi_index_container <
          >
       >
    >,
-   allocator< account_regular_balance_object >
+   node_allocator< account_regular_balance_object >
 > account_regular_balance_index;
 
 typedef multi_index_container <
@@ -139,7 +139,7 @@ typedef multi_index_container <
          >
       >
    >,
-   allocator< account_rewards_balance_object >
+   node_allocator< account_rewards_balance_object >
 > account_rewards_balance_index;
 
 } } // namespace bears::chain
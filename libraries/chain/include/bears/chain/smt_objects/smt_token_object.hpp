@@ -188,7 +188,7 @@ typedef multi_index_container <
       ordered_non_unique< tag< by_control_account >,
          member< smt_token_object, account_name_type, &smt_token_object::control_account > >
    >,
-   allocator< smt_token_object >
+   node_allocator< smt_token_object >
 > smt_token_index;
 
 struct by_interval_gen_begin;
@@ -226,7 +226,7 @@ typedef multi_index_container <
          >
       >
    >,
-   allocator< smt_event_token_object >
+   node_allocator< smt_event_token_object >
 > smt_event_token_index;
 
 } } // namespace bears::chain
@@ -15,6 +15,9 @@ namespace bears { namespace chain {
     * The purpose of this object is to enable the detection of duplicate transactions. When a transaction is included
     * in a block a transaction_object is added. At the end of block processing all transaction_objects that have
     * expired can be removed from the index.
+    *
+    * packed_trx is left empty when the database keeps a slim transaction index, the transaction is then found
+    * through block_num in the pending transactions, fork database or block log.
     */
    class transaction_object : public object< transaction_object_type, transaction_object >
    {
@@ -35,6 +38,7 @@ namespace bears { namespace chain {
          t_packed_trx         packed_trx;
          transaction_id_type  trx_id;
          time_point_sec       expiration;
+         uint32_t             block_num = 0;
    };
 
    struct by_expiration;
@@ -46,12 +50,12 @@ namespace bears { namespace chain {
          hashed_unique< tag< by_trx_id >, BOOST_MULTI_INDEX_MEMBER(transaction_object, transaction_id_type, trx_id), std::hash<transaction_id_type> >,
          ordered_non_unique< tag< by_expiration >, member<transaction_object, time_point_sec, &transaction_object::expiration > >
       >,
-      allocator< transaction_object >
+      node_allocator< transaction_object >
    > transaction_index;
 
 } } // bears::chain
 
-FC_REFLECT( bears::chain::transaction_object, (id)(packed_trx)(trx_id)(expiration) )
+FC_REFLECT( bears::chain::transaction_object, (id)(packed_trx)(trx_id)(expiration)(block_num) )
 CHAINBASE_SET_INDEX_TYPE( bears::chain::transaction_object, bears::chain::transaction_index )
 
 namespace helpers
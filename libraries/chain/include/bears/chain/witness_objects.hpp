@@ -241,7 +241,7 @@ namespace bears { namespace chain {
             >
          >
       >,
-      allocator< witness_object >
+      node_allocator< witness_object >
    > witness_index;
 
    struct by_account_witness;
@@ -265,7 +265,7 @@ namespace bears { namespace chain {
             composite_key_compare< std::less< account_name_type >, std::less< account_name_type > >
          >
       >, // indexed_by
-      allocator< witness_vote_object >
+      node_allocator< witness_vote_object >
    > witness_vote_index;
 
    typedef multi_index_container<
@@ -273,7 +273,7 @@ namespace bears { namespace chain {
       indexed_by<
          ordered_unique< tag< by_id >, member< witness_schedule_object, witness_schedule_id_type, &witness_schedule_object::id > >
       >,
-      allocator< witness_schedule_object >
+      node_allocator< witness_schedule_object >
    > witness_schedule_index;
 
 } }
@@ -302,6 +302,8 @@ FC_REFLECT( bears::chain::witness_object,
              (available_witness_account_subsidies)
           )
 CHAINBASE_SET_INDEX_TYPE( bears::chain::witness_object, bears::chain::witness_index )
+// The versions only add a vtable pointer to the words, which no modify changes
+CHAINBASE_SET_DELTA_UNDO_MEMBERS( bears::chain::witness_object, (url) )
 
 FC_REFLECT( bears::chain::witness_vote_object, (id)(witness)(account) )
 CHAINBASE_SET_INDEX_TYPE( bears::chain::witness_vote_object, bears::chain::witness_vote_index )
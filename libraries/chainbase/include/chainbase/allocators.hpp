@@ -12,6 +12,7 @@
 #include <boost/interprocess/sync/sharable_lock.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 
+#include <algorithm>
 #include <type_traits>
 
 namespace chainbase {
@@ -34,6 +35,151 @@ namespace chainbase {
 
    typedef boost::unique_lock< read_write_mutex > write_lock;
 
+   #ifndef ENABLE_STD_ALLOCATOR
+      typedef bip::managed_mapped_file::segment_manager segment_manager;
+
+      /**
+       *  Segregated storage for the nodes of one index. Nodes are carved out of blocks allocated from
+       *  the segment manager and freed nodes go on a free list that only this index takes from, so
+       *  creating and removing objects (and undoing them) does not go through the general purpose
+       *  allocator of the segment and does not fragment it. Blocks are never given back, the free
+       *  nodes of an index that shrank stay reserved for it.
+       */
+      class node_pool
+      {
+         public:
+            explicit node_pool( size_t node_size )
+            :_node_size( std::max( node_size, sizeof( free_node ) ) ){}
+
+            void* allocate( segment_manager* manager )
+            {
+               ++_used_nodes;
+
+               if( _free_list )
+               {
+                  free_node* n = _free_list.get();
+                  _free_list = n->next;
+                  --_free_nodes;
+                  return n;
+               }
+
+               if( _block_cur == _block_end )
+               {
+                  size_t block_size = _next_block_nodes * _node_size;
+                  _block_cur = static_cast< char* >( manager->allocate( block_size ) );
+                  _block_end = _block_cur + block_size;
+                  _reserved_size += block_size;
+
+                  if( _next_block_nodes * _node_size < max_block_size )
+                     _next_block_nodes *= 2;
+               }
+
+               void* n = _block_cur.get();
+               _block_cur += _node_size;
+               return n;
+            }
+
+            void deallocate( void* p )
+            {
+               free_node* n = static_cast< free_node* >( p );
+               n->next = _free_list;
+               _free_list = n;
+               --_used_nodes;
+               ++_free_nodes;
+            }
+
+            size_t node_size()const { return _node_size; }
+            /// Memory taken from the segment by this pool
+            size_t reserved_size()const { return _reserved_size; }
+            /// Memory of the pool that is not held by a node of the index
+            size_t free_size()const { return _reserved_size - _used_nodes * _node_size; }
+            /// Memory of the pool in nodes that were used and freed again
+            size_t free_list_size()const { return _free_nodes * _node_size; }
+
+         private:
+            struct free_node
+            {
+               bip::offset_ptr< free_node > next;
+            };
+
+            static const size_t max_block_size = 256 * 1024;
+
+            bip::offset_ptr< free_node >  _free_list;
+            bip::offset_ptr< char >       _block_cur;
+            bip::offset_ptr< char >       _block_end;
+            size_t                        _node_size = 0;
+            size_t                        _next_block_nodes = 16;
+            size_t                        _reserved_size = 0;
+            size_t                        _used_nodes = 0;
+            size_t                        _free_nodes = 0;
+      };
+
+      /**
+       *  Allocator for the multi_index_container of an index. Single allocations of the node size of
+       *  the index are served by the node_pool of the index, everything else (hashed index buckets,
+       *  and allocators converted from this one to construct the objects) goes to the segment.
+       */
+      template< typename T >
+      class node_allocator : public bip::allocator< T, segment_manager >
+      {
+            typedef bip::allocator< T, segment_manager > base_type;
+
+         public:
+            typedef typename base_type::pointer    pointer;
+            typedef typename base_type::size_type  size_type;
+
+            /// Containers only use allocate and deallocate, the node interface of bip::allocator would bypass the pool
+            typedef bip::version_type< node_allocator, 1 > version;
+
+            template< typename U >
+            struct rebind { typedef node_allocator< U > other; };
+
+            node_allocator( segment_manager* manager ) : base_type( manager ) {}
+            node_allocator( const base_type& a, node_pool* pool = nullptr ) : base_type( a ), _pool( pool ) {}
+
+            template< typename U >
+            node_allocator( const node_allocator< U >& other ) : base_type( other ), _pool( other.get_pool() ) {}
+
+            pointer allocate( size_type count )
+            {
+               if( use_pool( count ) )
+                  return pointer( static_cast< T* >( _pool->allocate( this->get_segment_manager() ) ) );
+               return base_type::allocate( count );
+            }
+
+            void deallocate( const pointer& ptr, size_type count )
+            {
+               if( use_pool( count ) )
+                  _pool->deallocate( bip::ipcdetail::to_raw_pointer( ptr ) );
+               else
+                  base_type::deallocate( ptr, count );
+            }
+
+            node_pool* get_pool()const { return _pool.get(); }
+
+         private:
+            bool use_pool( size_type count )const
+            {
+               return count == 1 && _pool && sizeof( T ) == _pool->node_size();
+            }
+
+            bip::offset_ptr< node_pool > _pool;
+      };
+   #else
+      class node_pool
+      {
+         public:
+            explicit node_pool( size_t ){}
+
+            size_t reserved_size()const { return 0; }
+            size_t free_size()const { return 0; }
+            size_t free_list_size()const { return 0; }
+      };
+
+      template< typename T >
+      using node_allocator = std::allocator< T >;
+   #endif
+
    #ifdef ENABLE_STD_ALLOCATOR
       #define _ENABLE_STD_ALLOCATOR 1
    #else
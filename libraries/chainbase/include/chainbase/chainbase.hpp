@@ -6,6 +6,7 @@
 #include <boost/interprocess/containers/flat_map.hpp>
 #include <boost/interprocess/containers/deque.hpp>
 #include <boost/interprocess/containers/string.hpp>
+#include <boost/interprocess/containers/vector.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
 #include <boost/interprocess/sync/sharable_lock.hpp>
@@ -13,6 +14,8 @@
 
 #include <boost/multi_index_container.hpp>
 
+#include <boost/preprocessor/seq/for_each_i.hpp>
+
 #include <boost/chrono.hpp>
 #include <boost/config.hpp>
 #include <boost/filesystem.hpp>
@@ -23,11 +26,18 @@
 #include <chainbase/allocators.hpp>
 #include <chainbase/util/object_id.hpp>
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <type_traits>
 #include <typeindex>
 #include <typeinfo>
 
@@ -54,6 +64,10 @@ namespace helpers
       size_t      _item_additional_allocation = 0;
       /// Additional memory used for container internal structures (like tree nodes).
       size_t      _additional_container_allocation = 0;
+      /// Memory reserved by the node pool of the index
+      size_t      _pool_reserved = 0;
+      /// Part of the pool reserve not held by an item, a large share of it means the index shrank
+      size_t      _pool_free = 0;
    };
 
    template <class IndexType>
@@ -63,7 +77,7 @@ namespace helpers
       info->_item_count = index.size();
       info->_item_sizeof = sizeof(typename IndexType::value_type);
       info->_item_additional_allocation = 0;
-      size_t pureNodeSize = sizeof(typename IndexType::node_type) -
+      size_t pureNodeSize = sizeof(typename IndexType::final_node_type) -
          sizeof(typename IndexType::value_type);
       info->_additional_container_allocation = info->_item_count*pureNodeSize;
    }
@@ -137,6 +151,52 @@ namespace chainbase {
    template<typename Constructor, typename Allocator> \
    OBJECT_TYPE( Constructor&& c, Allocator&&  ) { c(*this); }
 
+   /**
+    *  Lists the members of an object type that own memory outside of the object, such as strings and
+    *  vectors. Their contents are undone from a copy of the members a modify changed, the rest of the
+    *  object from the words it changed. Use CHAINBASE_SET_DELTA_UNDO_MEMBERS to specialize it.
+    */
+   template< typename T >
+   struct delta_undo_members : std::false_type
+   {
+      template< typename Object, typename Visitor >
+      static void visit( Object&, Visitor&& ) {}
+   };
+
+   /** Elements of a delta_undo_members member are saved and restored as bytes */
+   template< typename T >
+   struct is_delta_undo_element : std::is_trivially_copyable< T > {};
+
+   template< typename A, typename B >
+   struct is_delta_undo_element< std::pair< A, B > >
+      : std::integral_constant< bool, is_delta_undo_element< A >::value && is_delta_undo_element< B >::value > {};
+
+   #define CHAINBASE_VISIT_DELTA_UNDO_MEMBER( r, visitor, i, member ) visitor( i, o.member );
+
+   /**
+    *  This macro must be used at global scope and OBJECT_TYPE must be fully qualified, MEMBERS is a
+    *  sequence like (name)(url) of strings or vectors of elements that can be copied byte for byte
+    */
+   #define CHAINBASE_SET_DELTA_UNDO_MEMBERS( OBJECT_TYPE, MEMBERS ) \
+   namespace chainbase { template<> struct delta_undo_members<OBJECT_TYPE> : std::true_type { \
+      template< typename Object, typename Visitor > \
+      static void visit( Object& o, Visitor&& v ) { BOOST_PP_SEQ_FOR_EACH_I( CHAINBASE_VISIT_DELTA_UNDO_MEMBER, v, MEMBERS ) } \
+   }; }
+
+   /**
+    *  Objects that can be copied byte for byte, apart from their delta_undo_members, are undone from
+    *  the 8 byte words a modify changed instead of a copy of the whole object. Specialize this to
+    *  std::false_type for an object type that must always be copied whole.
+    */
+#ifndef CHAINBASE_DISABLE_DELTA_UNDO
+   template< typename T >
+   struct use_delta_undo
+      : std::integral_constant< bool, std::is_trivially_copyable< T >::value || delta_undo_members< T >::value > {};
+#else
+   template< typename T >
+   struct use_delta_undo : std::false_type {};
+#endif
+
    template< typename value_type >
    class undo_state
    {
@@ -145,16 +205,32 @@ namespace chainbase {
          typedef allocator< std::pair<const id_type, value_type> > id_value_allocator_type;
          typedef allocator< id_type >                              id_allocator_type;
 
+         /// Index of a word of the object and its value before the session
+         typedef std::pair< uint32_t, uint64_t >                                       delta_word;
+         typedef boost::interprocess::vector< delta_word, allocator< delta_word > >    delta_type;
+         typedef allocator< std::pair<const id_type, delta_type> >                    id_delta_allocator_type;
+
+         /// Index of a delta_undo_members member of the object and its contents before the session
+         typedef std::pair< uint32_t, t_vector< char > >                                  delta_member;
+         typedef boost::interprocess::vector< delta_member, allocator< delta_member > >  delta_members_type;
+         typedef allocator< std::pair<const id_type, delta_members_type> >               id_members_allocator_type;
+
          template<typename T>
          undo_state( allocator<T> al )
          :old_values( id_value_allocator_type( al ) ),
+          old_deltas( id_delta_allocator_type( al ) ),
+          old_members( id_members_allocator_type( al ) ),
           removed_values( id_value_allocator_type( al ) ),
           new_ids( id_allocator_type( al ) ){}
 
          typedef boost::interprocess::map< id_type, value_type, std::less<id_type>, id_value_allocator_type >  id_value_type_map;
+         typedef boost::interprocess::map< id_type, delta_type, std::less<id_type>, id_delta_allocator_type >  id_delta_map;
+         typedef boost::interprocess::map< id_type, delta_members_type, std::less<id_type>, id_members_allocator_type >  id_members_map;
          typedef boost::interprocess::set< id_type, std::less<id_type>, id_allocator_type >                    id_type_set;
 
          id_value_type_map            old_values;
+         id_delta_map                 old_deltas; ///< used instead of old_values when use_delta_undo< value_type >
+         id_members_map               old_members; ///< the changed delta_undo_members of objects undone from old_deltas
          id_value_type_map            removed_values;
          id_type_set                  new_ids;
          id_type                      old_next_id = 0;
@@ -202,9 +278,14 @@ namespace chainbase {
          typedef typename index_type::value_type                       value_type;
          typedef allocator< generic_index >                            allocator_type;
          typedef undo_state< value_type >                              undo_state_type;
+         typedef typename undo_state_type::delta_type                  delta_type;
+         typedef typename undo_state_type::delta_members_type          delta_members_type;
 
          generic_index( allocator<value_type> a )
-         :_stack(a),_indices( a ),_size_of_value_type( sizeof(typename MultiIndexType::node_type) ),_size_of_this(sizeof(*this)){}
+         :_stack(a),
+          _pool( sizeof(typename MultiIndexType::final_node_type) ),
+          _indices( make_index_allocator( a, (typename index_type::allocator_type*)nullptr ) ),
+          _size_of_value_type( sizeof(typename MultiIndexType::node_type) ),_size_of_this(sizeof(*this)){}
 
          void validate()const {
             if( sizeof(typename MultiIndexType::node_type) != _size_of_value_type || sizeof(*this) != _size_of_this )
@@ -237,9 +318,7 @@ namespace chainbase {
 
          template<typename Modifier>
          void modify( const value_type& obj, Modifier&& m ) {
-            on_modify( obj );
-            auto ok = _indices.modify( _indices.iterator_to( obj ), m );
-            if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
+            modify( obj, m, use_delta_undo< value_type >() );
          }
 
          void remove( const value_type& obj ) {
@@ -314,6 +393,7 @@ namespace chainbase {
 
          const index_type& indicies()const { return _indices; }
          int64_t revision()const { return _revision; }
+         const node_pool& get_node_pool()const { return _pool; }
 
 
          /**
@@ -332,6 +412,27 @@ namespace chainbase {
                if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
             }
 
+            // The words and members of an object are restored together, either alone may not be unique
+            for( const auto& item : head.old_deltas ) {
+               auto members = head.old_members.find( item.first );
+               auto ok = _indices.modify( _indices.find( item.first ), [&]( value_type& v ) {
+                  apply_delta( v, item.second );
+                  if( members != head.old_members.end() )
+                     restore_members( v, members->second );
+               });
+               if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
+            }
+
+            for( const auto& item : head.old_members ) {
+               if( head.old_deltas.count( item.first ) )
+                  continue;
+
+               auto ok = _indices.modify( _indices.find( item.first ), [&]( value_type& v ) {
+                  restore_members( v, item.second );
+               });
+               if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
+            }
+
             for( const auto& id : head.new_ids )
             {
                _indices.erase( _indices.find( id ) );
@@ -424,6 +525,43 @@ namespace chainbase {
                prev_state.old_values.emplace( std::move(item) );
             }
 
+            // The same for objects undone from deltas, upd(was=X) + upd(was=Y) keeps the words of X and
+            // adds the words of Y that X did not change, they still have the value they had before A
+            for( auto& item : state.old_deltas )
+            {
+               if( prev_state.new_ids.find( item.first ) != prev_state.new_ids.end() )
+                  continue;
+
+               auto it = prev_state.old_deltas.find( item.first );
+               if( it != prev_state.old_deltas.end() )
+               {
+                  for( const auto& word : item.second )
+                     add_delta_word( it->second, word.first, word.second );
+                  continue;
+               }
+
+               assert( prev_state.removed_values.find( item.first ) == prev_state.removed_values.end() );
+               prev_state.old_deltas.emplace( std::move( item ) );
+            }
+
+            // Members are merged like the words
+            for( auto& item : state.old_members )
+            {
+               if( prev_state.new_ids.find( item.first ) != prev_state.new_ids.end() )
+                  continue;
+
+               auto it = prev_state.old_members.find( item.first );
+               if( it != prev_state.old_members.end() )
+               {
+                  for( const auto& member : item.second )
+                     add_delta_member( it->second, member.first, member.second );
+                  continue;
+               }
+
+               assert( prev_state.removed_values.find( item.first ) == prev_state.removed_values.end() );
+               prev_state.old_members.emplace( std::move( item ) );
+            }
+
             // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
             for( const auto& id : state.new_ids )
                prev_state.new_ids.insert(id);
@@ -445,6 +583,24 @@ namespace chainbase {
                   prev_state.old_values.erase(obj.second.id);
                   continue;
                }
+               auto dit = prev_state.old_deltas.find(obj.second.id);
+               auto mit = prev_state.old_members.find(obj.second.id);
+               if( dit != prev_state.old_deltas.end() || mit != prev_state.old_members.end() )
+               {
+                  // upd(was=X) + del(was=Y) -> del(was=X), X is Y with the delta of A applied
+                  if( dit != prev_state.old_deltas.end() )
+                  {
+                     apply_delta( obj.second, dit->second );
+                     prev_state.old_deltas.erase( dit );
+                  }
+                  if( mit != prev_state.old_members.end() )
+                  {
+                     restore_members( obj.second, mit->second );
+                     prev_state.old_members.erase( mit );
+                  }
+                  prev_state.removed_values.emplace( std::move(obj) );
+                  continue;
+               }
                // del + del -> N/A
                assert( prev_state.removed_values.find( obj.second.id ) == prev_state.removed_values.end() );
                // nop + del(was=Y) -> del(was=Y)
@@ -484,6 +640,233 @@ namespace chainbase {
       private:
          bool enabled()const { return _stack.size(); }
 
+         /** Indices declared with node_allocator allocate their nodes from the pool of the index */
+         template< typename Allocator >
+         Allocator make_index_allocator( const allocator<value_type>& a, Allocator* ) {
+            return Allocator( a );
+         }
+
+#ifndef ENABLE_STD_ALLOCATOR
+         node_allocator<value_type> make_index_allocator( const allocator<value_type>& a, node_allocator<value_type>* ) {
+            return node_allocator<value_type>( a, &_pool );
+         }
+#endif
+
+         template<typename Modifier>
+         void modify( const value_type& obj, Modifier& m, std::false_type ) {
+            on_modify( obj );
+            auto ok = _indices.modify( _indices.iterator_to( obj ), m );
+            if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
+         }
+
+         /// Contents of each delta_undo_members member, by index
+         typedef std::vector< std::pair< uint32_t, std::vector< char > > > saved_members_type;
+
+         template<typename Modifier>
+         void modify( const value_type& obj, Modifier& m, std::true_type ) {
+            static_assert( std::is_trivially_copyable< value_type >::value || delta_undo_members< value_type >::value,
+               "objects undone from deltas without delta_undo_members must not own memory, such as strings and vectors" );
+
+            if( !enabled() || _stack.back().new_ids.count( obj.id ) ) {
+               modify( obj, m, std::false_type() );
+               return;
+            }
+
+            typename std::aligned_storage< sizeof( value_type ), alignof( value_type ) >::type before_storage;
+            memcpy( &before_storage, &obj, sizeof( value_type ) );
+            const value_type& before = *reinterpret_cast< const value_type* >( &before_storage );
+            saved_members_type saved_members;
+            delta_undo_members< value_type >::visit( obj, member_saver{ saved_members } );
+
+            // A modify that fails is rolled back and the object removed, so that it is undone as a removal.
+            // The modifier must not throw out of the index, that erases the object without a rollback.
+            auto rollback = [&]( value_type& v ) {
+               for( uint32_t i = 0; i < num_delta_words; ++i )
+                  store_delta_word( v, i, load_delta_word( before, i ) );
+               restore_members( v, saved_members );
+            };
+            std::exception_ptr error;
+            auto modifier = [&]( value_type& v ) {
+               try {
+                  m( v );
+               } catch( ... ) {
+                  error = std::current_exception();
+                  rollback( v );
+               }
+            };
+
+            auto ok = _indices.modify( _indices.iterator_to( obj ), modifier, rollback );
+            if( error || !ok ) {
+               remove( obj );
+               if( error )
+                  std::rethrow_exception( error );
+               BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
+            }
+
+            on_modify_delta( before, saved_members, obj );
+         }
+
+         static const uint32_t num_delta_words = ( sizeof( value_type ) + sizeof( uint64_t ) - 1 ) / sizeof( uint64_t );
+
+         typedef std::array< uint64_t, num_delta_words > delta_masks_type;
+
+         /** The bytes of each word that are not part of a delta_undo_members member */
+         static const delta_masks_type& delta_masks( const value_type& v ) {
+            static const delta_masks_type masks = make_delta_masks( v );
+            return masks;
+         }
+
+         static delta_masks_type make_delta_masks( const value_type& v ) {
+            char bytes[ sizeof( delta_masks_type ) ];
+            memset( bytes, 0xff, sizeof( bytes ) );
+            delta_undo_members< value_type >::visit( v, member_masker{ bytes, reinterpret_cast< const char* >( &v ) } );
+
+            delta_masks_type masks;
+            memcpy( masks.data(), bytes, sizeof( bytes ) );
+            return masks;
+         }
+
+         static uint64_t load_delta_word( const value_type& v, uint32_t i ) {
+            uint64_t word = 0;
+            size_t offset = i * sizeof( uint64_t );
+            memcpy( &word, reinterpret_cast< const char* >( &v ) + offset, std::min( sizeof( uint64_t ), sizeof( value_type ) - offset ) );
+            return word;
+         }
+
+         /** Writes the bytes of word i that are not part of a member, the members keep their memory */
+         static void store_delta_word( value_type& v, uint32_t i, uint64_t word ) {
+            uint64_t mask = delta_masks( v )[ i ];
+            if( mask != ~uint64_t( 0 ) )
+               word = ( load_delta_word( v, i ) & ~mask ) | ( word & mask );
+
+            size_t offset = i * sizeof( uint64_t );
+            memcpy( reinterpret_cast< char* >( &v ) + offset, &word, std::min( sizeof( uint64_t ), sizeof( value_type ) - offset ) );
+         }
+
+         static void apply_delta( value_type& v, const delta_type& delta ) {
+            for( const auto& word : delta )
+               store_delta_word( v, word.first, word.second );
+         }
+
+         template< typename Members >
+         static void restore_members( value_type& v, const Members& members ) {
+            delta_undo_members< value_type >::visit( v, member_restorer< Members >{ members } );
+         }
+
+         /** Records the value of word i before the session, unless the delta already has it */
+         static void add_delta_word( delta_type& delta, uint32_t i, uint64_t word ) {
+            auto itr = std::lower_bound( delta.begin(), delta.end(), i,
+               []( const typename delta_type::value_type& w, uint32_t idx ) { return w.first < idx; } );
+            if( itr == delta.end() || itr->first != i )
+               delta.emplace( itr, i, word );
+         }
+
+         /** Records the contents of member i before the session, unless the members already have it */
+         template< typename Bytes >
+         static void add_delta_member( delta_members_type& members, uint32_t i, const Bytes& bytes ) {
+            auto itr = std::lower_bound( members.begin(), members.end(), i,
+               []( const typename delta_members_type::value_type& m, uint32_t idx ) { return m.first < idx; } );
+            if( itr == members.end() || itr->first != i )
+               members.emplace( itr, i, t_vector< char >( bytes.begin(), bytes.end(), members.get_allocator() ) );
+         }
+
+         /**
+          *  Words that were not changed earlier in the session still have their value from before the
+          *  session, so the words changed by this modify are added with their value in before. The
+          *  same goes for the members.
+          */
+         void on_modify_delta( const value_type& before, const saved_members_type& saved_members, const value_type& after ) {
+            auto& head = _stack.back();
+            const auto& masks = delta_masks( after );
+            delta_type* delta = nullptr;
+
+            for( uint32_t i = 0; i < num_delta_words; ++i ) {
+               uint64_t word = load_delta_word( before, i );
+               if( ( ( word ^ load_delta_word( after, i ) ) & masks[ i ] ) == 0 )
+                  continue;
+
+               if( delta == nullptr ) {
+                  auto itr = head.old_deltas.find( after.id );
+                  if( itr == head.old_deltas.end() )
+                     itr = head.old_deltas.emplace( after.id, delta_type( _indices.get_allocator() ) ).first;
+                  delta = &itr->second;
+               }
+
+               add_delta_word( *delta, i, word );
+            }
+
+            delta_undo_members< value_type >::visit( after, member_recorder{ *this, after.id, saved_members } );
+         }
+
+         void on_modify_member( typename value_type::id_type id, uint32_t i, const std::vector< char >& bytes ) {
+            auto& head = _stack.back();
+            auto itr = head.old_members.find( id );
+            if( itr == head.old_members.end() )
+               itr = head.old_members.emplace( id, delta_members_type( _indices.get_allocator() ) ).first;
+            add_delta_member( itr->second, i, bytes );
+         }
+
+         template< typename Member >
+         static const char* member_data( const Member& m ) {
+            static_assert( is_delta_undo_element< typename Member::value_type >::value,
+               "delta_undo_members must be strings or vectors of elements that can be copied byte for byte" );
+            return reinterpret_cast< const char* >( m.data() );
+         }
+
+         template< typename Member >
+         static size_t member_size( const Member& m ) {
+            return m.size() * sizeof( typename Member::value_type );
+         }
+
+         struct member_masker {
+            char*       masks;
+            const char* object;
+
+            template< typename Member >
+            void operator()( uint32_t, const Member& m )const {
+               memset( masks + ( reinterpret_cast< const char* >( &m ) - object ), 0, sizeof( Member ) );
+            }
+         };
+
+         struct member_saver {
+            saved_members_type& saved;
+
+            template< typename Member >
+            void operator()( uint32_t i, const Member& m )const {
+               const char* data = member_data( m );
+               saved.emplace_back( i, std::vector< char >( data, data + member_size( m ) ) );
+            }
+         };
+
+         template< typename Members >
+         struct member_restorer {
+            const Members& members;
+
+            template< typename Member >
+            void operator()( uint32_t i, Member& m )const {
+               typedef typename Member::value_type element_type;
+               for( const auto& saved : members ) {
+                  if( saved.first != i )
+                     continue;
+                  const element_type* first = reinterpret_cast< const element_type* >( saved.second.data() );
+                  m.assign( first, first + saved.second.size() / sizeof( element_type ) );
+               }
+            }
+         };
+
+         struct member_recorder {
+            generic_index&                 index;
+            typename value_type::id_type   id;
+            const saved_members_type&      saved;
+
+            template< typename Member >
+            void operator()( uint32_t i, const Member& m )const {
+               const auto& bytes = saved[ i ].second;
+               if( bytes.size() != member_size( m ) || ( bytes.size() && memcmp( bytes.data(), member_data( m ), bytes.size() ) != 0 ) )
+                  index.on_modify_member( id, i, bytes );
+            }
+         };
+
          void on_modify( const value_type& v ) {
             if( !enabled() ) return;
 
@@ -515,6 +898,21 @@ namespace chainbase {
                return;
             }
 
+            auto ditr = head.old_deltas.find( v.id );
+            auto mitr = head.old_members.find( v.id );
+            if( ditr != head.old_deltas.end() || mitr != head.old_members.end() ) {
+               auto removed = head.removed_values.emplace( std::pair< typename value_type::id_type, const value_type& >( v.id, v ) ).first;
+               if( ditr != head.old_deltas.end() ) {
+                  apply_delta( removed->second, ditr->second );
+                  head.old_deltas.erase( ditr );
+               }
+               if( mitr != head.old_members.end() ) {
+                  restore_members( removed->second, mitr->second );
+                  head.old_members.erase( mitr );
+               }
+               return;
+            }
+
             if( head.removed_values.count( v.id ) )
                return;
 
@@ -538,6 +936,7 @@ namespace chainbase {
           */
          int64_t                         _revision = 0;
          typename value_type::id_type    _next_id = 0;
+         node_pool                       _pool;
          index_type                      _indices;
          uint32_t                        _size_of_value_type = 0;
          uint32_t                        _size_of_this = 0;
@@ -626,7 +1025,10 @@ namespace chainbase {
          {
             typedef typename BaseIndex::index_type index_type;
             helpers::index_statistic_provider<index_type> provider;
-            return provider.gather_statistics(_base.indices(), onlyStaticInfo);
+            statistic_info info = provider.gather_statistics(_base.indices(), onlyStaticInfo);
+            info._pool_reserved = _base.get_node_pool().reserved_size();
+            info._pool_free = _base.get_node_pool().free_size();
+            return info;
          }
          virtual size_t size() const override final
             { return _base.indicies().size(); }
@@ -706,11 +1108,71 @@ namespace chainbase {
          };
 
       public:
+         /**
+          *  Flags for open() that control how the shared memory file is mapped. They only apply
+          *  on Linux and, except for lock_memory, are hints that are skipped with a warning when
+          *  the system does not support them.
+          */
+         enum open_flags
+         {
+            /// Advise the kernel to back the mapping with transparent huge pages
+            huge_pages        = 1 << 0,
+            /// Fault in the whole file on open instead of on first access
+            prefault          = 1 << 1,
+            /// Lock the whole file in memory, fails the open when the memlock limit is too low
+            lock_memory       = 1 << 2,
+            /// Interleave the pages of the file over all NUMA nodes, faults in the whole file on open
+            numa_interleave   = 1 << 3
+         };
+
+         ~database();
+
+         /**
+          *  Opening the file marks it as in use, close() writes it back and marks it closed. When
+          *  the file is still marked in use on open, the previous process did not close it. After
+          *  a process crash the page cache still holds every change, but when the system was
+          *  restarted since then changes may have been lost and open() throws.
+          */
          void open( const bfs::path& dir, uint32_t flags = 0, size_t shared_file_size = 0 );
          void close();
          void flush();
+
+         /** True when the file was not closed by the process that last opened it */
+         bool opened_after_crash()const { return _opened_after_crash; }
+
+         /**
+          *  Writes the shared memory file back to disk from a background thread, one chunk at a
+          *  time and at most bytes_per_second of the file per second. Keeping the dirty part of
+          *  the file small bounds the time close() and flush() spend writing. Can be called before
+          *  open(), 0 stops the background flush.
+          */
+         void set_background_flush( size_t bytes_per_second, size_t chunk_size = 16*1024*1024 );
+         size_t background_flush_rate()const { return _flush_rate; }
+
+         /**
+          *  Writes a copy of the shared memory file to dir that opens like a file closed at the
+          *  current revision. Nothing may write to the database meanwhile, so the copy has to be
+          *  a clone of the file. Unless allow_copy is set, this throws when the file system does
+          *  not support reflinks instead of stalling the writer with a full copy.
+          */
+         void checkpoint( const bfs::path& dir, bool allow_copy = false );
+
+         /** True when files in from_dir can be cloned into to_dir, as checkpoint() requires */
+         static bool can_clone( const bfs::path& from_dir, const bfs::path& to_dir );
+
+         /** Replaces the shared memory file in dir with the one in checkpoint_dir, dir must not be open */
+         static void restore_checkpoint( const bfs::path& checkpoint_dir, const bfs::path& dir );
          void wipe( const bfs::path& dir );
          void resize( size_t new_shared_file_size );
+
+         /**
+          *  Grows the shared memory file without remapping it. The file is mapped at the start of
+          *  a reserved range of address space and is extended into that range, so every object
+          *  keeps its address and undo sessions stay valid.
+          *
+          *  Returns false when the file cannot grow in place, resize() is then the only option.
+          */
+         bool grow( size_t new_shared_file_size );
          void set_require_locking( bool enable_require_locking );
 
 #ifdef CHAINBASE_CHECK_LOCKING
@@ -833,6 +1295,11 @@ namespace chainbase {
             return _file_size;
          }
 
+         size_t get_reserved_memory()const
+         {
+            return _reserved_size;
+         }
+
          template<typename MultiIndexType>
          bool has_index()const
          {
@@ -1081,7 +1548,43 @@ namespace chainbase {
          unique_ptr<bip::managed_mapped_file>                        _segment;
          unique_ptr<bip::managed_mapped_file>                        _meta;
          bip::file_lock                                              _flock;
+
+         void* reserve_address_space( size_t size );
+         void  release_address_space();
+         void  apply_mapping_options( char* begin, size_t size );
+
+         void  sync_range( char* begin, size_t size );
+         void  mark_open();
+         void  mark_closed();
+         void  start_background_flush();
+         void  stop_background_flush();
+         void  background_flush_loop();
+
+         /**
+          * Address space the shared memory file can grow into. Only the first _mapped_size bytes
+          * are mapped by _segment, grow() maps the rest of the file itself through _segment_fd.
+          */
+         char*                                                       _reserved_base = nullptr;
+         size_t                                                      _mapped_size = 0;
+         int                                                         _segment_fd = -1;
+
+         /**
+          * Start of the mapping and the number of bytes of it the background flush writes back,
+          * the size is only raised once grow() has mapped the new part of the file.
+          */
+         char*                                                       _flush_base = nullptr;
+         std::atomic< size_t >                                       _flush_size{ 0 };
+         std::thread                                                 _flush_thread;
+         std::mutex                                                  _flush_mutex;
+         std::condition_variable                                     _flush_cv;
+         bool                                                        _flush_stop = false;
 #endif
+         size_t                                                      _flush_rate = 0;
+         size_t                                                      _flush_chunk = 0;
+         bool                                                        _opened_after_crash = false;
+         size_t                                                      _reserved_size = 0;
+         size_t                                                      _page_size = 1;
+         uint32_t                                                    _flags = 0;
 
          /**
           * This is a sparse list of known indicies kept to accelerate creation of undo sessions
@@ -1106,6 +1609,6 @@ namespace chainbase {
    };
 
    template<typename Object, typename... Args>
-   using shared_multi_index_container = boost::multi_index_container<Object,Args..., chainbase::allocator<Object> >;
+   using shared_multi_index_container = boost::multi_index_container<Object,Args..., chainbase::node_allocator<Object> >;
 }  // namepsace chainbase
 
@@ -1,10 +1,100 @@
 #include <chainbase/chainbase.hpp>
 #include <boost/array.hpp>
 
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <sstream>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/vfs.h>
+
+#define hugetlbfs_magic 0x958458f6
+#define mpol_default    0
+#define mpol_interleave 3
+/// Node mask size for get_mempolicy, at least the number of nodes the kernel supports
+#define mpol_max_nodes  4096
+#endif
 
 namespace chainbase {
 
+   /**
+    * Address space reserved for the shared memory file. The reservation is not backed by memory,
+    * it only keeps the range free so the file can be extended in place.
+    */
+   static const size_t reserved_address_space = size_t( 1 ) << 40;
+
+   static size_t round_to_page( size_t size, size_t page_size )
+   {
+      return ( ( size + page_size - 1 ) / page_size ) * page_size;
+   }
+
+   /**
+    * Page size of the file system holding the shared memory file. Files on hugetlbfs can only be
+    * sized and mapped in multiples of the huge page size.
+    */
+   static size_t file_page_size( const bfs::path& dir )
+   {
+#ifndef WIN32
+#ifdef __linux__
+      struct statfs fs;
+      if( statfs( dir.generic_string().c_str(), &fs ) == 0 && fs.f_type == hugetlbfs_magic )
+         return fs.f_bsize;
+#endif
+      return sysconf( _SC_PAGESIZE );
+#else
+      return 1;
+#endif
+   }
+
+#ifdef __linux__
+   /**
+    * Mask of the online NUMA nodes as expected by set_mempolicy, empty when there is only one node
+    */
+   static std::vector< unsigned long > online_numa_nodes()
+   {
+      std::vector< unsigned long > mask;
+      std::ifstream online( "/sys/devices/system/node/online" );
+      std::string ranges;
+      if( !( online >> ranges ) )
+         return mask;
+
+      // The file holds a list of ranges such as "0-3,8"
+      uint32_t nodes = 0;
+      std::stringstream ss( ranges );
+      std::string range;
+      while( std::getline( ss, range, ',' ) )
+      {
+         auto dash = range.find( '-' );
+         unsigned long first = std::stoul( range.substr( 0, dash ) );
+         unsigned long last = dash == std::string::npos ? first : std::stoul( range.substr( dash + 1 ) );
+         for( unsigned long node = first; node <= last; ++node, ++nodes )
+         {
+            size_t word = node / ( 8 * sizeof( unsigned long ) );
+            if( mask.size() <= word )
+               mask.resize( word + 1, 0 );
+            mask[ word ] |= 1ul << ( node % ( 8 * sizeof( unsigned long ) ) );
+         }
+      }
+
+      if( nodes < 2 )
+         mask.clear();
+      return mask;
+   }
+#endif
+
    struct environment_check {
       environment_check() {
          memset( &compiler_version, 0, sizeof( compiler_version ) );
@@ -30,15 +120,130 @@ namespace chainbase {
       bool                    windows = false;
    };
 
+   typedef boost::array< char, 40 > boot_id_type;
+
+   /**
+    * Identifies the running system boot, all zero when it is not known
+    */
+   static boot_id_type current_boot_id()
+   {
+      boot_id_type id;
+      id.fill( 0 );
+#ifdef __linux__
+      std::ifstream file( "/proc/sys/kernel/random/boot_id" );
+      std::string line;
+      if( std::getline( file, line ) )
+         memcpy( id.data(), line.data(), std::min( line.size(), id.size() - 1 ) );
+#endif
+      return id;
+   }
+
+   /**
+    * Written back on its own right after open and after everything else on close, so the file on
+    * disk is only marked closed when it holds the complete state.
+    */
+   struct flush_marker {
+      flush_marker() { boot_id.fill( 0 ); }
+
+      bool                    closed = true;
+      int64_t                 revision = -1;
+      boot_id_type            boot_id;
+   };
+
+   /**
+    * Writes the file at from to to through a temporary file, so to is either the old or the
+    * complete new file. Returns true when the file was cloned instead of copied, throws when it
+    * cannot be cloned and allow_copy is false.
+    */
+   static bool clone_file( const bfs::path& from, const bfs::path& to, bool allow_copy = true )
+   {
+      auto tmp = to;
+      tmp += ".tmp";
+      bool cloned = false;
+
+#ifdef __linux__
+      int in = ::open( from.generic_string().c_str(), O_RDONLY );
+      if( in < 0 )
+         BOOST_THROW_EXCEPTION( std::runtime_error( "could not open " + from.generic_string() + ": " + strerror( errno ) ) );
+      int out = ::open( tmp.generic_string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+      if( out < 0 )
+      {
+         ::close( in );
+         BOOST_THROW_EXCEPTION( std::runtime_error( "could not create " + tmp.generic_string() + ": " + strerror( errno ) ) );
+      }
+
+      bool ok = true;
+#ifdef FICLONE
+      cloned = ioctl( out, FICLONE, in ) == 0;
+#endif
+      if( !cloned && !allow_copy )
+      {
+         std::string error = strerror( errno );
+         ::close( in );
+         ::close( out );
+         bfs::remove( tmp );
+         BOOST_THROW_EXCEPTION( std::runtime_error( "could not clone " + from.generic_string() + ": " + error ) );
+      }
+      if( !cloned )
+      {
+         struct stat st;
+         ok = fstat( in, &st ) == 0;
+         off_t offset = 0;
+         while( ok && offset < st.st_size )
+         {
+            ssize_t sent = sendfile( out, in, &offset, st.st_size - offset );
+            ok = sent > 0;
+         }
+      }
+      ok = ok && fsync( out ) == 0;
+      std::string error = strerror( errno );
+      ::close( in );
+      ::close( out );
+      if( !ok )
+      {
+         bfs::remove( tmp );
+         BOOST_THROW_EXCEPTION( std::runtime_error( "could not copy " + from.generic_string() + ": " + error ) );
+      }
+#else
+      if( !allow_copy )
+         BOOST_THROW_EXCEPTION( std::runtime_error( "could not clone " + from.generic_string() + ": not supported" ) );
+      bfs::copy_file( from, tmp, bfs::copy_option::overwrite_if_exists );
+#endif
+
+      bfs::rename( tmp, to );
+#ifndef WIN32
+      int dir = ::open( to.parent_path().generic_string().c_str(), O_RDONLY );
+      if( dir >= 0 )
+      {
+         if( fsync( dir ) != 0 ) {}
+         ::close( dir );
+      }
+#endif
+      return cloned;
+   }
+
+   database::~database()
+   {
+      close();
+   }
+
    void database::open( const bfs::path& dir, uint32_t flags, size_t shared_file_size )
    {
       bfs::create_directories( dir );
       if( _data_dir != dir ) close();
 
       _data_dir = dir;
+      _flags = flags;
 
 #ifndef ENABLE_STD_ALLOCATOR
+      stop_background_flush();
+      _segment.reset();
+      _meta.reset();
+      release_address_space();
+
       auto abs_path = bfs::absolute( dir / "shared_memory.bin" );
+      _page_size = file_page_size( dir );
+      shared_file_size = round_to_page( shared_file_size, _page_size );
 
       if( bfs::exists( abs_path ) )
       {
@@ -51,9 +256,23 @@ namespace chainbase {
             _file_size = shared_file_size;
          }
 
-         _segment.reset( new bip::managed_mapped_file( bip::open_only,
-                                                       abs_path.generic_string().c_str()
-                                                       ) );
+         void* addr = reserve_address_space( _file_size );
+         try
+         {
+            _segment.reset( new bip::managed_mapped_file( bip::open_only,
+                                                          abs_path.generic_string().c_str(),
+                                                          addr
+                                                          ) );
+         }
+         catch( const bip::interprocess_exception& )
+         {
+            // The range was taken between reserving and mapping it, fall back to a movable mapping
+            if( !addr ) throw;
+            release_address_space();
+            _segment.reset( new bip::managed_mapped_file( bip::open_only,
+                                                          abs_path.generic_string().c_str()
+                                                          ) );
+         }
 
          auto env = _segment->find< environment_check >( "environment" );
          if( !env.first || !( *env.first == environment_check()) ) {
@@ -61,15 +280,47 @@ namespace chainbase {
          }
       } else {
          _file_size = shared_file_size;
-         _segment.reset( new bip::managed_mapped_file( bip::create_only,
-                                                       abs_path.generic_string().c_str(), shared_file_size
-                                                       ) );
+         void* addr = reserve_address_space( _file_size );
+         try
+         {
+            _segment.reset( new bip::managed_mapped_file( bip::create_only,
+                                                          abs_path.generic_string().c_str(), shared_file_size,
+                                                          addr
+                                                          ) );
+         }
+         catch( const bip::interprocess_exception& )
+         {
+            if( !addr ) throw;
+            release_address_space();
+            bfs::remove( abs_path );
+            _segment.reset( new bip::managed_mapped_file( bip::create_only,
+                                                          abs_path.generic_string().c_str(), shared_file_size
+                                                          ) );
+         }
          _segment->find_or_construct< environment_check >( "environment" )();
       }
 
+      _mapped_size = _file_size;
+
+      // The segment starts right after a small header of the mapping, the mapping itself is page aligned
+      char* mapping = (char*)_segment->get_address();
+      mapping -= uintptr_t( mapping ) % _page_size;
+      apply_mapping_options( mapping, _file_size );
+      _flush_base = mapping;
+      _flush_size = _file_size;
+
+#ifndef WIN32
+      // Kept open until the database is closed, closing any descriptor of the file drops the lock below
+      if( _reserved_base )
+         _segment_fd = ::open( abs_path.generic_string().c_str(), O_RDWR );
+#endif
+
       _flock = bip::file_lock( abs_path.generic_string().c_str() );
       if( !_flock.try_lock() )
          BOOST_THROW_EXCEPTION( std::runtime_error( "could not gain write access to the shared memory file" ) );
+
+      mark_open();
+      start_background_flush();
 #endif
    }
 
@@ -77,6 +328,12 @@ namespace chainbase {
 #ifndef ENABLE_STD_ALLOCATOR
       if( _segment )
          _segment->flush();
+#ifndef WIN32
+      // _segment only flushes the part of the file it mapped itself
+      size_t grown_begin = round_to_page( _mapped_size, _page_size );
+      if( _segment && _reserved_base && _file_size > grown_begin )
+         msync( _reserved_base + grown_begin, _file_size - grown_begin, MS_ASYNC );
+#endif
       if( _meta )
          _meta->flush();
 #endif
@@ -85,8 +342,12 @@ namespace chainbase {
    void database::close()
    {
 #ifndef ENABLE_STD_ALLOCATOR
+      stop_background_flush();
+      if( _segment )
+         mark_closed();
       _segment.reset();
       _meta.reset();
+      release_address_space();
       _data_dir = bfs::path();
 #endif
    }
@@ -94,8 +355,10 @@ namespace chainbase {
    void database::wipe( const bfs::path& dir )
    {
 #ifndef ENABLE_STD_ALLOCATOR
+      stop_background_flush();
       _segment.reset();
       _meta.reset();
+      release_address_space();
       bfs::remove_all( dir / "shared_memory.bin" );
       bfs::remove_all( dir / "shared_memory.meta" );
       _data_dir = bfs::path();
@@ -109,10 +372,17 @@ namespace chainbase {
       if( _undo_session_count )
          BOOST_THROW_EXCEPTION( std::runtime_error( "Cannot resize shared memory file while undo session is active" ) );
 
+#ifndef ENABLE_STD_ALLOCATOR
+      stop_background_flush();
       _segment.reset();
       _meta.reset();
+      release_address_space();
+#endif
 
-      open( _data_dir, 0, new_shared_file_size );
+      // The file was not closed in between, it is still marked open
+      bool opened_after_crash = _opened_after_crash;
+      open( _data_dir, _flags, new_shared_file_size );
+      _opened_after_crash = opened_after_crash;
 
       _index_list.clear();
       _index_map.clear();
@@ -123,6 +393,317 @@ namespace chainbase {
       }
    }
 
+   bool database::grow( size_t new_shared_file_size )
+   {
+#if !defined( ENABLE_STD_ALLOCATOR ) && !defined( WIN32 )
+      new_shared_file_size = round_to_page( new_shared_file_size, _page_size );
+      if( new_shared_file_size <= _file_size )
+         return true;
+
+      if( !_segment || !_reserved_base || _segment_fd < 0 || new_shared_file_size > _reserved_size )
+         return false;
+
+      if( ::ftruncate( _segment_fd, new_shared_file_size ) != 0 )
+         return false;
+
+      // Only the reserved range past the pages that are already mapped is replaced
+      size_t map_begin = round_to_page( _file_size, _page_size );
+      if( new_shared_file_size > map_begin )
+      {
+         void* addr = mmap( _reserved_base + map_begin, new_shared_file_size - map_begin,
+                            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, _segment_fd, map_begin );
+         if( addr == MAP_FAILED )
+         {
+            if( ::ftruncate( _segment_fd, _file_size ) != 0 ) {}
+            return false;
+         }
+
+         apply_mapping_options( _reserved_base + map_begin, new_shared_file_size - map_begin );
+      }
+
+      _segment->get_segment_manager()->grow( new_shared_file_size - _file_size );
+      _file_size = new_shared_file_size;
+      _flush_size = _file_size;
+      return true;
+#else
+      return false;
+#endif
+   }
+
+#ifndef ENABLE_STD_ALLOCATOR
+   void* database::reserve_address_space( size_t size )
+   {
+      release_address_space();
+
+#ifndef WIN32
+      size = round_to_page( size, _page_size );
+      size_t reserve_size = std::max( size, reserved_address_space );
+
+      // Huge page mappings have to start on a huge page boundary, reserve enough to align the base
+      size_t align = _page_size > size_t( sysconf( _SC_PAGESIZE ) ) ? _page_size : 0;
+      void* base = mmap( nullptr, reserve_size + align, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+      if( base == MAP_FAILED )
+         return nullptr;
+
+      if( align )
+      {
+         size_t skip = ( _page_size - uintptr_t( base ) % _page_size ) % _page_size;
+         if( skip )
+            munmap( base, skip );
+         if( align - skip )
+            munmap( (char*)base + skip + reserve_size, align - skip );
+         base = (char*)base + skip;
+      }
+
+      // The file is mapped by _segment at the start of the range, the rest stays reserved
+      munmap( base, size );
+
+      _reserved_base = (char*)base;
+      _reserved_size = reserve_size;
+      return base;
+#else
+      return nullptr;
+#endif
+   }
+
+   void database::apply_mapping_options( char* begin, size_t size )
+   {
+#ifdef __linux__
+      if( !size )
+         return;
+
+      // Placement has to be decided before the pages are first touched
+      if( ( _flags & huge_pages ) && madvise( begin, size, MADV_HUGEPAGE ) != 0 )
+         std::cerr << "Could not enable huge pages for the shared memory file: " << strerror( errno ) << "\n";
+
+      // mbind() is ignored for shared file mappings, their pages are placed by the policy of the
+      // thread that faults them in. The file is faulted in here under an interleave policy, pages
+      // that are already in the page cache stay where they are.
+      bool interleaving = false;
+      int old_policy = mpol_default;
+      std::vector< unsigned long > old_nodes( mpol_max_nodes / ( 8 * sizeof( unsigned long ) ), 0 );
+      if( _flags & numa_interleave )
+      {
+         auto nodes = online_numa_nodes();
+         if( nodes.size() )
+         {
+            if( syscall( SYS_get_mempolicy, &old_policy, old_nodes.data(), mpol_max_nodes, nullptr, 0 ) != 0 )
+               old_policy = mpol_default;
+            interleaving = syscall( SYS_set_mempolicy, mpol_interleave, nodes.data(), nodes.size() * 8 * sizeof( unsigned long ) + 1 ) == 0;
+            if( !interleaving )
+               std::cerr << "Could not interleave the shared memory file over NUMA nodes: " << strerror( errno ) << "\n";
+         }
+      }
+
+      int lock_error = 0;
+      if( _flags & lock_memory )
+      {
+         if( mlock( begin, size ) != 0 )
+            lock_error = errno;
+      }
+      else if( _flags & ( prefault | numa_interleave ) )
+      {
+         // Populating for write would dirty every page of the file and write all of it back to disk
+         bool populated = false;
+#ifdef MADV_POPULATE_READ
+         populated = madvise( begin, size, MADV_POPULATE_READ ) == 0;
+#endif
+         if( !populated )
+         {
+            size_t page_size = sysconf( _SC_PAGESIZE );
+            volatile char sink = 0;
+            for( size_t offset = 0; offset < size; offset += page_size )
+               sink += begin[ offset ];
+            (void)sink;
+         }
+      }
+
+      if( interleaving )
+         syscall( SYS_set_mempolicy, old_policy, old_policy == mpol_default ? nullptr : old_nodes.data(), old_policy == mpol_default ? 0 : mpol_max_nodes );
+
+      if( lock_error )
+         BOOST_THROW_EXCEPTION( std::runtime_error( "could not lock the shared memory file in memory: " + std::string( strerror( lock_error ) ) ) );
+#endif
+   }
+
+   void database::release_address_space()
+   {
+#ifndef WIN32
+      if( _segment_fd >= 0 )
+      {
+         ::close( _segment_fd );
+         _segment_fd = -1;
+      }
+
+      // Unmaps the reservation and everything grow() mapped into it, _segment must be closed first
+      if( _reserved_base )
+         munmap( _reserved_base, _reserved_size );
+#endif
+      _reserved_base = nullptr;
+      _reserved_size = 0;
+      _mapped_size = 0;
+   }
+#endif
+
+   bool database::can_clone( const bfs::path& from_dir, const bfs::path& to_dir )
+   {
+#ifdef __linux__
+      bfs::create_directories( from_dir );
+      bfs::create_directories( to_dir );
+      auto from = from_dir / "clone_probe";
+      auto to = to_dir / "clone_probe";
+      bool cloned = false;
+      try
+      {
+         {
+            std::ofstream probe( from.generic_string(), std::ios::binary | std::ios::trunc );
+            std::vector< char > data( 4096, 0 );
+            probe.write( data.data(), data.size() );
+         }
+         cloned = clone_file( from, to, false );
+      }
+      catch( const std::runtime_error& ) {}
+      bfs::remove( from );
+      bfs::remove( to );
+      return cloned;
+#else
+      return false;
+#endif
+   }
+
+   void database::checkpoint( const bfs::path& dir, bool allow_copy )
+   {
+#ifndef ENABLE_STD_ALLOCATOR
+      if( !_segment )
+         BOOST_THROW_EXCEPTION( std::runtime_error( "cannot checkpoint a database that is not open" ) );
+
+      bfs::create_directories( dir );
+
+      // The copy is taken while the file is marked closed, then the file goes back to being open
+      bool opened_after_crash = _opened_after_crash;
+      mark_closed();
+      try
+      {
+         clone_file( _data_dir / "shared_memory.bin", dir / "shared_memory.bin", allow_copy );
+      }
+      catch( ... )
+      {
+         mark_open();
+         _opened_after_crash = opened_after_crash;
+         throw;
+      }
+      mark_open();
+      _opened_after_crash = opened_after_crash;
+#else
+      BOOST_THROW_EXCEPTION( std::runtime_error( "cannot checkpoint a database using the std allocator" ) );
+#endif
+   }
+
+   void database::restore_checkpoint( const bfs::path& checkpoint_dir, const bfs::path& dir )
+   {
+      bfs::create_directories( dir );
+      clone_file( checkpoint_dir / "shared_memory.bin", dir / "shared_memory.bin" );
+   }
+
+   void database::set_background_flush( size_t bytes_per_second, size_t chunk_size )
+   {
+#ifndef ENABLE_STD_ALLOCATOR
+      stop_background_flush();
+#endif
+      _flush_rate = bytes_per_second;
+      _flush_chunk = std::max( chunk_size, _page_size );
+#ifndef ENABLE_STD_ALLOCATOR
+      start_background_flush();
+#endif
+   }
+
+#ifndef ENABLE_STD_ALLOCATOR
+   void database::sync_range( char* begin, size_t size )
+   {
+#ifndef WIN32
+      // msync needs a page aligned start, the pages before begin are written back with it
+      size_t page_size = sysconf( _SC_PAGESIZE );
+      size_t skip = uintptr_t( begin ) % page_size;
+      if( size && msync( begin - skip, size + skip, MS_SYNC ) != 0 )
+         std::cerr << "Could not write back the shared memory file: " << strerror( errno ) << "\n";
+#else
+      if( _segment )
+         _segment->flush( 0, 0, false );
+#endif
+   }
+
+   void database::mark_open()
+   {
+      auto marker = _segment->find_or_construct< flush_marker >( "flush_marker" )();
+      auto boot_id = current_boot_id();
+
+      _opened_after_crash = !marker->closed;
+      if( _opened_after_crash && boot_id[0] && marker->boot_id[0] && marker->boot_id != boot_id )
+         BOOST_THROW_EXCEPTION( std::runtime_error( "the shared memory file was not closed before the system restarted and may have lost changes" ) );
+
+      // Any page written back from now on belongs to a file that is marked open on disk
+      marker->closed = false;
+      marker->boot_id = boot_id;
+      sync_range( (char*)marker, sizeof( flush_marker ) );
+   }
+
+   void database::mark_closed()
+   {
+      auto marker = _segment->find< flush_marker >( "flush_marker" ).first;
+      if( !marker )
+         return;
+
+      sync_range( _flush_base, _flush_size );
+      marker->closed = true;
+      marker->revision = revision();
+      sync_range( (char*)marker, sizeof( flush_marker ) );
+   }
+
+   void database::start_background_flush()
+   {
+      if( !_flush_rate || !_segment || _flush_thread.joinable() )
+         return;
+
+      _flush_stop = false;
+      _flush_thread = std::thread( [this]() { background_flush_loop(); } );
+   }
+
+   void database::stop_background_flush()
+   {
+      if( !_flush_thread.joinable() )
+         return;
+
+      {
+         std::lock_guard< std::mutex > lock( _flush_mutex );
+         _flush_stop = true;
+      }
+      _flush_cv.notify_all();
+      _flush_thread.join();
+   }
+
+   void database::background_flush_loop()
+   {
+      size_t offset = 0;
+      std::unique_lock< std::mutex > lock( _flush_mutex );
+      while( !_flush_stop )
+      {
+         size_t size = _flush_size;
+         if( offset >= size )
+            offset = 0;
+         size_t chunk = std::min( _flush_chunk, size - offset );
+
+         // Only this thread waits for the disk, writers are at most held up by pages under write back
+         lock.unlock();
+         sync_range( _flush_base + offset, chunk );
+         lock.lock();
+
+         offset += chunk;
+         _flush_cv.wait_for( lock, std::chrono::microseconds( std::max< uint64_t >( chunk * 1000000ull / _flush_rate, 1000 ) ),
+            [this]() { return _flush_stop; } );
+      }
+   }
+#endif
+
    void database::set_require_locking( bool enable_require_locking )
    {
 #ifdef CHAINBASE_CHECK_LOCKING
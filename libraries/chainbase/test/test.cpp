@@ -38,6 +38,58 @@ typedef multi_index_container<
 
 CHAINBASE_SET_INDEX_TYPE( book, book_index )
 
+struct note : public chainbase::object<1, note> {
+
+   template<typename Constructor, typename Allocator>
+    note(  Constructor&& c, Allocator&& a ) {
+       c(*this);
+    }
+
+    id_type id;
+    int64_t a = 0;
+    int64_t b = 0;
+    int64_t c = 0;
+};
+
+typedef multi_index_container<
+  note,
+  indexed_by<
+     ordered_unique< member<note,note::id_type,&note::id> >,
+     ordered_unique< BOOST_MULTI_INDEX_MEMBER(note,int64_t,a) >
+  >,
+  chainbase::node_allocator<note>
+> note_index;
+
+CHAINBASE_SET_INDEX_TYPE( note, note_index )
+
+struct page : public chainbase::object<2, page> {
+
+   template<typename Constructor, typename Allocator>
+    page(  Constructor&& c, Allocator&& a ) : title( a ), lines( a ) {
+       c(*this);
+    }
+
+    id_type                      id;
+    int64_t                      number = 0;
+    chainbase::shared_string     title;
+    int64_t                      version = 0;
+    chainbase::t_vector< int >   lines;
+};
+
+struct by_title;
+
+typedef multi_index_container<
+  page,
+  indexed_by<
+     ordered_unique< member<page,page::id_type,&page::id> >,
+     ordered_unique< tag< by_title >, BOOST_MULTI_INDEX_MEMBER(page,chainbase::shared_string,title), chainbase::strcmp_less >
+  >,
+  chainbase::allocator<page>
+> page_index;
+
+CHAINBASE_SET_INDEX_TYPE( page, page_index )
+CHAINBASE_SET_DELTA_UNDO_MEMBERS( page, (title)(lines) )
+
 
 BOOST_AUTO_TEST_CASE( open_and_create ) {
    boost::filesystem::path temp = boost::filesystem::unique_path();
@@ -136,4 +188,438 @@ BOOST_AUTO_TEST_CASE( open_and_create ) {
    }
 }
 
+BOOST_AUTO_TEST_CASE( grow_in_place ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+
+      const auto& first_book = db.create<book>( []( book& b ) {
+          b.a = 1;
+          b.b = 2;
+      } );
+
+      auto session = db.start_undo_session();
+      db.modify( first_book, [&]( book& b ) {
+          b.a = 3;
+      });
+
+      // Fill most of the file so the new objects have to be allocated past its original end
+      while( db.get_free_memory() > 1024*1024 )
+         db.create<book>( []( book& b ) {} );
+
+      BOOST_REQUIRE( db.grow( 1024*1024*16 ) );
+      BOOST_REQUIRE_EQUAL( db.get_max_memory(), 1024*1024*16 );
+      BOOST_REQUIRE_GT( db.get_free_memory(), 1024*1024*8 );
+
+      size_t count = db.get_index< book_index >().indices().size();
+      while( db.get_free_memory() > 1024*1024*2 )
+         db.create<book>( []( book& b ) {} );
+      BOOST_REQUIRE_GT( db.get_index< book_index >().indices().size(), count );
+
+      // Objects did not move and the undo session still restores them
+      BOOST_REQUIRE_EQUAL( db.get( book::id_type(0) ).a, 3 );
+      BOOST_REQUIRE( &db.get( book::id_type(0) ) == &first_book );
+      session.undo();
+      BOOST_REQUIRE_EQUAL( first_book.a, 1 );
+      BOOST_REQUIRE_EQUAL( db.get_index< book_index >().indices().size(), 1 );
+
+      db.flush();
+      db.close();
+
+      chainbase::database db2;
+      db2.open( temp );
+      BOOST_REQUIRE_EQUAL( db2.get_max_memory(), 1024*1024*16 );
+      db2.add_index< book_index >();
+      BOOST_REQUIRE_EQUAL( db2.get( book::id_type(0) ).b, 2 );
+      db2.close();
+      bfs::remove_all( temp );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( mapping_options ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      // The options are hints, the database has to work whether or not the system honors them
+      chainbase::database db;
+      db.open( temp, chainbase::database::huge_pages | chainbase::database::prefault | chainbase::database::numa_interleave, 1024*1024*8 );
+      db.add_index< book_index >();
+
+      db.create<book>( []( book& b ) {
+          b.a = 1;
+          b.b = 2;
+      } );
+
+      BOOST_REQUIRE( db.grow( 1024*1024*16 ) );
+      while( db.get_free_memory() > 1024*1024*2 )
+         db.create<book>( []( book& b ) {} );
+
+      BOOST_REQUIRE_EQUAL( db.get( book::id_type(0) ).b, 2 );
+      db.close();
+      bfs::remove_all( temp );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( delta_undo ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      BOOST_REQUIRE( chainbase::use_delta_undo< note >::value );
+
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< note_index >();
+
+      const auto& n = db.create<note>( []( note& n ) {
+          n.a = 1;
+          n.b = 2;
+          n.c = 3;
+      } );
+      const auto& other = db.create<note>( []( note& n ) {
+          n.a = 10;
+      } );
+
+      auto check = [&]( int64_t a, int64_t b, int64_t c ) {
+         BOOST_REQUIRE_EQUAL( n.a, a );
+         BOOST_REQUIRE_EQUAL( n.b, b );
+         BOOST_REQUIRE_EQUAL( n.c, c );
+      };
+
+      BOOST_TEST_MESSAGE( "Modifying different fields in one session" );
+      {
+         auto session = db.start_undo_session();
+         db.modify( n, []( note& n ) { n.a = 4; } );
+         db.modify( n, []( note& n ) { n.b = 5; } );
+         db.modify( n, []( note& n ) { n.a = 6; } );
+         check( 6, 5, 3 );
+      }
+      check( 1, 2, 3 );
+      BOOST_REQUIRE( db.find( note::id_type(0) ) == &n );
+
+      BOOST_TEST_MESSAGE( "Squashing modifications" );
+      {
+         auto session = db.start_undo_session();
+         db.modify( n, []( note& n ) { n.a = 4; } );
+         {
+            auto inner = db.start_undo_session();
+            db.modify( n, []( note& n ) { n.a = 5; n.c = 7; } );
+            inner.squash();
+         }
+         check( 5, 2, 7 );
+      }
+      check( 1, 2, 3 );
+
+      BOOST_TEST_MESSAGE( "Removing a modified object" );
+      {
+         auto session = db.start_undo_session();
+         db.modify( n, []( note& n ) { n.b = 8; } );
+         db.remove( n );
+         BOOST_REQUIRE( db.find( note::id_type(0) ) == nullptr );
+      }
+      const auto& restored = db.get( note::id_type(0) );
+      BOOST_REQUIRE_EQUAL( restored.a, 1 );
+      BOOST_REQUIRE_EQUAL( restored.b, 2 );
+      BOOST_REQUIRE_EQUAL( restored.c, 3 );
+
+      BOOST_TEST_MESSAGE( "Squashing a removal into a modification" );
+      {
+         auto session = db.start_undo_session();
+         db.modify( restored, []( note& n ) { n.c = 9; } );
+         {
+            auto inner = db.start_undo_session();
+            db.modify( restored, []( note& n ) { n.b = 9; } );
+            db.remove( restored );
+            inner.squash();
+         }
+         BOOST_REQUIRE( db.find( note::id_type(0) ) == nullptr );
+      }
+      const auto& restored2 = db.get( note::id_type(0) );
+      BOOST_REQUIRE_EQUAL( restored2.a, 1 );
+      BOOST_REQUIRE_EQUAL( restored2.b, 2 );
+      BOOST_REQUIRE_EQUAL( restored2.c, 3 );
+
+      BOOST_TEST_MESSAGE( "Failed modification" );
+      {
+         auto session = db.start_undo_session();
+         db.modify( restored2, []( note& n ) { n.b = 11; } );
+         BOOST_CHECK_THROW( db.modify( restored2, []( note& n ) { n.a = 10; } ), std::logic_error );
+         BOOST_REQUIRE( db.find( note::id_type(0) ) == nullptr );
+      }
+      const auto& restored3 = db.get( note::id_type(0) );
+      BOOST_REQUIRE_EQUAL( restored3.a, 1 );
+      BOOST_REQUIRE_EQUAL( restored3.b, 2 );
+      BOOST_REQUIRE_EQUAL( other.a, 10 );
+
+      db.close();
+      bfs::remove_all( temp );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( delta_undo_dynamic_members ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      BOOST_REQUIRE( chainbase::use_delta_undo< page >::value );
+
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< page_index >();
+
+      const auto& p = db.create<page>( []( page& p ) {
+          p.number = 1;
+          p.title = "first";
+          p.version = 2;
+          p.lines.push_back( 3 );
+      } );
+      db.create<page>( []( page& p ) {
+          p.title = "other";
+      } );
+
+      auto find_title = [&]( const std::string& title ) { return db.find< page, by_title >( title ); };
+      auto check = [&]( const page& p, int64_t number, const std::string& title, int64_t version, std::vector< int > lines ) {
+         BOOST_REQUIRE_EQUAL( p.number, number );
+         BOOST_REQUIRE_EQUAL( std::string( p.title.begin(), p.title.end() ), title );
+         BOOST_REQUIRE_EQUAL( p.version, version );
+         BOOST_REQUIRE( std::vector< int >( p.lines.begin(), p.lines.end() ) == lines );
+      };
+
+      BOOST_TEST_MESSAGE( "Modifying words and members in one session" );
+      {
+         auto session = db.start_undo_session();
+         db.modify( p, []( page& p ) { p.version = 4; } );
+         db.modify( p, []( page& p ) { p.title = "a title that does not fit in the string itself"; p.lines.push_back( 5 ); } );
+         db.modify( p, []( page& p ) { p.title = "second"; p.number = 6; } );
+         check( p, 6, "second", 4, { 3, 5 } );
+         BOOST_REQUIRE( find_title( "first" ) == nullptr );
+      }
+      check( p, 1, "first", 2, { 3 } );
+      BOOST_REQUIRE( find_title( "first" ) == &p );
+      BOOST_REQUIRE( find_title( "second" ) == nullptr );
+
+      BOOST_TEST_MESSAGE( "Squashing modifications" );
+      {
+         auto session = db.start_undo_session();
+         db.modify( p, []( page& p ) { p.number = 7; } );
+         {
+            auto inner = db.start_undo_session();
+            db.modify( p, []( page& p ) { p.title = "third"; } );
+            inner.squash();
+         }
+         {
+            auto inner = db.start_undo_session();
+            db.modify( p, []( page& p ) { p.title = "fourth"; p.lines.clear(); } );
+            inner.squash();
+         }
+         check( p, 7, "fourth", 2, {} );
+      }
+      check( p, 1, "first", 2, { 3 } );
+
+      BOOST_TEST_MESSAGE( "Removing a modified object" );
+      {
+         auto session = db.start_undo_session();
+         db.modify( p, []( page& p ) { p.title = "fifth"; p.version = 8; } );
+         db.remove( p );
+         BOOST_REQUIRE( db.find( page::id_type(0) ) == nullptr );
+      }
+      check( db.get( page::id_type(0) ), 1, "first", 2, { 3 } );
+
+      BOOST_TEST_MESSAGE( "Squashing a removal into a modification" );
+      {
+         auto session = db.start_undo_session();
+         db.modify( db.get( page::id_type(0) ), []( page& p ) { p.lines.push_back( 9 ); } );
+         {
+            auto inner = db.start_undo_session();
+            db.modify( db.get( page::id_type(0) ), []( page& p ) { p.title = "sixth"; } );
+            db.remove( db.get( page::id_type(0) ) );
+            inner.squash();
+         }
+         BOOST_REQUIRE( db.find( page::id_type(0) ) == nullptr );
+      }
+      check( db.get( page::id_type(0) ), 1, "first", 2, { 3 } );
+
+      BOOST_TEST_MESSAGE( "Failed modifications" );
+      {
+         auto session = db.start_undo_session();
+         const auto& restored = db.get( page::id_type(0) );
+         db.modify( restored, []( page& p ) { p.lines.push_back( 10 ); } );
+         BOOST_CHECK_THROW( db.modify( restored, []( page& p ) { p.title = "other"; p.version = 11; } ), std::logic_error );
+         BOOST_REQUIRE( db.find( page::id_type(0) ) == nullptr );
+      }
+      check( db.get( page::id_type(0) ), 1, "first", 2, { 3 } );
+      {
+         auto session = db.start_undo_session();
+         BOOST_CHECK_THROW( db.modify( db.get( page::id_type(0) ), []( page& p ) {
+            p.title = "seventh";
+            throw std::runtime_error( "modifier failed" );
+         } ), std::runtime_error );
+         BOOST_REQUIRE( db.find( page::id_type(0) ) == nullptr );
+      }
+      check( db.get( page::id_type(0) ), 1, "first", 2, { 3 } );
+      check( db.get( page::id_type(1) ), 0, "other", 0, {} );
+
+      db.close();
+      bfs::remove_all( temp );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( node_pool_reuse ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< note_index >();
+
+      const auto& pool = db.get_index< note_index >().get_node_pool();
+      size_t node_size = pool.node_size();
+
+      std::vector< const note* > notes;
+      for( int64_t i = 0; i < 1000; ++i )
+         notes.push_back( &db.create<note>( [&]( note& n ) { n.a = i; } ) );
+
+      BOOST_REQUIRE_GE( pool.reserved_size(), 1000 * node_size );
+      size_t reserved = pool.reserved_size();
+      size_t free_memory = db.get_free_memory();
+
+      BOOST_TEST_MESSAGE( "Freed nodes are reused by the index" );
+      for( size_t i = 0; i < notes.size(); i += 2 )
+         db.remove( *notes[i] );
+      BOOST_REQUIRE_EQUAL( pool.free_list_size(), 500 * node_size );
+
+      for( int64_t i = 0; i < 500; ++i )
+         db.create<note>( [&]( note& n ) { n.a = 1000 + i; } );
+      BOOST_REQUIRE_EQUAL( pool.free_list_size(), 0u );
+      BOOST_REQUIRE_EQUAL( pool.reserved_size(), reserved );
+      BOOST_REQUIRE_EQUAL( db.get_free_memory(), free_memory );
+
+      BOOST_TEST_MESSAGE( "Undo returns nodes to the pool" );
+      {
+         auto session = db.start_undo_session();
+         for( int64_t i = 0; i < 100; ++i )
+            db.create<note>( [&]( note& n ) { n.a = 2000 + i; } );
+      }
+      BOOST_REQUIRE_EQUAL( db.get_index< note_index >().indices().size(), 1000u );
+      BOOST_REQUIRE_EQUAL( pool.free_size(), pool.reserved_size() - 1001 * node_size ); // the items and the header node
+
+      auto stats = db.get_abstract_index_cntr().front()->get_statistics( true );
+      BOOST_REQUIRE_EQUAL( stats._pool_reserved, pool.reserved_size() );
+      BOOST_REQUIRE_EQUAL( stats._pool_free, pool.free_size() );
+
+      db.close();
+      bfs::remove_all( temp );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( background_flush ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   boost::filesystem::path copy = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.set_background_flush( 1024*1024*1024, 1024*1024 );
+      db.open( temp, 0, 1024*1024*8 );
+      BOOST_REQUIRE( !db.opened_after_crash() );
+      db.add_index< book_index >();
+
+      db.create<book>( []( book& b ) {
+          b.a = 1;
+          b.b = 2;
+      } );
+
+      // Grown pages are written back as well
+      BOOST_REQUIRE( db.grow( 1024*1024*16 ) );
+      while( db.get_free_memory() > 1024*1024*2 )
+         db.create<book>( []( book& b ) {} );
+
+      // A copy taken while the file is open looks like the file after a process crash
+      bfs::create_directories( copy );
+      bfs::copy_file( temp / "shared_memory.bin", copy / "shared_memory.bin" );
+
+      db.set_background_flush( 0 );
+      BOOST_REQUIRE_EQUAL( db.background_flush_rate(), 0u );
+      db.close();
+
+      chainbase::database crashed;
+      crashed.open( copy );
+      BOOST_REQUIRE( crashed.opened_after_crash() );
+      crashed.add_index< book_index >();
+      BOOST_REQUIRE_EQUAL( crashed.get( book::id_type(0) ).b, 2 );
+      crashed.close();
+
+      chainbase::database db2;
+      db2.open( temp );
+      BOOST_REQUIRE( !db2.opened_after_crash() );
+      db2.add_index< book_index >();
+      BOOST_REQUIRE_EQUAL( db2.get( book::id_type(0) ).b, 2 );
+      db2.close();
+
+      bfs::remove_all( temp );
+      bfs::remove_all( copy );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      bfs::remove_all( copy );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( checkpoint_restore ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   boost::filesystem::path checkpoint = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+
+      const auto& first_book = db.create<book>( []( book& b ) {
+          b.a = 1;
+          b.b = 2;
+      } );
+      db.set_revision( 5 );
+
+      // Without reflinks the file can only be copied, which has to be asked for
+      if( !chainbase::database::can_clone( temp, checkpoint ) )
+         BOOST_CHECK_THROW( db.checkpoint( checkpoint ), std::runtime_error );
+      db.checkpoint( checkpoint, true );
+      BOOST_REQUIRE( !db.opened_after_crash() );
+
+      // Changes after the checkpoint are not part of it
+      db.modify( first_book, []( book& b ) {
+          b.a = 3;
+      });
+      db.set_revision( 6 );
+      db.create<book>( []( book& b ) {} );
+      db.close();
+
+      chainbase::database::restore_checkpoint( checkpoint, temp );
+
+      chainbase::database db2;
+      db2.open( temp );
+      BOOST_REQUIRE( !db2.opened_after_crash() );
+      db2.add_index< book_index >();
+      BOOST_REQUIRE_EQUAL( db2.revision(), 5 );
+      BOOST_REQUIRE_EQUAL( db2.get_index< book_index >().indices().size(), 1 );
+      BOOST_REQUIRE_EQUAL( db2.get( book::id_type(0) ).a, 1 );
+      db2.close();
+
+      bfs::remove_all( temp );
+      bfs::remove_all( checkpoint );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      bfs::remove_all( checkpoint );
+      throw;
+   }
+}
+
 // BOOST_AUTO_TEST_SUITE_END()
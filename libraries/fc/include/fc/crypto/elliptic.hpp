@@ -258,6 +258,20 @@ namespace fc {
                                           const range_proof_type& proof );
      range_proof_info range_get_info( const range_proof_type& proof );
 
+     /**
+      *  Recovers the public key of every (signature, digest) pair and returns the keys in the same
+      *  order. The pairs are spread over the recovery threads, the calling thread works on the batch
+      *  as well. If any pair fails to recover, the error of the first failing pair is rethrown.
+      */
+     std::vector< public_key > recover_public_keys( const std::vector< std::pair< compact_signature, fc::sha256 > >& sigs,
+                                                    canonical_signature_type canon_type = fc_canonical );
+     /** Recovers the keys of several signatures over the same digest */
+     std::vector< public_key > recover_public_keys( const std::vector< compact_signature >& sigs, const fc::sha256& digest,
+                                                    canonical_signature_type canon_type = fc_canonical );
+
+     /** Sets the number of worker threads used by recover_public_keys, 0 recovers on the calling thread only */
+     void     set_recovery_threads( uint32_t count );
+     uint32_t get_recovery_threads();
 
 
   } // namespace ecc
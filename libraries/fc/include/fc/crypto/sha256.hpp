@@ -24,6 +24,13 @@ class sha256
     static sha256 hash( const string& );
     static sha256 hash( const sha256& );
 
+    /**
+     * Hashes count independent messages, results[i] = hash( messages[i], sizes[i] ).
+     * Messages are hashed 8 at a time with a multi-buffer AVX2 implementation when the
+     * CPU supports it, otherwise one at a time.
+     */
+    static void hash_batch( const char* const* messages, const uint32_t* sizes, sha256* results, size_t count );
+
     template<typename T>
     static sha256 hash( const T& t )
     {
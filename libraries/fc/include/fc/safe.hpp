@@ -25,7 +25,7 @@ namespace fc {
       template<typename O>
       safe( O o ):value(o){}
       safe(){}
-      safe( const safe& o ):value(o.value){}
+      safe( const safe& o ) = default;
 
       static safe min()
       {
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/* Multi-buffer SHA-256, hashes up to 8 independent messages at once
+ */
+namespace fc { namespace detail {
+    /** The CPU can run the 8 lane AVX2 implementation */
+    bool sha256_multibuffer_supported();
+
+    /** Hashes count <= 8 messages, writing the 32 byte digest of messages[i] to out[i] */
+    void sha256_multibuffer_x8( const char* const* messages, const uint32_t* sizes, char* const* out, uint32_t count );
+}}
@@ -0,0 +1,191 @@
+#include <fc/crypto/elliptic.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/* batch public key recovery, common to all ecc implementations */
+
+namespace fc { namespace ecc {
+
+    namespace detail {
+
+        /**
+         * One batch of recoveries. Items are claimed through an atomic cursor, so any number of
+         * threads can work on the batch and the caller can finish it alone if the pool is busy.
+         */
+        struct recovery_batch
+        {
+            recovery_batch( size_t c, std::function< void( size_t ) >&& w )
+                : count( c ), work( std::move( w ) ), errors( c ) {}
+
+            const size_t                         count;
+            std::function< void( size_t ) >      work;
+            std::vector< std::exception_ptr >    errors;
+            std::atomic< size_t >                next{ 0 };
+            std::atomic< size_t >                done{ 0 };
+            std::mutex                           done_mutex;
+            std::condition_variable              done_cv;
+
+            void run()
+            {
+                for( size_t i = next++; i < count; i = next++ )
+                {
+                    try
+                    {
+                        work( i );
+                    }
+                    catch( ... )
+                    {
+                        errors[i] = std::current_exception();
+                    }
+
+                    if( ++done == count )
+                    {
+                        std::lock_guard< std::mutex > lock( done_mutex );
+                        done_cv.notify_all();
+                    }
+                }
+            }
+
+            void wait()
+            {
+                std::unique_lock< std::mutex > lock( done_mutex );
+                done_cv.wait( lock, [this]() { return done == count; } );
+            }
+        };
+
+        class recovery_pool
+        {
+            public:
+                ~recovery_pool() { resize( 0 ); }
+
+                void resize( uint32_t count )
+                {
+                    std::lock_guard< std::mutex > resize_lock( _resize_mutex );
+
+                    {
+                        std::lock_guard< std::mutex > lock( _mutex );
+                        _stopping = true;
+                    }
+                    _cv.notify_all();
+                    for( auto& t : _threads )
+                        t.join();
+                    _threads.clear();
+
+                    std::lock_guard< std::mutex > lock( _mutex );
+                    _stopping = false;
+                    for( uint32_t i = 0; i < count; ++i )
+                        _threads.emplace_back( [this]() { worker(); } );
+                    _size = count;
+                }
+
+                uint32_t size()const { return _size; }
+
+                void post( const std::shared_ptr< recovery_batch >& batch, uint32_t workers )
+                {
+                    {
+                        std::lock_guard< std::mutex > lock( _mutex );
+                        for( uint32_t i = 0; i < workers; ++i )
+                            _queue.push_back( batch );
+                    }
+                    _cv.notify_all();
+                }
+
+            private:
+                void worker()
+                {
+                    std::unique_lock< std::mutex > lock( _mutex );
+                    while( true )
+                    {
+                        _cv.wait( lock, [this]() { return _stopping || !_queue.empty(); } );
+                        if( _stopping )
+                            return;
+
+                        auto batch = std::move( _queue.front() );
+                        _queue.pop_front();
+
+                        lock.unlock();
+                        batch->run();
+                        lock.lock();
+                    }
+                }
+
+                std::mutex                                        _resize_mutex;
+                std::mutex                                        _mutex;
+                std::condition_variable                           _cv;
+                std::deque< std::shared_ptr< recovery_batch > >   _queue;
+                std::vector< std::thread >                        _threads;
+                std::atomic< uint32_t >                           _size{ 0 };
+                bool                                              _stopping = false;
+        };
+
+        recovery_pool& _get_recovery_pool()
+        {
+            static recovery_pool pool;
+            return pool;
+        }
+
+        void _run_batch( size_t count, std::function< void( size_t ) >&& work )
+        {
+            auto batch = std::make_shared< recovery_batch >( count, std::move( work ) );
+
+            auto& pool = _get_recovery_pool();
+            uint32_t workers = std::min< size_t >( pool.size(), count - 1 );
+            if( workers )
+                pool.post( batch, workers );
+
+            batch->run();
+            batch->wait();
+
+            for( const auto& e : batch->errors )
+                if( e )
+                    std::rethrow_exception( e );
+        }
+    }
+
+    std::vector< public_key > recover_public_keys( const std::vector< std::pair< compact_signature, fc::sha256 > >& sigs,
+                                                   canonical_signature_type canon_type )
+    {
+        std::vector< public_key > result( sigs.size() );
+        if( sigs.size() )
+        {
+            detail::_run_batch( sigs.size(), [&]( size_t i )
+            {
+                result[i] = public_key( sigs[i].first, sigs[i].second, canon_type );
+            });
+        }
+        return result;
+    }
+
+    std::vector< public_key > recover_public_keys( const std::vector< compact_signature >& sigs, const fc::sha256& digest,
+                                                   canonical_signature_type canon_type )
+    {
+        std::vector< public_key > result( sigs.size() );
+        if( sigs.size() )
+        {
+            detail::_run_batch( sigs.size(), [&]( size_t i )
+            {
+                result[i] = public_key( sigs[i], digest, canon_type );
+            });
+        }
+        return result;
+    }
+
+    void set_recovery_threads( uint32_t count )
+    {
+        detail::_get_recovery_pool().resize( count );
+    }
+
+    uint32_t get_recovery_threads()
+    {
+        return detail::_get_recovery_pool().size();
+    }
+
+} }
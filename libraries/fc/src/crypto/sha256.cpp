@@ -4,10 +4,12 @@
 #include <openssl/sha.h>
 #include <string.h>
 #include <cmath>
+#include <algorithm>
 #include <fc/crypto/sha256.hpp>
 #include <fc/variant.hpp>
 #include <fc/exception/exception.hpp>
 #include "_digest_common.hpp"
+#include "_sha256_multibuffer.hpp"
 
 namespace fc {
 
@@ -55,6 +57,28 @@ namespace fc {
         return hash( s.data(), sizeof( s._hash ) );
     }
 
+    void sha256::hash_batch( const char* const* messages, const uint32_t* sizes, sha256* results, size_t count )
+    {
+      size_t i = 0;
+
+      // A lane group pays for all 8 lanes, short remainders are cheaper one at a time
+      if( detail::sha256_multibuffer_supported() )
+      {
+        while( count - i >= 4 )
+        {
+          uint32_t n = uint32_t( std::min< size_t >( 8, count - i ) );
+          char* out[8];
+          for( uint32_t j = 0; j < n; ++j )
+            out[j] = results[i + j].data();
+          detail::sha256_multibuffer_x8( messages + i, sizes + i, out, n );
+          i += n;
+        }
+      }
+
+      for( ; i < count; ++i )
+        results[i] = hash( messages[i], sizes[i] );
+    }
+
     void sha256::encoder::write( const char* d, uint32_t dlen ) {
       SHA256_Update( &my->ctx, d, dlen);
     }
@@ -0,0 +1,255 @@
+#include "_sha256_multibuffer.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(__x86_64__) && ( defined(__GNUC__) || defined(__clang__) )
+#define FC_SHA256_MULTIBUFFER_AVX2
+#include <immintrin.h>
+#endif
+
+namespace fc { namespace detail {
+
+namespace {
+
+   const uint32_t k256[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+      0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+      0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+      0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+      0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+      0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+   };
+
+   const uint32_t h256[8] = {
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+   };
+
+   inline uint32_t load_be32( const unsigned char* p )
+   {
+      return ( uint32_t( p[0] ) << 24 ) | ( uint32_t( p[1] ) << 16 ) | ( uint32_t( p[2] ) << 8 ) | uint32_t( p[3] );
+   }
+
+   inline void store_be32( unsigned char* p, uint32_t v )
+   {
+      p[0] = (unsigned char)( v >> 24 );
+      p[1] = (unsigned char)( v >> 16 );
+      p[2] = (unsigned char)( v >> 8 );
+      p[3] = (unsigned char)( v );
+   }
+
+   /**
+    * One message of the batch. Whole blocks are read in place from the message, the last
+    * one or two blocks are copied into a padded tail.
+    */
+   struct lane
+   {
+      const unsigned char* data = nullptr;
+      uint32_t             full_blocks = 0;
+      uint32_t             total_blocks = 0;
+      unsigned char        tail[128];
+
+      void init( const char* msg, uint32_t size )
+      {
+         data = (const unsigned char*)msg;
+         full_blocks = size / 64;
+
+         uint32_t rem = size % 64;
+         uint32_t tail_blocks = ( rem + 9 <= 64 ) ? 1 : 2;
+         total_blocks = full_blocks + tail_blocks;
+
+         memset( tail, 0, sizeof( tail ) );
+         if( rem )
+            memcpy( tail, data + 64 * full_blocks, rem );
+         tail[rem] = 0x80;
+
+         uint64_t bits = uint64_t( size ) * 8;
+         unsigned char* len = tail + 64 * tail_blocks - 8;
+         for( int i = 0; i < 8; ++i )
+            len[i] = (unsigned char)( bits >> ( 56 - 8 * i ) );
+      }
+
+      /** Block b of the padded message, lanes that are already done just see their tail */
+      const unsigned char* block( uint32_t b )const
+      {
+         if( b < full_blocks )
+            return data + 64 * b;
+         if( b < total_blocks )
+            return tail + 64 * ( b - full_blocks );
+         return tail;
+      }
+   };
+
+   inline uint32_t rotr( uint32_t x, int n ) { return ( x >> n ) | ( x << ( 32 - n ) ); }
+
+   void compress( uint32_t* state, const unsigned char* block )
+   {
+      uint32_t w[64];
+      for( int t = 0; t < 16; ++t )
+         w[t] = load_be32( block + 4 * t );
+      for( int t = 16; t < 64; ++t )
+      {
+         uint32_t s0 = rotr( w[t-15], 7 ) ^ rotr( w[t-15], 18 ) ^ ( w[t-15] >> 3 );
+         uint32_t s1 = rotr( w[t-2], 17 ) ^ rotr( w[t-2], 19 ) ^ ( w[t-2] >> 10 );
+         w[t] = w[t-16] + s0 + w[t-7] + s1;
+      }
+
+      uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+      uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+      for( int t = 0; t < 64; ++t )
+      {
+         uint32_t t1 = h + ( rotr( e, 6 ) ^ rotr( e, 11 ) ^ rotr( e, 25 ) ) + ( ( e & f ) ^ ( ~e & g ) ) + k256[t] + w[t];
+         uint32_t t2 = ( rotr( a, 2 ) ^ rotr( a, 13 ) ^ rotr( a, 22 ) ) + ( ( a & b ) ^ ( a & c ) ^ ( b & c ) );
+         h = g; g = f; f = e; e = d + t1;
+         d = c; c = b; b = a; a = t1 + t2;
+      }
+
+      state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+      state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+   }
+
+   /** Portable version of the lane algorithm, used when AVX2 is not available */
+   void sha256_lanes_portable( const char* const* messages, const uint32_t* sizes, char* const* out, uint32_t count )
+   {
+      lane l;
+      for( uint32_t i = 0; i < count; ++i )
+      {
+         l.init( messages[i], sizes[i] );
+
+         uint32_t state[8];
+         memcpy( state, h256, sizeof( state ) );
+         for( uint32_t b = 0; b < l.total_blocks; ++b )
+            compress( state, l.block( b ) );
+
+         for( int j = 0; j < 8; ++j )
+            store_be32( (unsigned char*)out[i] + 4 * j, state[j] );
+      }
+   }
+
+#ifdef FC_SHA256_MULTIBUFFER_AVX2
+
+#define MB_ROTR( x, n ) _mm256_or_si256( _mm256_srli_epi32( x, n ), _mm256_slli_epi32( x, 32 - ( n ) ) )
+#define MB_XOR3( x, y, z ) _mm256_xor_si256( _mm256_xor_si256( x, y ), z )
+#define MB_ADD3( x, y, z ) _mm256_add_epi32( _mm256_add_epi32( x, y ), z )
+
+   __attribute__(( target( "avx2" ) ))
+   void sha256_lanes_avx2( const char* const* messages, const uint32_t* sizes, char* const* out, uint32_t count )
+   {
+      lane lanes[8];
+      uint32_t max_blocks = 0;
+      for( uint32_t i = 0; i < 8; ++i )
+      {
+         if( i < count )
+         {
+            lanes[i].init( messages[i], sizes[i] );
+         }
+         else
+         {
+            lanes[i].init( "", 0 );
+            lanes[i].total_blocks = 0;
+         }
+         max_blocks = std::max( max_blocks, lanes[i].total_blocks );
+      }
+
+      __m256i state[8];
+      for( int j = 0; j < 8; ++j )
+         state[j] = _mm256_set1_epi32( int( h256[j] ) );
+
+      __m256i w[64];
+      for( uint32_t b = 0; b < max_blocks; ++b )
+      {
+         const unsigned char* blk[8];
+         for( int i = 0; i < 8; ++i )
+            blk[i] = lanes[i].block( b );
+
+         // Transpose the 8 blocks so that each vector holds word t of every lane
+         for( int t = 0; t < 16; ++t )
+            w[t] = _mm256_setr_epi32(
+               int( load_be32( blk[0] + 4 * t ) ), int( load_be32( blk[1] + 4 * t ) ),
+               int( load_be32( blk[2] + 4 * t ) ), int( load_be32( blk[3] + 4 * t ) ),
+               int( load_be32( blk[4] + 4 * t ) ), int( load_be32( blk[5] + 4 * t ) ),
+               int( load_be32( blk[6] + 4 * t ) ), int( load_be32( blk[7] + 4 * t ) ) );
+
+         for( int t = 16; t < 64; ++t )
+         {
+            __m256i s0 = MB_XOR3( MB_ROTR( w[t-15], 7 ), MB_ROTR( w[t-15], 18 ), _mm256_srli_epi32( w[t-15], 3 ) );
+            __m256i s1 = MB_XOR3( MB_ROTR( w[t-2], 17 ), MB_ROTR( w[t-2], 19 ), _mm256_srli_epi32( w[t-2], 10 ) );
+            w[t] = _mm256_add_epi32( MB_ADD3( w[t-16], s0, w[t-7] ), s1 );
+         }
+
+         __m256i a = state[0], bb = state[1], c = state[2], d = state[3];
+         __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+
+         for( int t = 0; t < 64; ++t )
+         {
+            __m256i s1 = MB_XOR3( MB_ROTR( e, 6 ), MB_ROTR( e, 11 ), MB_ROTR( e, 25 ) );
+            __m256i ch = _mm256_xor_si256( _mm256_and_si256( e, f ), _mm256_andnot_si256( e, g ) );
+            __m256i t1 = _mm256_add_epi32( MB_ADD3( h, s1, ch ), _mm256_add_epi32( _mm256_set1_epi32( int( k256[t] ) ), w[t] ) );
+            __m256i s0 = MB_XOR3( MB_ROTR( a, 2 ), MB_ROTR( a, 13 ), MB_ROTR( a, 22 ) );
+            __m256i maj = MB_XOR3( _mm256_and_si256( a, bb ), _mm256_and_si256( a, c ), _mm256_and_si256( bb, c ) );
+            __m256i t2 = _mm256_add_epi32( s0, maj );
+            h = g; g = f; f = e; e = _mm256_add_epi32( d, t1 );
+            d = c; c = bb; bb = a; a = _mm256_add_epi32( t1, t2 );
+         }
+
+         // Lanes whose message has no block b keep their state
+         __m256i active = _mm256_setr_epi32(
+            b < lanes[0].total_blocks ? -1 : 0, b < lanes[1].total_blocks ? -1 : 0,
+            b < lanes[2].total_blocks ? -1 : 0, b < lanes[3].total_blocks ? -1 : 0,
+            b < lanes[4].total_blocks ? -1 : 0, b < lanes[5].total_blocks ? -1 : 0,
+            b < lanes[6].total_blocks ? -1 : 0, b < lanes[7].total_blocks ? -1 : 0 );
+
+         const __m256i v[8] = { a, bb, c, d, e, f, g, h };
+         for( int j = 0; j < 8; ++j )
+            state[j] = _mm256_blendv_epi8( state[j], _mm256_add_epi32( state[j], v[j] ), active );
+      }
+
+      for( int j = 0; j < 8; ++j )
+      {
+         uint32_t words[8];
+         _mm256_storeu_si256( (__m256i*)words, state[j] );
+         for( uint32_t i = 0; i < count; ++i )
+            store_be32( (unsigned char*)out[i] + 4 * j, words[i] );
+      }
+   }
+
+#undef MB_ROTR
+#undef MB_XOR3
+#undef MB_ADD3
+
+#endif // FC_SHA256_MULTIBUFFER_AVX2
+
+} // anonymous
+
+#ifdef FC_SHA256_MULTIBUFFER_AVX2
+
+bool sha256_multibuffer_supported()
+{
+   static const bool supported = __builtin_cpu_supports( "avx2" );
+   return supported;
+}
+
+void sha256_multibuffer_x8( const char* const* messages, const uint32_t* sizes, char* const* out, uint32_t count )
+{
+   count = std::min< uint32_t >( count, 8 );
+   if( sha256_multibuffer_supported() )
+      sha256_lanes_avx2( messages, sizes, out, count );
+   else
+      sha256_lanes_portable( messages, sizes, out, count );
+}
+
+#else
+
+bool sha256_multibuffer_supported() { return false; }
+
+void sha256_multibuffer_x8( const char* const* messages, const uint32_t* sizes, char* const* out, uint32_t count )
+{
+   sha256_lanes_portable( messages, sizes, out, std::min< uint32_t >( count, 8 ) );
+}
+
+#endif // FC_SHA256_MULTIBUFFER_AVX2
+
+}} // fc::detail
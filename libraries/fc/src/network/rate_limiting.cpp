@@ -3,6 +3,7 @@
 #include <fc/network/tcp_socket.hpp>
 #include <list>
 #include <algorithm>
+#include <mutex>
 #include <fc/network/ip.hpp>
 #include <fc/fwd_impl.hpp>
 #include <fc/asio.hpp>
@@ -214,6 +215,13 @@ namespace fc
       average_rate_meter _actual_upload_rate;
       average_rate_meter _actual_download_rate;
 
+      // sockets in the group may be read and written from several threads, the operation lists,
+      // tokens and rate meters are guarded by _mutex and the processing loops always run on the
+      // thread that did the first rate limited read or write.  The group is often created on a
+      // thread that doesn't run fc tasks, so the thread can't be bound in the constructor
+      thread* _thread;
+      mutable std::mutex _mutex;
+
       rate_limiting_group_impl(uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second,
                                uint32_t burstiness_in_seconds = 1);
       ~rate_limiting_group_impl();
@@ -246,7 +254,8 @@ namespace fc
       _read_tokens(_download_bytes_per_second),
       _unused_read_tokens(0),
       _write_tokens(_upload_bytes_per_second),
-      _unused_write_tokens(0)
+      _unused_write_tokens(0),
+      _thread(nullptr)
     {
     }
 
@@ -286,13 +295,18 @@ namespace fc
       {
         promise<size_t>::ptr completion_promise(new promise<size_t>("rate_limiting_group_impl::readsome"));
         rate_limited_tcp_read_operation read_operation(socket, buffer, length, offset, completion_promise);
-        _read_operations_for_next_iteration.push_back(&read_operation);
-
-        // launch the read processing loop it if isn't running, or signal it to resume if it's paused.
-        if (!_process_pending_reads_loop_complete.valid() || _process_pending_reads_loop_complete.ready())
-          _process_pending_reads_loop_complete = async([=](){ process_pending_reads(); }, "process_pending_reads" );
-        else if (_new_read_operation_available_promise)
-          _new_read_operation_available_promise->set_value();
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _read_operations_for_next_iteration.push_back(&read_operation);
+
+          // launch the read processing loop it if isn't running, or signal it to resume if it's paused.
+          if (!_thread)
+            _thread = &thread::current();
+          if (!_process_pending_reads_loop_complete.valid() || _process_pending_reads_loop_complete.ready())
+            _process_pending_reads_loop_complete = _thread->async([=](){ process_pending_reads(); }, "process_pending_reads" );
+          else if (_new_read_operation_available_promise)
+            _new_read_operation_available_promise->set_value();
+        }
 
         try
         {
@@ -300,16 +314,21 @@ namespace fc
         }
         catch (...)
         {
+          std::lock_guard<std::mutex> lock(_mutex);
           _read_operations_for_next_iteration.remove(&read_operation);
           _read_operations_in_progress.remove(&read_operation);
           throw;
         }
+        std::lock_guard<std::mutex> lock(_mutex);
         _unused_read_tokens += read_operation.permitted_length - bytes_read;
+        _actual_download_rate.update(bytes_read);
       }
       else
+      {
         bytes_read = asio::read_some(socket, buffer, length, offset);
-      
-      _actual_download_rate.update(bytes_read);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _actual_download_rate.update(bytes_read);
+      }
       
       return bytes_read;
     }
@@ -332,13 +351,18 @@ namespace fc
       {
         promise<size_t>::ptr completion_promise(new promise<size_t>("rate_limiting_group_impl::writesome"));
         rate_limited_tcp_write_operation write_operation(socket, buffer, length, offset, completion_promise);
-        _write_operations_for_next_iteration.push_back(&write_operation);
-
-        // launch the write processing loop it if isn't running, or signal it to resume if it's paused.
-        if (!_process_pending_writes_loop_complete.valid() || _process_pending_writes_loop_complete.ready())
-          _process_pending_writes_loop_complete = async([=](){ process_pending_writes(); }, "process_pending_writes");
-        else if (_new_write_operation_available_promise)
-          _new_write_operation_available_promise->set_value();
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _write_operations_for_next_iteration.push_back(&write_operation);
+
+          // launch the write processing loop it if isn't running, or signal it to resume if it's paused.
+          if (!_thread)
+            _thread = &thread::current();
+          if (!_process_pending_writes_loop_complete.valid() || _process_pending_writes_loop_complete.ready())
+            _process_pending_writes_loop_complete = _thread->async([=](){ process_pending_writes(); }, "process_pending_writes");
+          else if (_new_write_operation_available_promise)
+            _new_write_operation_available_promise->set_value();
+        }
 
         try
         {
@@ -346,16 +370,21 @@ namespace fc
         }
         catch (...)
         {
+          std::lock_guard<std::mutex> lock(_mutex);
           _write_operations_for_next_iteration.remove(&write_operation);
           _write_operations_in_progress.remove(&write_operation);
           throw;
         }
+        std::lock_guard<std::mutex> lock(_mutex);
         _unused_write_tokens += write_operation.permitted_length - bytes_written;
+        _actual_upload_rate.update(bytes_written);
       }
       else
+      {
         bytes_written = asio::write_some(socket, buffer, length, offset);
-      
-      _actual_upload_rate.update(bytes_written);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _actual_upload_rate.update(bytes_written);
+      }
       
       return bytes_written;
     }
@@ -364,20 +393,26 @@ namespace fc
     {
       for (;;)
       {
-        process_pending_operations(_last_read_iteration_time, _download_bytes_per_second,
-                                   _read_operations_in_progress, _read_operations_for_next_iteration, _read_tokens, _unused_read_tokens);
-
-        _new_read_operation_available_promise = new promise<void>("rate_limiting_group_impl::process_pending_reads");
+        promise<void>::ptr operation_available_promise(new promise<void>("rate_limiting_group_impl::process_pending_reads"));
+        bool operations_in_progress;
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          process_pending_operations(_last_read_iteration_time, _download_bytes_per_second,
+                                     _read_operations_in_progress, _read_operations_for_next_iteration, _read_tokens, _unused_read_tokens);
+          _new_read_operation_available_promise = operation_available_promise;
+          operations_in_progress = !_read_operations_in_progress.empty();
+        }
         try
         {
-          if (_read_operations_in_progress.empty())
-            _new_read_operation_available_promise->wait();
+          if (!operations_in_progress)
+            operation_available_promise->wait();
           else
-            _new_read_operation_available_promise->wait(_granularity);
+            operation_available_promise->wait(_granularity);
         }
         catch (const timeout_exception&)
         {
         }
+        std::lock_guard<std::mutex> lock(_mutex);
         _new_read_operation_available_promise.reset();
       }
     }
@@ -385,20 +420,26 @@ namespace fc
     {
       for (;;)
       {
-        process_pending_operations(_last_write_iteration_time, _upload_bytes_per_second,
-                                   _write_operations_in_progress, _write_operations_for_next_iteration, _write_tokens, _unused_write_tokens);
-
-        _new_write_operation_available_promise = new promise<void>("rate_limiting_group_impl::process_pending_writes");
+        promise<void>::ptr operation_available_promise(new promise<void>("rate_limiting_group_impl::process_pending_writes"));
+        bool operations_in_progress;
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          process_pending_operations(_last_write_iteration_time, _upload_bytes_per_second,
+                                     _write_operations_in_progress, _write_operations_for_next_iteration, _write_tokens, _unused_write_tokens);
+          _new_write_operation_available_promise = operation_available_promise;
+          operations_in_progress = !_write_operations_in_progress.empty();
+        }
         try
         {
-          if (_write_operations_in_progress.empty())
-            _new_write_operation_available_promise->wait();
+          if (!operations_in_progress)
+            operation_available_promise->wait();
           else
-            _new_write_operation_available_promise->wait(_granularity);
+            operation_available_promise->wait(_granularity);
         }
         catch (const timeout_exception&)
         {
         }
+        std::lock_guard<std::mutex> lock(_mutex);
         _new_write_operation_available_promise.reset();
       }
     }
@@ -409,7 +450,6 @@ namespace fc
                                                               uint32_t& tokens,
                                                               uint32_t& unused_tokens)
     {
-      // lock here for multithreaded
       std::copy(operations_for_next_iteration.begin(),
                 operations_for_next_iteration.end(),
                 std::back_inserter(operations_in_progress));
@@ -495,16 +535,19 @@ namespace fc
 
   uint32_t rate_limiting_group::get_actual_upload_rate() const
   {
+    std::lock_guard<std::mutex> lock(my->_mutex);
     return my->_actual_upload_rate.get_average_rate();
   }
 
   uint32_t rate_limiting_group::get_actual_download_rate() const
   {
+    std::lock_guard<std::mutex> lock(my->_mutex);
     return my->_actual_download_rate.get_average_rate();
   }
 
   void rate_limiting_group::set_actual_rate_time_constant(microseconds time_constant)
   {
+    std::lock_guard<std::mutex> lock(my->_mutex);
     my->_actual_upload_rate.set_time_constant(time_constant);
     my->_actual_download_rate.set_time_constant(time_constant);
   }
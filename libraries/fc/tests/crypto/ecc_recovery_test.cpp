@@ -0,0 +1,54 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/crypto/elliptic.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(fc_crypto)
+
+BOOST_AUTO_TEST_CASE(ecc_batch_recovery_test)
+{
+   std::vector< fc::ecc::private_key > keys;
+   std::vector< std::pair< fc::ecc::compact_signature, fc::sha256 > > sigs;
+   for( uint32_t i = 0; i < 64; ++i )
+   {
+      keys.push_back( fc::ecc::private_key::regenerate( fc::sha256::hash( "key" + std::to_string( i ) ) ) );
+      fc::sha256 digest = fc::sha256::hash( "message" + std::to_string( i ) );
+      sigs.emplace_back( keys.back().sign_compact( digest ), digest );
+   }
+
+   fc::sha256 shared_digest = fc::sha256::hash( std::string( "shared" ) );
+   std::vector< fc::ecc::compact_signature > shared_sigs;
+   for( uint32_t i = 0; i < 8; ++i )
+      shared_sigs.push_back( keys[i].sign_compact( shared_digest ) );
+
+   for( uint32_t threads : { 0u, 1u, 3u } )
+   {
+      fc::ecc::set_recovery_threads( threads );
+      BOOST_CHECK_EQUAL( fc::ecc::get_recovery_threads(), threads );
+
+      auto recovered = fc::ecc::recover_public_keys( sigs );
+      BOOST_REQUIRE_EQUAL( recovered.size(), keys.size() );
+      for( uint32_t i = 0; i < keys.size(); ++i )
+         BOOST_CHECK( recovered[i] == keys[i].get_public_key() );
+
+      auto shared = fc::ecc::recover_public_keys( shared_sigs, shared_digest );
+      BOOST_REQUIRE_EQUAL( shared.size(), shared_sigs.size() );
+      for( uint32_t i = 0; i < shared.size(); ++i )
+         BOOST_CHECK( shared[i] == keys[i].get_public_key() );
+
+      BOOST_CHECK( fc::ecc::recover_public_keys( std::vector< fc::ecc::compact_signature >(), shared_digest ).empty() );
+
+      // A signature with an invalid recovery id fails the whole batch
+      auto bad = sigs;
+      bad[ bad.size() / 2 ].first.data[0] = 0;
+      BOOST_CHECK_THROW( fc::ecc::recover_public_keys( bad ), fc::exception );
+   }
+
+   fc::ecc::set_recovery_threads( 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
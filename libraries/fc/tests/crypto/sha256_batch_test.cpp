@@ -0,0 +1,71 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/crypto/sha256.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+struct message_set
+{
+   std::vector< std::string > data;
+   std::vector< const char* > messages;
+   std::vector< uint32_t >    sizes;
+
+   void add( std::string m )
+   {
+      data.push_back( std::move( m ) );
+   }
+
+   void finalize()
+   {
+      messages.clear();
+      sizes.clear();
+      for( const auto& m : data )
+      {
+         messages.push_back( m.data() );
+         sizes.push_back( m.size() );
+      }
+   }
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(fc_crypto)
+
+BOOST_AUTO_TEST_CASE(sha256_batch_test)
+{
+   // Every length around the one and two block padding boundaries, in batches of every size
+   message_set set;
+   for( uint32_t len = 0; len < 300; ++len )
+   {
+      std::string m( len, '\0' );
+      for( uint32_t j = 0; j < len; ++j )
+         m[j] = char( len + j * 13 );
+      set.add( std::move( m ) );
+   }
+   set.finalize();
+
+   for( uint32_t batch = 1; batch <= 17; ++batch )
+   {
+      for( uint32_t start = 0; start + batch <= set.data.size(); start += batch )
+      {
+         std::vector< fc::sha256 > results( batch );
+         fc::sha256::hash_batch( set.messages.data() + start, set.sizes.data() + start, results.data(), batch );
+
+         for( uint32_t i = 0; i < batch; ++i )
+            BOOST_REQUIRE( results[i] == fc::sha256::hash( set.messages[start + i], set.sizes[start + i] ) );
+      }
+   }
+
+   fc::sha256 abc;
+   const char* abc_msg = "abc";
+   uint32_t abc_size = 3;
+   fc::sha256::hash_batch( &abc_msg, &abc_size, &abc, 1 );
+   BOOST_CHECK_EQUAL( "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f33315ad", (std::string) abc );
+
+   fc::sha256::hash_batch( nullptr, nullptr, nullptr, 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -45,6 +45,30 @@ namespace graphene { namespace net {
   const core_message_type_enum check_firewall_reply_message::type            = core_message_type_enum::check_firewall_reply_message_type;
   const core_message_type_enum get_current_connections_request_message::type = core_message_type_enum::get_current_connections_request_message_type;
   const core_message_type_enum get_current_connections_reply_message::type   = core_message_type_enum::get_current_connections_reply_message_type;
+  const core_message_type_enum compact_block_message::type                   = core_message_type_enum::compact_block_message_type;
+  const core_message_type_enum fetch_block_transactions_message::type        = core_message_type_enum::fetch_block_transactions_message_type;
+  const core_message_type_enum block_transactions_message::type              = core_message_type_enum::block_transactions_message_type;
+  const core_message_type_enum fetch_block_log_segment_message::type         = core_message_type_enum::fetch_block_log_segment_message_type;
+  const core_message_type_enum block_log_segment_message::type               = core_message_type_enum::block_log_segment_message_type;
+
+  short_transaction_id_type short_transaction_id( const transaction_id_type& id )
+  {
+    // Read in byte order so the short id sorts like the full id on any platform
+    const unsigned char* bytes = (const unsigned char*)id.data();
+    short_transaction_id_type short_id = 0;
+    for( size_t i = 0; i < sizeof(short_id); ++i )
+      short_id = ( short_id << 8 ) | bytes[i];
+    return short_id;
+  }
+
+  compact_block_message::compact_block_message(const item_hash_t& block_message_hash, const signed_block& block) :
+    block_message_hash(block_message_hash),
+    header(block)
+  {
+    short_transaction_ids.reserve(block.transactions.size());
+    for (const signed_transaction& trx : block.transactions)
+      short_transaction_ids.push_back(short_transaction_id(trx.id()));
+  }
 
 } } // graphene::net
 
@@ -37,6 +37,17 @@
  * 2MiB
  */
 #define MAX_MESSAGE_SIZE                                     1024*1024*2
+
+/**
+ * The most memory kept in unused buffers for encrypting and decrypting
+ * messages, see message_buffer_pool.  Enough for a few full size messages.
+ */
+#define GRAPHENE_NET_MESSAGE_BUFFER_POOL_MAX_BYTES           (32*1024*1024)
+
+/**
+ * The most bytes read from a peer's socket and decrypted at a time.
+ */
+#define GRAPHENE_NET_SOCKET_READ_BUFFER_SIZE                 (64*1024)
 #define GRAPHENE_NET_DEFAULT_PEER_CONNECTION_RETRY_TIME      30 // seconds
 
 /**
@@ -54,6 +65,7 @@
 #define GRAPHENE_NET_DEFAULT_P2P_PORT                        1776
 #define GRAPHENE_NET_DEFAULT_DESIRED_CONNECTIONS             20
 #define GRAPHENE_NET_DEFAULT_MAX_CONNECTIONS                 200
+#define GRAPHENE_NET_DEFAULT_IO_THREADS                      2
 
 #define GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES        (1024 * 1024)
 
@@ -68,6 +80,13 @@
  */
 #define GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS        20
 
+/**
+ * The most memory the message cache may hold.  When a transaction flood
+ * fills it before the messages expire, the oldest messages are dropped
+ * early.  This is the default of node_configuration::message_cache_max_bytes.
+ */
+#define GRAPHENE_NET_DEFAULT_MESSAGE_CACHE_MAX_BYTES         (64*1024*1024)
+
 /**
  * We prevent a peer from offering us a list of blocks which, if we fetched them
  * all, would result in a blockchain that extended into the future.
@@ -81,6 +100,38 @@
 
 #define GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING      200
 
+/**
+ * During sync, the number of blocks kept requested from each peer follows
+ * the rate the peer delivers them at, so that a full request takes about
+ * this long to arrive.  It never drops below
+ * GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING or exceeds
+ * maximum_blocks_per_peer_during_syncing.
+ */
+#define GRAPHENE_NET_SYNC_REQUEST_TARGET_MILLISECONDS        2000
+#define GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING      10
+
+/**
+ * Peers are scored by the average time they take to deliver the items we
+ * request, raised by the share of requests they fail.  A score only counts
+ * once a peer answered GRAPHENE_NET_PEER_SCORE_MIN_SAMPLES requests, and the
+ * counts are halved past GRAPHENE_NET_PEER_SCORE_MAX_SAMPLES so old failures
+ * fade.  Every GRAPHENE_NET_SLOW_PEER_ROTATION_INTERVAL_SECONDS, a peer scoring
+ * worse than GRAPHENE_NET_SLOW_PEER_SCORE_FACTOR times the median is dropped
+ * to make room for another one.
+ */
+#define GRAPHENE_NET_PEER_SCORE_MIN_SAMPLES                  20
+#define GRAPHENE_NET_PEER_SCORE_MAX_SAMPLES                  1000
+#define GRAPHENE_NET_SLOW_PEER_SCORE_FACTOR                  4
+#define GRAPHENE_NET_SLOW_PEER_ROTATION_INTERVAL_SECONDS     600
+
+/**
+ * When bootstrapping from a peer's block log, the size of the block log
+ * segments requested at a time (kept below MAX_MESSAGE_SIZE), and how long
+ * to wait for the bootstrap peer to connect before syncing normally.
+ */
+#define GRAPHENE_NET_BLOCK_LOG_SEGMENT_BYTES                 (1024*1024*3/2)
+#define GRAPHENE_NET_BLOCK_LOG_BOOTSTRAP_TIMEOUT_SECONDS     60
+
 /**
  * During normal operation, how many items will be fetched from each
  * peer at a time.  This will only come into play when the network
@@ -88,11 +139,20 @@
  * as we find out about them, so only one item will be requested
  * at a time.
  *
- * No tests have been done to find the optimal value for this
- * parameter, so consider increasing or decreasing it if performance
- * during flooding is lacking.
+ * Requests to a peer are pipelined, more items are requested while
+ * earlier ones are still outstanding, so a burst of transactions does
+ * not wait on one round trip per item.  This is the default of
+ * node_configuration::maximum_items_per_peer_during_normal_operation.
+ */
+#define GRAPHENE_NET_MAX_ITEMS_PER_PEER_DURING_NORMAL_OPERATION  8
+
+/**
+ * How long new transactions are held to be advertised together in one
+ * inventory message per peer.  New blocks are always advertised right
+ * away, ahead of any transactions.  0 advertises transactions as soon
+ * as they are validated.
  */
-#define GRAPHENE_NET_MAX_ITEMS_PER_PEER_DURING_NORMAL_OPERATION  1
+#define GRAPHENE_NET_DEFAULT_TRANSACTION_ADVERTISE_BATCH_MILLISECONDS 0
 
 /**
  * Instead of fetching all item IDs from a peer, then fetching all blocks
@@ -44,6 +44,7 @@ namespace graphene { namespace net {
   using bears::protocol::block_id_type;
   using bears::protocol::transaction_id_type;
   using bears::protocol::signed_block;
+  using bears::protocol::signed_block_header;
 
   typedef fc::ecc::public_key_data node_id_t;
   typedef fc::ripemd160 item_hash_t;
@@ -86,6 +87,11 @@ namespace graphene { namespace net {
     check_firewall_reply_message_type            = 5015,
     get_current_connections_request_message_type = 5016,
     get_current_connections_reply_message_type   = 5017,
+    compact_block_message_type                   = 5018,
+    fetch_block_transactions_message_type        = 5019,
+    block_transactions_message_type              = 5020,
+    fetch_block_log_segment_message_type         = 5021,
+    block_log_segment_message_type               = 5022,
     core_message_type_last                       = 5099
   };
 
@@ -115,6 +121,92 @@ namespace graphene { namespace net {
 
    };
 
+  /** The first 8 bytes of a transaction id, enough to find the transaction among those recently relayed */
+  typedef uint64_t short_transaction_id_type;
+  short_transaction_id_type short_transaction_id( const transaction_id_type& id );
+
+  /**
+   *  Sent instead of a block_message to peers that support compact blocks. Peers have usually
+   *  seen every transaction of a new block relayed on its own seconds before, so the block is
+   *  sent as its header and short transaction ids. The receiver rebuilds the block from the
+   *  transactions it has cached and fetches the rest with a fetch_block_transactions_message.
+   */
+  struct compact_block_message
+  {
+    static const core_message_type_enum type;
+
+    item_hash_t                               block_message_hash; ///< hash of the block_message the block is rebuilt into
+    signed_block_header                       header;
+    std::vector<short_transaction_id_type>    short_transaction_ids;
+
+    compact_block_message() {}
+    compact_block_message(const item_hash_t& block_message_hash, const signed_block& block);
+  };
+
+  struct fetch_block_transactions_message
+  {
+    static const core_message_type_enum type;
+
+    item_hash_t           block_message_hash;
+    std::vector<uint32_t> transaction_indexes;
+
+    fetch_block_transactions_message() {}
+    fetch_block_transactions_message(const item_hash_t& block_message_hash, const std::vector<uint32_t>& transaction_indexes) :
+      block_message_hash(block_message_hash),
+      transaction_indexes(transaction_indexes)
+    {}
+  };
+
+  struct block_transactions_message
+  {
+    static const core_message_type_enum type;
+
+    item_hash_t                     block_message_hash;
+    std::vector<signed_transaction> transactions;
+
+    block_transactions_message() {}
+    block_transactions_message(const item_hash_t& block_message_hash) :
+      block_message_hash(block_message_hash)
+    {}
+  };
+
+  /**
+   *  Asks a peer that serves its block log for the blocks following first_block_num - 1 as they
+   *  are stored in the block log, up to about max_bytes of them. Used to bootstrap a new node
+   *  from a trusted peer without fetching and pushing the blocks one at a time.
+   */
+  struct fetch_block_log_segment_message
+  {
+    static const core_message_type_enum type;
+
+    uint32_t first_block_num;
+    uint32_t max_bytes;
+
+    fetch_block_log_segment_message() {}
+    fetch_block_log_segment_message(uint32_t first_block_num, uint32_t max_bytes) :
+      first_block_num(first_block_num),
+      max_bytes(max_bytes)
+    {}
+  };
+
+  /** A segment of the block log, block_count is 0 when the peer has nothing to send */
+  struct block_log_segment_message
+  {
+    static const core_message_type_enum type;
+
+    uint32_t          first_block_num;
+    uint32_t          block_count;
+    uint64_t          first_block_position; ///< position of the first block in the peer's block log
+    std::vector<char> data;
+
+    block_log_segment_message() {}
+    block_log_segment_message(uint32_t first_block_num) :
+      first_block_num(first_block_num),
+      block_count(0),
+      first_block_position(0)
+    {}
+  };
+
   struct item_ids_inventory_message
   {
     static const core_message_type_enum type;
@@ -421,10 +513,20 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (check_firewall_reply_message_type)
                  (get_current_connections_request_message_type)
                  (get_current_connections_reply_message_type)
+                 (compact_block_message_type)
+                 (fetch_block_transactions_message_type)
+                 (block_transactions_message_type)
+                 (fetch_block_log_segment_message_type)
+                 (block_log_segment_message_type)
                  (core_message_type_last) )
 
 FC_REFLECT( graphene::net::trx_message, (trx) )
 FC_REFLECT( graphene::net::block_message, (block)(block_id) )
+FC_REFLECT( graphene::net::compact_block_message, (block_message_hash)(header)(short_transaction_ids) )
+FC_REFLECT( graphene::net::fetch_block_transactions_message, (block_message_hash)(transaction_indexes) )
+FC_REFLECT( graphene::net::block_transactions_message, (block_message_hash)(transactions) )
+FC_REFLECT( graphene::net::fetch_block_log_segment_message, (first_block_num)(max_bytes) )
+FC_REFLECT( graphene::net::block_log_segment_message, (first_block_num)(block_count)(first_block_position)(data) )
 
 FC_REFLECT( graphene::net::item_id, (item_type)
                                (item_hash) )
@@ -28,6 +28,7 @@
 #include <fc/io/raw.hpp>
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/reflect/variant.hpp>
+#include <fc/optional.hpp>
 
 namespace graphene { namespace net {
 
@@ -56,10 +57,10 @@ namespace graphene { namespace net {
      message(){}
 
      message( message&& m )
-     :message_header(m),data( std::move(m.data) ){}
+     :message_header(m),data( std::move(m.data) ),_id( std::move(m._id) ){}
 
      message( const message& m )
-     :message_header(m),data( m.data ){}
+     :message_header(m),data( m.data ),_id( m._id ){}
 
      /**
       *  Assumes that T::type specifies the message type
@@ -74,9 +75,21 @@ namespace graphene { namespace net {
 
      fc::uint160_t id()const
      {
+        if( _id )
+           return *_id;
         return fc::ripemd160::hash( data.data(), (uint32_t)data.size() );
      }
 
+     /**
+      *  Hashes the message now so later calls to id() don't have to, used to hash received
+      *  messages before they reach the node thread.  Call it again after changing data.
+      */
+     void cache_id()
+     {
+        _id.reset();
+        _id = id();
+     }
+
      /**
       *  Automatically checks the type and deserializes T in the
       *  opposite process from the constructor.
@@ -106,6 +119,9 @@ namespace graphene { namespace net {
               ("msg_type", msg_type)
               );
      }
+
+  private:
+     fc::optional<fc::uint160_t> _id;
   };
 
 
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#pragma once
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace graphene { namespace net {
+
+  /**
+   *  Hands out the buffers peer connections encrypt into and decrypt from.  Buffers are sized
+   *  in powers of two and go back to the pool when the last reference to them is dropped, so
+   *  sending a block to every peer reuses the same few buffers instead of allocating one per
+   *  peer.  The pool is shared by all connections and may be used from any thread.
+   */
+  class message_buffer_pool
+  {
+  public:
+     static message_buffer_pool& instance();
+
+     /** Returns a buffer of at least size bytes */
+     std::shared_ptr<char> get_buffer( size_t size );
+
+     /** Bytes held in buffers that are not in use, at most GRAPHENE_NET_MESSAGE_BUFFER_POOL_MAX_BYTES */
+     size_t get_free_bytes() const;
+
+  private:
+     message_buffer_pool();
+
+     void release_buffer( char* buffer, size_t size_class );
+
+     mutable std::mutex              _mutex;
+     /** free buffers of 2^size_class bytes, indexed by size_class */
+     std::vector<std::vector<char*>> _free_buffers;
+     size_t                          _free_bytes = 0;
+  };
+
+} } // graphene::net
@@ -25,6 +25,10 @@
 #include <fc/network/tcp_socket.hpp>
 #include <graphene/net/message.hpp>
 
+#include <memory>
+
+namespace fc { class thread; }
+
 namespace graphene { namespace net {
 
   namespace detail { class message_oriented_connection_impl; }
@@ -43,7 +47,12 @@ namespace graphene { namespace net {
   class message_oriented_connection
   {
      public:
-       message_oriented_connection(message_oriented_connection_delegate* delegate = nullptr);
+       /**
+        * When io_thread is given, the socket is read and written, and messages are encrypted, decrypted
+        * and framed on that thread.  The delegate is always called on the thread that created the connection.
+        */
+       message_oriented_connection(message_oriented_connection_delegate* delegate = nullptr,
+                                   std::shared_ptr<fc::thread> io_thread = std::shared_ptr<fc::thread>());
        ~message_oriented_connection();
        fc::tcp_socket& get_socket();
 
@@ -52,6 +61,8 @@ namespace graphene { namespace net {
        void connect_to(const fc::ip::endpoint& remote_endpoint);
 
        void send_message(const message& message_to_send);
+       /** sends a message shared with other connections, it is encrypted without being copied */
+       void send_message(std::shared_ptr<const message> message_to_send);
        void close_connection();
        void destroy_connection(const char* caller);
 
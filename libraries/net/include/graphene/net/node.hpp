@@ -53,6 +53,7 @@ namespace graphene { namespace net {
     fc::time_point received_time;
     fc::time_point validated_time;
     node_id_t originating_peer;
+    fc::time_point advertised_time; ///< when we first advertised the item to our peers, unset until then
   };
 
    /**
@@ -169,6 +170,21 @@ namespace graphene { namespace net {
 
          virtual void error_encountered(const std::string& message, const fc::oexception& error) = 0;
 
+         /**
+          *  Reads the blocks from first_block_num on as they are stored in the block log, up to
+          *  about max_bytes of them. Returns the number of blocks read, 0 if there are none.
+          */
+         virtual uint32_t get_block_log_segment(uint32_t first_block_num, uint32_t max_bytes,
+                                                std::vector<char>& data, uint64_t& first_block_position) = 0;
+
+         /**
+          *  Imports the irreversible blocks of a segment of a trusted peer's block log.
+          *  Returns the new head block number.
+          *
+          *  @throws exception if the segment does not continue our chain or a block is invalid
+          */
+         virtual uint32_t handle_block_log_segment(const graphene::net::block_log_segment_message& segment) = 0;
+
    };
 
    /**
@@ -327,5 +343,5 @@ namespace graphene { namespace net {
 
 } } // graphene::net
 
-FC_REFLECT(graphene::net::message_propagation_data, (received_time)(validated_time)(originating_peer));
+FC_REFLECT(graphene::net::message_propagation_data, (received_time)(validated_time)(originating_peer)(advertised_time));
 FC_REFLECT( graphene::net::peer_status, (version)(host)(info) );
@@ -4,6 +4,7 @@
 
 #include <fc/crypto/elliptic.hpp>
 #include <fc/network/ip.hpp>
+#include <fc/optional.hpp>
 
 namespace graphene { namespace net {
 
@@ -37,7 +38,23 @@ struct node_configuration
    uint32_t maximum_number_of_blocks_to_handle_at_one_time = GRAPHENE_NET_MAX_NUMBER_OF_BLOCKS_TO_HANDLE_AT_ONE_TIME;
    uint32_t maximum_number_of_sync_blocks_to_prefetch = GRAPHENE_NET_MAX_NUMBER_OF_BLOCKS_TO_PREFETCH;
    uint32_t maximum_blocks_per_peer_during_syncing = GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING;
+   /** number of transactions and blocks that may be requested from a peer at once during normal operation */
+   uint32_t maximum_items_per_peer_during_normal_operation = GRAPHENE_NET_MAX_ITEMS_PER_PEER_DURING_NORMAL_OPERATION;
+   /** how long new transactions are collected before they are advertised, new blocks are never held */
+   uint32_t transaction_advertise_batch_milliseconds = GRAPHENE_NET_DEFAULT_TRANSACTION_ADVERTISE_BATCH_MILLISECONDS;
    int64_t active_ignored_request_timeout_microseconds = 6000000;
+   /** most bytes of received messages kept to be served to peers, the oldest are dropped first */
+   uint64_t message_cache_max_bytes = GRAPHENE_NET_DEFAULT_MESSAGE_CACHE_MAX_BYTES;
+   /** send new blocks as compact_block_messages to peers that support them, and tell peers we do */
+   bool compact_blocks_enabled = true;
+   /** number of threads that read, write, encrypt and frame peer messages, 0 does it all on the p2p thread */
+   uint32_t io_threads = GRAPHENE_NET_DEFAULT_IO_THREADS;
+   /** answer fetch_block_log_segment_messages with segments of our block log */
+   bool serve_block_log = false;
+   /** before syncing, import the irreversible blocks of this trusted peer's block log */
+   fc::optional<fc::ip::endpoint> block_log_bootstrap_peer;
+   /** periodically disconnect a peer that is much slower than the others to try another one */
+   bool rotate_out_slow_peers = true;
 };
 
 } }
@@ -55,5 +72,13 @@ FC_REFLECT(graphene::net::node_configuration,
    (maximum_number_of_blocks_to_handle_at_one_time)
    (maximum_number_of_sync_blocks_to_prefetch)
    (maximum_blocks_per_peer_during_syncing)
+   (maximum_items_per_peer_during_normal_operation)
+   (transaction_advertise_batch_milliseconds)
    (active_ignored_request_timeout_microseconds)
+   (message_cache_max_bytes)
+   (compact_blocks_enabled)
+   (io_threads)
+   (serve_block_log)
+   (block_log_bootstrap_peer)
+   (rotate_out_slow_peers)
 )
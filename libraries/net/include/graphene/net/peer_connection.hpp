@@ -40,7 +40,9 @@
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 
+#include <map>
 #include <queue>
+#include <vector>
 #include <boost/container/deque.hpp>
 #include <fc/thread/future.hpp>
 
@@ -68,7 +70,10 @@ namespace graphene { namespace net
       virtual void on_message(peer_connection* originating_peer,
                               const message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
-      virtual message get_message_for_item(const item_id& item) = 0;
+      /** the message may be shared with the message cache and other peers and must not be changed */
+      virtual std::shared_ptr<const message> get_message_for_item(const item_id& item) = 0;
+      /** the thread new connections do their socket I/O on, or null to do it on the delegate's thread */
+      virtual std::shared_ptr<fc::thread> get_io_thread() { return std::shared_ptr<fc::thread>(); }
     };
 
     class peer_connection;
@@ -123,7 +128,7 @@ namespace graphene { namespace net
           enqueue_time(enqueue_time)
         {}
 
-        virtual message get_message(peer_connection_delegate* node) = 0;
+        virtual std::shared_ptr<const message> get_message(peer_connection_delegate* node) = 0;
         /** returns roughly the number of bytes of memory the message is consuming while
          * it is sitting on the queue
          */
@@ -136,16 +141,31 @@ namespace graphene { namespace net
        */
       struct real_queued_message : queued_message
       {
-        message        message_to_send;
+        std::shared_ptr<message> message_to_send;
         size_t         message_send_time_field_offset;
 
         real_queued_message(message message_to_send,
                             size_t message_send_time_field_offset = (size_t)-1) :
-          message_to_send(std::move(message_to_send)),
+          message_to_send(std::make_shared<message>(std::move(message_to_send))),
           message_send_time_field_offset(message_send_time_field_offset)
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        std::shared_ptr<const message> get_message(peer_connection_delegate* node) override;
+        size_t get_size_in_queue() override;
+      };
+
+      /* when you queue up a 'shared_queued_message', the message is shared with
+       * the message cache and the queues of other peers instead of being copied
+       */
+      struct shared_queued_message : queued_message
+      {
+        std::shared_ptr<const message> message_to_send;
+
+        shared_queued_message(std::shared_ptr<const message> message_to_send) :
+          message_to_send(std::move(message_to_send))
+        {}
+
+        std::shared_ptr<const message> get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
@@ -161,7 +181,7 @@ namespace graphene { namespace net
           item_to_send(std::move(item_to_send))
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        std::shared_ptr<const message> get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
@@ -208,6 +228,7 @@ namespace graphene { namespace net
       fc::optional<std::string> platform;
       fc::optional<uint32_t> bitness;
       fc::optional<bears::protocol::chain_id_type> chain_id;
+      bool supports_compact_blocks = false; /// the peer accepts compact_block_messages in place of block_messages
 
       // for inbound connections, these fields record what the peer sent us in
       // its hello message.  For outbound, they record what we sent the peer
@@ -229,11 +250,20 @@ namespace graphene { namespace net
       fc::optional<boost::tuple<std::vector<item_hash_t>, fc::time_point> > item_ids_requested_from_peer; /// we check this to detect a timed-out request and in busy()
       fc::time_point last_sync_item_received_time; /// the time we received the last sync item or the time we sent the last batch of sync item requests to this peer
       std::set<item_hash_t> sync_items_requested_from_peer; /// ids of blocks we've requested from this peer during sync.  fetch from another peer if this peer disconnects
+      fc::time_point last_sync_block_time; /// the time the last sync block arrived from this peer, or the time we requested blocks while none were outstanding
+      double sync_block_interval_us = 0; /// moving average of the time between sync blocks arriving from this peer, 0 until measured
       item_hash_t last_block_delegate_has_seen; /// the hash of the last block  this peer has told us about that the peer knows
       fc::time_point_sec last_block_time_delegate_has_seen;
       bool inhibit_fetching_sync_blocks = false;
       /// @}
 
+      /// how well this peer answers our item requests, seeded from and saved to its potential_peer_record
+      /// @{
+      double item_latency_us = 0; /// moving average of the time between requesting an item and receiving it, 0 until measured
+      uint32_t items_received = 0;
+      uint32_t item_requests_failed = 0; /// item requests the peer answered with item_not_available or let time out
+      /// @}
+
       /// latency timing data
       std::unordered_map< item_hash_t, fc::time_point > pending_item_request_times;
       /// @}
@@ -259,6 +289,15 @@ namespace graphene { namespace net
       timestamped_items_set_type inventory_advertised_to_peer;
 
       item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
+
+      /** a block this peer sent as a compact_block_message, waiting for the transactions we did not have */
+      struct partial_compact_block
+      {
+        signed_block          block;
+        std::vector<uint32_t> requested_indexes;
+        bool                  requested_all_transactions = false;
+      };
+      std::map<item_hash_t, partial_compact_block> partial_compact_blocks; /// by the hash of the block message
       /// @}
 
       // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -292,6 +331,7 @@ namespace graphene { namespace net
 
       void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
       void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
+      void send_message(std::shared_ptr<const message> message_to_send);
       void send_item(const item_id& item_to_send);
       void close_connection();
       void destroy_connection(const char* caller);
@@ -324,6 +364,20 @@ namespace graphene { namespace net
     };
     typedef std::shared_ptr<peer_connection> peer_connection_ptr;
 
+    /**
+     * Lower is better, 0 means the peer has not been measured.  The average delivery time is
+     * divided by the share of requests the peer answers, so a peer failing half of them scores
+     * as if it were twice as slow.
+     */
+    double compute_peer_score(double item_latency_us, uint32_t items_received, uint32_t item_requests_failed);
+
+    /**
+     * Returns the index of the worst of the given peer scores when it is more than
+     * GRAPHENE_NET_SLOW_PEER_SCORE_FACTOR times their median, -1 when there is no such peer or fewer
+     * than three scores to compare.  The median is written to median_score.
+     */
+    int find_slow_peer(const std::vector<double>& scores, double& median_score);
+
  } } // end namespace graphene::net
 
 // not sent over the wire, just reflected for logging
@@ -52,10 +52,19 @@ namespace graphene { namespace net {
     uint32_t                          number_of_successful_connection_attempts;
     uint32_t                          number_of_failed_connection_attempts;
     fc::optional<fc::exception>       last_error;
+    /// measured the last time we were connected, 0 if never measured
+    uint32_t                          item_latency_us;
+    uint32_t                          sync_block_interval_us;
+    uint32_t                          number_of_items_received;
+    uint32_t                          number_of_item_requests_failed;
 
     potential_peer_record() :
       number_of_successful_connection_attempts(0),
-    number_of_failed_connection_attempts(0){}
+      number_of_failed_connection_attempts(0),
+      item_latency_us(0),
+      sync_block_interval_us(0),
+      number_of_items_received(0),
+      number_of_item_requests_failed(0){}
 
     potential_peer_record(fc::ip::endpoint endpoint,
                           fc::time_point_sec last_seen_time = fc::time_point_sec(),
@@ -64,7 +73,11 @@ namespace graphene { namespace net {
       last_seen_time(last_seen_time),
       last_connection_disposition(last_connection_disposition),
       number_of_successful_connection_attempts(0),
-      number_of_failed_connection_attempts(0)
+      number_of_failed_connection_attempts(0),
+      item_latency_us(0),
+      sync_block_interval_us(0),
+      number_of_items_received(0),
+      number_of_item_requests_failed(0)
     {}  
   };
 
@@ -119,4 +132,4 @@ namespace graphene { namespace net {
 } } // end namespace graphene::net
 
 FC_REFLECT_ENUM(graphene::net::potential_peer_last_connection_disposition, (never_attempted_to_connect)(last_connection_failed)(last_connection_rejected)(last_connection_handshaking_failed)(last_connection_succeeded))
-FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(last_error) )
+FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(last_error)(item_latency_us)(sync_block_interval_us)(number_of_items_received)(number_of_item_requests_failed) )
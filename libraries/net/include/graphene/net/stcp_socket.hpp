@@ -50,6 +50,12 @@ class stcp_socket : public virtual fc::iostream
     virtual size_t   writesome( const char* buffer, size_t len );
     virtual size_t   writesome( const std::shared_ptr<const char>& buf, size_t len, size_t offset );
 
+    /**
+     *  Writes a message header and body followed by zero padding up to a multiple of 16 bytes.
+     *  Both are encrypted straight from where they are, without framing them in another buffer.
+     */
+    void             write_framed( const char* header, size_t header_len, const char* body, size_t body_len );
+
     virtual void     flush();
     virtual void     close();
 
@@ -66,8 +72,6 @@ class stcp_socket : public virtual fc::iostream
     fc::tcp_socket       _sock;
     fc::aes_encoder      _send_aes;
     fc::aes_decoder      _recv_aes;
-    std::shared_ptr<char> _read_buffer;
-    std::shared_ptr<char> _write_buffer;
 #ifndef NDEBUG
     bool _read_buffer_in_use;
     bool _write_buffer_in_use;
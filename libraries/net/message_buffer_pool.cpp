@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <graphene/net/message_buffer_pool.hpp>
+#include <graphene/net/config.hpp>
+
+namespace graphene { namespace net {
+
+  namespace
+  {
+    const size_t min_size_class = 12; // 4KB
+    const size_t max_size_class = 22; // 4MB, above MAX_MESSAGE_SIZE with its padding
+    static_assert( (size_t(1) << max_size_class) >= MAX_MESSAGE_SIZE + 16, "largest pooled buffer can not hold a message" );
+  }
+
+  message_buffer_pool& message_buffer_pool::instance()
+  {
+    // never destroyed, buffers still held by canceled socket operations may come back during shutdown
+    static message_buffer_pool* pool = new message_buffer_pool();
+    return *pool;
+  }
+
+  message_buffer_pool::message_buffer_pool() :
+    _free_buffers( max_size_class + 1 )
+  {}
+
+  std::shared_ptr<char> message_buffer_pool::get_buffer( size_t size )
+  {
+    size_t size_class = min_size_class;
+    while( size_class <= max_size_class && ( size_t(1) << size_class ) < size )
+      ++size_class;
+
+    // larger buffers than any message needs are not pooled
+    if( size_class > max_size_class )
+      return std::shared_ptr<char>( new char[size], []( char* p ){ delete[] p; } );
+
+    char* buffer = nullptr;
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      if( !_free_buffers[size_class].empty() )
+      {
+        buffer = _free_buffers[size_class].back();
+        _free_buffers[size_class].pop_back();
+        _free_bytes -= size_t(1) << size_class;
+      }
+    }
+    if( !buffer )
+      buffer = new char[size_t(1) << size_class];
+
+    return std::shared_ptr<char>( buffer, [this, size_class]( char* p ){ release_buffer( p, size_class ); } );
+  }
+
+  void message_buffer_pool::release_buffer( char* buffer, size_t size_class )
+  {
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      if( _free_bytes + ( size_t(1) << size_class ) <= GRAPHENE_NET_MESSAGE_BUFFER_POOL_MAX_BYTES )
+      {
+        _free_buffers[size_class].push_back( buffer );
+        _free_bytes += size_t(1) << size_class;
+        return;
+      }
+    }
+    delete[] buffer;
+  }
+
+  size_t message_buffer_pool::get_free_bytes() const
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    return _free_bytes;
+  }
+
+} } // graphene::net
@@ -41,8 +41,10 @@
 
 #ifndef NDEBUG
 # define VERIFY_CORRECT_THREAD() assert(_thread->is_current())
+# define VERIFY_IO_THREAD() assert(get_io_thread().is_current())
 #else
 # define VERIFY_CORRECT_THREAD() do {} while (0)
+# define VERIFY_IO_THREAD() do {} while (0)
 #endif
 
 namespace graphene { namespace net {
@@ -55,19 +57,34 @@ namespace graphene { namespace net {
       message_oriented_connection_delegate *_delegate;
       stcp_socket _sock;
       fc::future<void> _read_loop_done;
-      uint64_t _bytes_received;
-      uint64_t _bytes_sent;
+      /** the last message handed to the delegate, the read loop waits for it before handing over the next */
+      fc::future<void> _message_delivered;
+      std::atomic<uint64_t> _bytes_received;
+      std::atomic<uint64_t> _bytes_sent;
 
-      fc::time_point _connected_time;
-      fc::time_point _last_message_received_time;
-      fc::time_point _last_message_sent_time;
+      // written on the I/O thread and read from the delegate's thread
+      std::atomic<int64_t> _connected_time;
+      std::atomic<int64_t> _last_message_received_time;
+      std::atomic<int64_t> _last_message_sent_time;
+
+      /** set on the delegate's thread when handling a message threw, no further message is handed over */
+      std::atomic<bool> _message_handling_failed;
 
       bool _send_message_in_progress;
-#ifndef NDEBUG
+
+      /** the thread the connection was created on, the delegate is always called on it */
       fc::thread* _thread;
-#endif
+      /** socket reads and writes, encryption and message framing run on this thread, when set */
+      std::shared_ptr<fc::thread> _io_thread;
+      std::atomic<uint32_t> _io_tasks_in_flight;
+
+      fc::thread& get_io_thread() const { return _io_thread ? *_io_thread : *_thread; }
+      template<typename Functor>
+      void run_on_io_thread(Functor&& f, const char* desc);
 
       void read_loop();
+      void deliver_message(message&& received_message);
+      void on_message_handling_failed(const message& failed_message, const std::string& error);
       void start_read_loop();
     public:
       fc::tcp_socket& get_socket();
@@ -76,10 +93,11 @@ namespace graphene { namespace net {
       void bind(const fc::ip::endpoint& local_endpoint);
 
       message_oriented_connection_impl(message_oriented_connection* self,
-                                       message_oriented_connection_delegate* delegate = nullptr);
+                                       message_oriented_connection_delegate* delegate = nullptr,
+                                       std::shared_ptr<fc::thread> io_thread = std::shared_ptr<fc::thread>());
       ~message_oriented_connection_impl();
 
-      void send_message(const message& message_to_send);
+      void send_message(std::shared_ptr<const message> message_to_send);
       void close_connection();
       void destroy_connection(const char* caller);
 
@@ -88,20 +106,25 @@ namespace graphene { namespace net {
 
       fc::time_point get_last_message_sent_time() const;
       fc::time_point get_last_message_received_time() const;
-      fc::time_point get_connection_time() const { return _connected_time; }
+      fc::time_point get_connection_time() const { return fc::time_point(fc::microseconds(_connected_time)); }
       fc::sha512 get_shared_secret() const;
     };
 
     message_oriented_connection_impl::message_oriented_connection_impl(message_oriented_connection* self,
-                                                                       message_oriented_connection_delegate* delegate)
+                                                                       message_oriented_connection_delegate* delegate,
+                                                                       std::shared_ptr<fc::thread> io_thread)
     : _self(self),
       _delegate(delegate),
       _bytes_received(0),
       _bytes_sent(0),
-      _send_message_in_progress(false)
-#ifndef NDEBUG
-      ,_thread(&fc::thread::current())
-#endif
+      _connected_time(0),
+      _last_message_received_time(0),
+      _last_message_sent_time(0),
+      _message_handling_failed(false),
+      _send_message_in_progress(false),
+      _thread(&fc::thread::current()),
+      _io_thread(std::move(io_thread)),
+      _io_tasks_in_flight(0)
     {
     }
     message_oriented_connection_impl::~message_oriented_connection_impl()
@@ -110,6 +133,29 @@ namespace graphene { namespace net {
       destroy_connection(__FUNCTION__);
     }
 
+    /**
+     * Runs f on the I/O thread and waits for it.  The caller may be canceled while f is still
+     * running, so f is counted in _io_tasks_in_flight and destroy_connection() waits for it.
+     */
+    template<typename Functor>
+    void message_oriented_connection_impl::run_on_io_thread(Functor&& f, const char* desc)
+    {
+      if (!_io_thread || _io_thread->is_current())
+      {
+        f();
+        return;
+      }
+
+      ++_io_tasks_in_flight;
+      _io_thread->async([this, f = std::forward<Functor>(f)]() {
+        struct in_flight_guard {
+          std::atomic<uint32_t>& count;
+          ~in_flight_guard() { --count; }
+        } guard{_io_tasks_in_flight};
+        f();
+      }, desc).wait();
+    }
+
     fc::tcp_socket& message_oriented_connection_impl::get_socket()
     {
       VERIFY_CORRECT_THREAD();
@@ -119,17 +165,17 @@ namespace graphene { namespace net {
     void message_oriented_connection_impl::accept()
     {
       VERIFY_CORRECT_THREAD();
-      _sock.accept();
+      run_on_io_thread([this](){ _sock.accept(); }, "message accept");
       assert(!_read_loop_done.valid()); // check to be sure we never launch two read loops
-      _read_loop_done = fc::async([=](){ read_loop(); }, "message read_loop");
+      _read_loop_done = get_io_thread().async([=](){ read_loop(); }, "message read_loop");
     }
 
     void message_oriented_connection_impl::connect_to(const fc::ip::endpoint& remote_endpoint)
     {
       VERIFY_CORRECT_THREAD();
-      _sock.connect_to(remote_endpoint);
+      run_on_io_thread([this, &remote_endpoint](){ _sock.connect_to(remote_endpoint); }, "message connect_to");
       FC_ASSERT(!_read_loop_done.valid()); // check to be sure we never launch two read loops
-      _read_loop_done = fc::async([=](){ read_loop(); }, "message read_loop");
+      _read_loop_done = get_io_thread().async([=](){ read_loop(); }, "message read_loop");
     }
 
     void message_oriented_connection_impl::bind(const fc::ip::endpoint& local_endpoint)
@@ -138,23 +184,29 @@ namespace graphene { namespace net {
       _sock.bind(local_endpoint);
     }
 
+    /**
+     * Reads, decrypts and frames incoming messages on the I/O thread.  Each message is handed to
+     * the delegate on the connection's own thread, and the next one is read while the delegate
+     * handles it.  Messages are still handled one at a time and in order, the loop waits for the
+     * previous message to be handled before it hands over the next one.
+     */
     void message_oriented_connection_impl::read_loop()
     {
-      VERIFY_CORRECT_THREAD();
+      VERIFY_IO_THREAD();
       const int BUFFER_SIZE = 16;
       const int LEFTOVER = BUFFER_SIZE - sizeof(message_header);
       static_assert(BUFFER_SIZE >= sizeof(message_header), "insufficient buffer");
 
-      _connected_time = fc::time_point::now();
+      _connected_time = fc::time_point::now().time_since_epoch().count();
 
       fc::oexception exception_to_rethrow;
       bool call_on_connection_closed = false;
 
       try
       {
-        message m;
         while( true )
         {
+          message m;
           char buffer[BUFFER_SIZE];
           _sock.read(buffer, BUFFER_SIZE);
           _bytes_received += BUFFER_SIZE;
@@ -171,13 +223,14 @@ namespace graphene { namespace net {
             _bytes_received += remaining_bytes_with_padding;
           }
           m.data.resize(m.size); // truncate off the padding bytes
+          m.cache_id();
 
-          _last_message_received_time = fc::time_point::now();
+          _last_message_received_time = fc::time_point::now().time_since_epoch().count();
 
           try
           {
             // message handling errors are warnings...
-            _delegate->on_message(_self, m);
+            deliver_message(std::move(m));
           }
           /// Dedicated catches needed to distinguish from general fc::exception
           catch ( const fc::canceled_exception& e ) { throw e; }
@@ -220,13 +273,82 @@ namespace graphene { namespace net {
       }
 
       if (call_on_connection_closed)
-        _delegate->on_connection_closed(_self);
+      {
+        if (_io_thread)
+        {
+          try
+          {
+            if (_message_delivered.valid())
+              _message_delivered.wait();
+          }
+          catch (const fc::exception&)
+          {
+          }
+          _message_delivered = _thread->async([this](){ _delegate->on_connection_closed(_self); }, "message on_connection_closed");
+          _message_delivered.wait();
+        }
+        else
+          _delegate->on_connection_closed(_self);
+      }
 
       if (exception_to_rethrow)
         throw *exception_to_rethrow;
     }
 
-    void message_oriented_connection_impl::send_message(const message& message_to_send)
+    void message_oriented_connection_impl::deliver_message(message&& received_message)
+    {
+      if (!_io_thread)
+      {
+        _delegate->on_message(_self, received_message);
+        return;
+      }
+
+      if (_message_delivered.valid())
+        _message_delivered.wait();
+      FC_ASSERT(!_message_handling_failed, "not handing over further messages after failing to handle one");
+
+      // errors are handled on the delegate's thread as soon as they happen, the peer may never send
+      // another message that would let the read loop see them
+      _message_delivered = _thread->async([this, m = std::move(received_message)](){
+        try
+        {
+          _delegate->on_message(_self, m);
+        }
+        catch (const fc::canceled_exception&)
+        {
+          throw;
+        }
+        catch (const fc::exception& e)
+        {
+          on_message_handling_failed(m, e.to_detail_string());
+        }
+        catch (const std::exception& e)
+        {
+          on_message_handling_failed(m, e.what());
+        }
+      }, "message on_message");
+    }
+
+    /**
+     * Closes the socket, the read loop then stops and reports the connection closed the same way it
+     * does when handling a message fails on the I/O thread itself.
+     */
+    void message_oriented_connection_impl::on_message_handling_failed(const message& failed_message, const std::string& error)
+    {
+      VERIFY_CORRECT_THREAD();
+      wlog( "message transmission failed for message type ${type}: ${er}", ("type", failed_message.msg_type)("er", error) );
+      _message_handling_failed = true;
+      try
+      {
+        close_connection();
+      }
+      catch (const fc::exception& e)
+      {
+        wlog( "Exception thrown while closing the connection after a failed message, ignoring: ${e}", ("e", e) );
+      }
+    }
+
+    void message_oriented_connection_impl::send_message(std::shared_ptr<const message> message_to_send)
     {
       VERIFY_CORRECT_THREAD();
 #if 0 // this gets too verbose
@@ -255,30 +377,28 @@ namespace graphene { namespace net {
 
       try
       {
-        size_t size_of_message_and_header = sizeof(message_header) + message_to_send.size;
-        if( message_to_send.size > MAX_MESSAGE_SIZE )
+        size_t size_of_message_and_header = sizeof(message_header) + message_to_send->size;
+        if( message_to_send->size > MAX_MESSAGE_SIZE )
            elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
         //pad the message we send to a multiple of 16 bytes
         size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::unique_ptr<char[]> padded_message(new char[size_with_padding]);
 
-        memcpy(padded_message.get(), (char*)&message_to_send, sizeof(message_header));
-        memcpy(padded_message.get() + sizeof(message_header), message_to_send.data.data(), message_to_send.size );
-        char* paddingSpace = padded_message.get() + sizeof(message_header) + message_to_send.size;
-        size_t toClean = size_with_padding - size_of_message_and_header;
-        memset(paddingSpace, 0, toClean);
-
-        _sock.write(padded_message.get(), size_with_padding);
-        _sock.flush();
+        // encrypting and writing happen on the I/O thread, the same thread that reads the socket.  The
+        // message is encrypted from where it is, a message queued for many peers is never copied.
+        run_on_io_thread([this, message_to_send](){
+          const message_header& header = *message_to_send;
+          _sock.write_framed((const char*)&header, sizeof(message_header), message_to_send->data.data(), message_to_send->size);
+          _sock.flush();
+        }, "message send_message");
         _bytes_sent += size_with_padding;
-        _last_message_sent_time = fc::time_point::now();
+        _last_message_sent_time = fc::time_point::now().time_since_epoch().count();
       } FC_RETHROW_EXCEPTIONS( warn, "unable to send message" );
     }
 
     void message_oriented_connection_impl::close_connection()
     {
       VERIFY_CORRECT_THREAD();
-      _sock.close();
+      run_on_io_thread([this](){ _sock.close(); }, "message close_connection");
     }
 
     void message_oriented_connection_impl::destroy_connection(const char* caller)
@@ -307,6 +427,31 @@ namespace graphene { namespace net {
       {
         wlog( "Exception thrown while canceling message_oriented_connection's read_loop, ignoring" );
       }
+
+      // a message may still be waiting to be handed to the delegate
+      try
+      {
+        _message_delivered.cancel_and_wait(__FUNCTION__);
+      }
+      catch ( const fc::exception& e )
+      {
+        wlog( "Exception thrown while canceling message_oriented_connection's message delivery, ignoring: ${e}", ("e",e) );
+      }
+      catch (...)
+      {
+        wlog( "Exception thrown while canceling message_oriented_connection's message delivery, ignoring" );
+      }
+
+      // sends and closes canceled while they were running on the I/O thread still use the socket
+      try
+      {
+        while (_io_tasks_in_flight)
+          fc::usleep(fc::milliseconds(1));
+      }
+      catch (...)
+      {
+        wlog( "Exception thrown while waiting for message_oriented_connection's socket operations, ignoring" );
+      }
     }
 
     uint64_t message_oriented_connection_impl::get_total_bytes_sent() const
@@ -324,13 +469,13 @@ namespace graphene { namespace net {
     fc::time_point message_oriented_connection_impl::get_last_message_sent_time() const
     {
       VERIFY_CORRECT_THREAD();
-      return _last_message_sent_time;
+      return fc::time_point(fc::microseconds(_last_message_sent_time));
     }
 
     fc::time_point message_oriented_connection_impl::get_last_message_received_time() const
     {
       VERIFY_CORRECT_THREAD();
-      return _last_message_received_time;
+      return fc::time_point(fc::microseconds(_last_message_received_time));
     }
 
     fc::sha512 message_oriented_connection_impl::get_shared_secret() const
@@ -342,8 +487,9 @@ namespace graphene { namespace net {
   } // end namespace graphene::net::detail
 
 
-  message_oriented_connection::message_oriented_connection(message_oriented_connection_delegate* delegate) :
-    my(new detail::message_oriented_connection_impl(this, delegate))
+  message_oriented_connection::message_oriented_connection(message_oriented_connection_delegate* delegate,
+                                                           std::shared_ptr<fc::thread> io_thread) :
+    my(new detail::message_oriented_connection_impl(this, delegate, std::move(io_thread)))
   {
   }
 
@@ -373,7 +519,12 @@ namespace graphene { namespace net {
 
   void message_oriented_connection::send_message(const message& message_to_send)
   {
-    my->send_message(message_to_send);
+    my->send_message(std::make_shared<const message>(message_to_send));
+  }
+
+  void message_oriented_connection::send_message(std::shared_ptr<const message> message_to_send)
+  {
+    my->send_message(std::move(message_to_send));
   }
 
   void message_oriented_connection::close_connection()
@@ -30,6 +30,7 @@
 #include <forward_list>
 #include <iostream>
 #include <algorithm>
+#include <limits>
 #include <tuple>
 #include <boost/tuple/tuple.hpp>
 #include <boost/circular_buffer.hpp>
@@ -133,61 +134,112 @@ namespace graphene { namespace net {
 
       struct message_hash_index{};
       struct message_contents_hash_index{};
-      struct block_clock_index{};
+      struct short_transaction_id_index{};
+      struct age_index{};
       struct message_info
       {
         message_hash_type message_hash;
-        message           message_body;
+        std::shared_ptr<const message> message_body; // shared with the peer queues the message is sent from
         uint32_t          block_clock_when_received;
 
         // for network performance stats
         message_propagation_data propagation_data;
         fc::uint160_t     message_contents_hash; // hash of whatever the message contains (if it's a transaction, this is the transaction id, if it's a block, it's the block_id)
+        short_transaction_id_type short_id; // short id of transactions, 0 for other messages
 
         message_info( const message_hash_type& message_hash,
-                      const message&           message_body,
+                      std::shared_ptr<const message> message_body,
                       uint32_t                 block_clock_when_received,
                       const message_propagation_data& propagation_data,
                       fc::uint160_t            message_contents_hash ) :
           message_hash( message_hash ),
-          message_body( message_body ),
+          message_body( std::move( message_body ) ),
           block_clock_when_received( block_clock_when_received ),
           propagation_data( propagation_data ),
-          message_contents_hash( message_contents_hash )
+          message_contents_hash( message_contents_hash ),
+          short_id( this->message_body->msg_type == trx_message_type ? short_transaction_id( message_contents_hash ) : 0 )
         {}
+
+        /** roughly the memory held by the entry, used to bound the size of the cache */
+        size_t size_in_bytes() const { return sizeof( message_info ) + sizeof( message ) + message_body->data.size(); }
       };
+      // Lookups are by hash only, entries are kept in the order they were received so the oldest
+      // are expired first, both when blocks go by and when the cache is over its size limit
       typedef boost::multi_index_container
         < message_info,
-            bmi::indexed_by< bmi::ordered_unique< bmi::tag<message_hash_index>,
-                                                  bmi::member<message_info, message_hash_type, &message_info::message_hash> >,
-                             bmi::ordered_non_unique< bmi::tag<message_contents_hash_index>,
-                                                      bmi::member<message_info, fc::uint160_t, &message_info::message_contents_hash> >,
-                             bmi::ordered_non_unique< bmi::tag<block_clock_index>,
-                                                      bmi::member<message_info, uint32_t, &message_info::block_clock_when_received> > >
+            bmi::indexed_by< bmi::hashed_unique< bmi::tag<message_hash_index>,
+                                                 bmi::member<message_info, message_hash_type, &message_info::message_hash>,
+                                                 std::hash<message_hash_type> >,
+                             bmi::hashed_non_unique< bmi::tag<message_contents_hash_index>,
+                                                     bmi::member<message_info, fc::uint160_t, &message_info::message_contents_hash>,
+                                                     std::hash<fc::uint160_t> >,
+                             bmi::hashed_non_unique< bmi::tag<short_transaction_id_index>,
+                                                     bmi::member<message_info, short_transaction_id_type, &message_info::short_id> >,
+                             bmi::sequenced< bmi::tag<age_index> > >
         > message_cache_container;
 
       message_cache_container _message_cache;
 
       uint32_t block_clock;
 
+      uint64_t _size_in_bytes = 0;
+      uint64_t _max_size_in_bytes = GRAPHENE_NET_DEFAULT_MESSAGE_CACHE_MAX_BYTES;
+
+      mutable uint64_t _hits = 0;
+      mutable uint64_t _misses = 0;
+      uint64_t _evictions = 0;
+
+      void erase_oldest();
+
     public:
       blockchain_tied_message_cache() :
         block_clock( 0 )
       {}
       void block_accepted();
+      /** Limits the memory held by the cache, the oldest messages are evicted first */
+      void set_max_size_in_bytes( uint64_t max_size_in_bytes );
       void cache_message( const message& message_to_cache, const message_hash_type& hash_of_message_to_cache,
                         const message_propagation_data& propagation_data, const fc::uint160_t& message_content_hash );
-      message get_message( const message_hash_type& hash_of_message_to_lookup );
+      /** Returns the cached message without copying it, or a null pointer if it is not in the cache */
+      std::shared_ptr<const message> find_message( const message_hash_type& hash_of_message_to_lookup ) const;
+      message get_message( const message_hash_type& hash_of_message_to_lookup ) const;
+      bool get_transaction( short_transaction_id_type short_id, signed_transaction& trx ) const;
       message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
+      /** Records when the message was first advertised, returns the time it was received or time_point() if unknown */
+      fc::time_point message_advertised( const message_hash_type& hash_of_message, const fc::time_point& advertised_time );
       size_t size() const { return _message_cache.size(); }
+      uint64_t size_in_bytes() const { return _size_in_bytes; }
+      uint64_t hits() const { return _hits; }
+      uint64_t misses() const { return _misses; }
+      uint64_t evictions() const { return _evictions; }
     };
 
+    void blockchain_tied_message_cache::erase_oldest()
+    {
+      auto& index = _message_cache.get<age_index>();
+      _size_in_bytes -= index.front().size_in_bytes();
+      index.pop_front();
+    }
+
     void blockchain_tied_message_cache::block_accepted()
     {
       ++block_clock;
       if( block_clock > cache_duration_in_blocks )
-        _message_cache.get<block_clock_index>().erase(_message_cache.get<block_clock_index>().begin(),
-                                                      _message_cache.get<block_clock_index>().lower_bound(block_clock - cache_duration_in_blocks ) );
+      {
+        const auto& index = _message_cache.get<age_index>();
+        while( !index.empty() && index.front().block_clock_when_received < block_clock - cache_duration_in_blocks )
+          erase_oldest();
+      }
+    }
+
+    void blockchain_tied_message_cache::set_max_size_in_bytes( uint64_t max_size_in_bytes )
+    {
+      _max_size_in_bytes = max_size_in_bytes;
+      while( _size_in_bytes > _max_size_in_bytes && !_message_cache.empty() )
+      {
+        erase_oldest();
+        ++_evictions;
+      }
     }
 
     void blockchain_tied_message_cache::cache_message( const message& message_to_cache,
@@ -195,22 +247,60 @@ namespace graphene { namespace net {
                                                      const message_propagation_data& propagation_data,
                                                      const fc::uint160_t& message_content_hash )
     {
-      _message_cache.insert( message_info(hash_of_message_to_cache,
-                                         message_to_cache,
-                                         block_clock,
-                                         propagation_data,
-                                         message_content_hash ) );
+      auto result = _message_cache.insert( message_info(hash_of_message_to_cache,
+                                                        std::make_shared<const message>( message_to_cache ),
+                                                        block_clock,
+                                                        propagation_data,
+                                                        message_content_hash ) );
+      if( !result.second )
+        return;
+      _size_in_bytes += result.first->size_in_bytes();
+
+      // never evict the message just cached, peers are about to be told we have it
+      while( _size_in_bytes > _max_size_in_bytes && _message_cache.size() > 1 )
+      {
+        erase_oldest();
+        ++_evictions;
+      }
+    }
+
+    std::shared_ptr<const message> blockchain_tied_message_cache::find_message( const message_hash_type& hash_of_message_to_lookup ) const
+    {
+      const auto& index = _message_cache.get<message_hash_index>();
+      auto iter = index.find( hash_of_message_to_lookup );
+      if( iter == index.end() )
+      {
+        ++_misses;
+        return std::shared_ptr<const message>();
+      }
+      ++_hits;
+      return iter->message_body;
     }
 
-    message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
+    message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup ) const
     {
-      message_cache_container::index<message_hash_index>::type::const_iterator iter =
-         _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup );
-      if( iter != _message_cache.get<message_hash_index>().end() )
-        return iter->message_body;
+      std::shared_ptr<const message> found = find_message( hash_of_message_to_lookup );
+      if( found )
+        return *found;
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
     }
 
+    bool blockchain_tied_message_cache::get_transaction( short_transaction_id_type short_id, signed_transaction& trx ) const
+    {
+      const auto& index = _message_cache.get<short_transaction_id_index>();
+      auto range = index.equal_range( short_id );
+      // Two transactions with the same short id, leave it to the peer to send the right one
+      if( range.first == range.second || std::next( range.first ) != range.second ||
+          range.first->message_body->msg_type != trx_message_type )
+      {
+        ++_misses;
+        return false;
+      }
+      ++_hits;
+      trx = range.first->message_body->as<trx_message>().trx;
+      return true;
+    }
+
     message_propagation_data blockchain_tied_message_cache::get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const
     {
       if( hash_of_message_contents_to_lookup != fc::uint160_t() )
@@ -223,6 +313,17 @@ namespace graphene { namespace net {
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
     }
 
+    fc::time_point blockchain_tied_message_cache::message_advertised( const message_hash_type& hash_of_message,
+                                                                      const fc::time_point& advertised_time )
+    {
+      auto& index = _message_cache.get<message_hash_index>();
+      auto iter = index.find( hash_of_message );
+      if( iter == index.end() || iter->propagation_data.advertised_time != fc::time_point() )
+        return fc::time_point();
+      index.modify( iter, [&]( message_info& info ) { info.propagation_data.advertised_time = advertised_time; } );
+      return iter->propagation_data.received_time;
+    }
+
     // when requesting items from peers, we want to prioritize any blocks before
     // transactions, but otherwise request items in the order we heard about them
     struct prioritized_item_id
@@ -272,7 +373,9 @@ namespace graphene { namespace net {
                                    (get_head_block_id) \
                                    (estimate_last_known_fork_from_git_revision_timestamp) \
                                    (error_encountered) \
-                                   (get_chain_id)
+                                   (get_chain_id) \
+                                   (get_block_log_segment) \
+                                   (handle_block_log_segment)
 
 
 #define DECLARE_ACCUMULATOR(r, data, method_name) \
@@ -372,6 +475,9 @@ namespace graphene { namespace net {
       item_hash_t get_head_block_id() const override;
       uint32_t estimate_last_known_fork_from_git_revision_timestamp(uint32_t unix_timestamp) const override;
       void error_encountered(const std::string& message, const fc::oexception& error) override;
+      uint32_t get_block_log_segment(uint32_t first_block_num, uint32_t max_bytes,
+                                     std::vector<char>& data, uint64_t& first_block_position) override;
+      uint32_t handle_block_log_segment(const graphene::net::block_log_segment_message& segment) override;
     };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -382,6 +488,9 @@ namespace graphene { namespace net {
 #ifdef P2P_IN_DEDICATED_THREAD
       std::shared_ptr<fc::thread> _thread;
 #endif // P2P_IN_DEDICATED_THREAD
+      /** threads that do the socket I/O, encryption and framing of peer connections, see get_io_thread() */
+      std::vector<std::shared_ptr<fc::thread>> _io_threads;
+      uint32_t _next_io_thread = 0;
       std::unique_ptr<statistics_gathering_node_delegate_wrapper> _delegate;
 
 #define NODE_CONFIGURATION_FILENAME      "node_config.json"
@@ -449,6 +558,8 @@ namespace graphene { namespace net {
       fc::promise<void>::ptr        _retrigger_advertise_inventory_loop_promise;
       fc::future<void>              _advertise_inventory_loop_done;
       std::unordered_set<item_id>   _new_inventory; /// list of items we have received but not yet advertised to our peers
+      bool                          _new_inventory_has_blocks = false; /// blocks are advertised at once, without waiting for a transaction batch
+      fc::time_point                _new_inventory_batch_start; /// when the oldest item of _new_inventory was added
       // @}
 
       fc::future<void>     _terminate_inactive_connections_loop_done;
@@ -491,6 +602,21 @@ namespace graphene { namespace net {
 
       blockchain_tied_message_cache _message_cache; /// cache message we have received and might be required to provide to other peers via inventory requests
 
+      uint64_t _compact_blocks_sent = 0;
+      uint64_t _compact_blocks_received = 0;
+      uint64_t _compact_block_transactions_fetched = 0; /// transactions of compact blocks we received that were not in the cache
+
+      /// used to bootstrap from the block log of node_configuration::block_log_bootstrap_peer before syncing
+      // @{
+      bool                _block_log_bootstrap_attempted = false;
+      bool                _block_log_bootstrap_pending = false; /// normal syncing waits while this is set
+      peer_connection_ptr _block_log_bootstrap_peer;
+      uint32_t            _block_log_bootstrap_next_block_num = 0; /// first block of the segment we are waiting for
+      fc::future<void>    _block_log_bootstrap_timeout_done; /// ends the bootstrap when the peer does not connect or answer
+      // @}
+
+      fc::time_point _next_slow_peer_rotation_time; /// rotate_out_slow_peer() does nothing before this time
+
       fc::rate_limiting_group _rate_limiter;
 
       uint32_t _last_reported_number_of_connections; // number of connections last reported to the client (to avoid sending duplicate messages)
@@ -549,6 +675,13 @@ namespace graphene { namespace net {
       bool have_already_received_sync_item( const item_hash_t& item_hash );
       void request_sync_item_from_peer( const peer_connection_ptr& peer, const item_hash_t& item_to_request );
       void request_sync_items_from_peer( const peer_connection_ptr& peer, const std::vector<item_hash_t>& items_to_request );
+      uint32_t get_sync_request_size( const peer_connection* peer ) const;
+      void record_sync_block_arrival( peer_connection* peer );
+      double get_peer_score( const peer_connection* peer ) const;
+      void record_item_arrival( peer_connection* peer, const fc::time_point& request_time );
+      void record_item_request_failed( peer_connection* peer );
+      void save_peer_score( const peer_connection* peer );
+      void rotate_out_slow_peer();
       void fetch_sync_items_loop();
       void trigger_fetch_sync_items_loop();
 
@@ -611,6 +744,31 @@ namespace graphene { namespace net {
       void on_item_not_available_message( peer_connection* originating_peer,
                                           const item_not_available_message& item_not_available_message_received );
 
+      void on_compact_block_message( peer_connection* originating_peer,
+                                     const compact_block_message& compact_block_message_received );
+
+      void on_fetch_block_transactions_message( peer_connection* originating_peer,
+                                                const fetch_block_transactions_message& fetch_block_transactions_message_received );
+
+      void on_block_transactions_message( peer_connection* originating_peer,
+                                          const block_transactions_message& block_transactions_message_received );
+
+      void on_fetch_block_log_segment_message( peer_connection* originating_peer,
+                                               const fetch_block_log_segment_message& fetch_block_log_segment_message_received );
+
+      void on_block_log_segment_message( peer_connection* originating_peer,
+                                         const block_log_segment_message& block_log_segment_message_received );
+
+      void start_block_log_bootstrap( const peer_connection_ptr& peer );
+      void request_block_log_segment( uint32_t first_block_num );
+      void schedule_block_log_segment_timeout();
+      void finish_block_log_bootstrap();
+
+      void request_compact_block_transactions( peer_connection* originating_peer, const item_hash_t& block_message_hash,
+                                               peer_connection::partial_compact_block& partial_block );
+      bool complete_compact_block( peer_connection* originating_peer, const item_hash_t& block_message_hash,
+                                   const signed_block& block );
+
       void on_item_ids_inventory_message( peer_connection* originating_peer,
                                           const item_ids_inventory_message& item_ids_inventory_message_received );
 
@@ -709,7 +867,8 @@ namespace graphene { namespace net {
       void                       clear_peer_database();
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
       fc::variant_object         get_call_statistics() const;
-      message                    get_message_for_item(const item_id& item) override;
+      std::shared_ptr<const message> get_message_for_item(const item_id& item) override;
+      std::shared_ptr<fc::thread> get_io_thread() override;
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
@@ -932,9 +1091,10 @@ namespace graphene { namespace net {
             bool initiated_connection_this_pass = false;
             _potential_peer_database_updated = false;
 
-            for (peer_database::iterator iter = _potential_peer_db.begin();
-                 iter != _potential_peer_db.end() && is_wanting_new_connections();
-                 ++iter)
+            // try the peers that served us best first, peers never measured rank as an average one
+            std::vector<std::pair<double, fc::ip::endpoint> > candidates;
+            std::vector<double> known_scores;
+            for (peer_database::iterator iter = _potential_peer_db.begin(); iter != _potential_peer_db.end(); ++iter)
             {
               fc::microseconds delay_until_retry = fc::seconds((iter->number_of_failed_connection_attempts + 1) * _node_configuration.peer_connection_retry_timeout);
 
@@ -944,10 +1104,32 @@ namespace graphene { namespace net {
                     iter->last_connection_disposition != last_connection_handshaking_failed) ||
                    (fc::time_point::now() - iter->last_connection_attempt_time) > delay_until_retry))
               {
-                connect_to_endpoint(iter->endpoint);
-                initiated_connection_this_pass = true;
+                double score = compute_peer_score(iter->item_latency_us, iter->number_of_items_received, iter->number_of_item_requests_failed);
+                candidates.emplace_back(score, iter->endpoint);
+                if (score > 0)
+                  known_scores.push_back(score);
               }
             }
+            if (!known_scores.empty())
+            {
+              std::nth_element(known_scores.begin(), known_scores.begin() + known_scores.size() / 2, known_scores.end());
+              double median_score = known_scores[known_scores.size() / 2];
+              for (auto& candidate : candidates)
+                if (candidate.first <= 0)
+                  candidate.first = median_score;
+              std::stable_sort(candidates.begin(), candidates.end(),
+                               [](const std::pair<double, fc::ip::endpoint>& lhs, const std::pair<double, fc::ip::endpoint>& rhs) {
+                                 return lhs.first < rhs.first;
+                               });
+            }
+
+            for (const auto& candidate : candidates)
+            {
+              if (!is_wanting_new_connections())
+                break;
+              connect_to_endpoint(candidate.second);
+              initiated_connection_this_pass = true;
+            }
 
             if (!initiated_connection_this_pass && !_potential_peer_database_updated)
               break;
@@ -1032,6 +1214,9 @@ namespace graphene { namespace net {
       VERIFY_CORRECT_THREAD();
       dlog( "requesting ${item_count} item(s) ${items_to_request} from peer ${endpoint}",
             ("item_count", items_to_request.size())("items_to_request", items_to_request)("endpoint", peer->get_remote_endpoint()) );
+      // the time until the first of these blocks arrives counts towards the peer's throughput
+      if (peer->sync_items_requested_from_peer.empty())
+        peer->last_sync_block_time = fc::time_point::now();
       for (const item_hash_t& item_to_request : items_to_request)
       {
         _active_sync_requests.insert( active_sync_requests_map::value_type(item_to_request, fc::time_point::now() ) );
@@ -1041,6 +1226,135 @@ namespace graphene { namespace net {
       peer->send_message(fetch_items_message(graphene::net::block_message_type, items_to_request));
     }
 
+    uint32_t node_impl::get_sync_request_size( const peer_connection* peer ) const
+    {
+      VERIFY_CORRECT_THREAD();
+      uint32_t max_size = std::max<uint32_t>(_node_configuration.maximum_blocks_per_peer_during_syncing, 1);
+      uint32_t min_size = std::min<uint32_t>(GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING, max_size);
+      if (peer->sync_block_interval_us <= 0)
+        return min_size;
+      double size = GRAPHENE_NET_SYNC_REQUEST_TARGET_MILLISECONDS * 1000.0 / peer->sync_block_interval_us;
+      return (uint32_t)std::max<double>(min_size, std::min<double>(max_size, size));
+    }
+
+    void node_impl::record_sync_block_arrival( peer_connection* peer )
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::time_point now = fc::time_point::now();
+      if (peer->last_sync_block_time != fc::time_point())
+      {
+        double interval_us = std::max<int64_t>((now - peer->last_sync_block_time).count(), 1);
+        peer->sync_block_interval_us = peer->sync_block_interval_us <= 0 ? interval_us
+                                                                          : (peer->sync_block_interval_us * 7 + interval_us) / 8;
+      }
+      peer->last_sync_block_time = now;
+    }
+
+    double node_impl::get_peer_score( const peer_connection* peer ) const
+    {
+      // until an item arrives, the round trip of the keepalive exchange is the best guess we have
+      double latency_us = peer->item_latency_us > 0 ? peer->item_latency_us : (double)peer->round_trip_delay.count();
+      return compute_peer_score(latency_us, peer->items_received, peer->item_requests_failed);
+    }
+
+    static void limit_peer_score_samples( peer_connection* peer )
+    {
+      while ((uint64_t)peer->items_received + peer->item_requests_failed > GRAPHENE_NET_PEER_SCORE_MAX_SAMPLES)
+      {
+        peer->items_received /= 2;
+        peer->item_requests_failed /= 2;
+      }
+    }
+
+    void node_impl::record_item_arrival( peer_connection* peer, const fc::time_point& request_time )
+    {
+      VERIFY_CORRECT_THREAD();
+      double latency_us = std::max<int64_t>((fc::time_point::now() - request_time).count(), 1);
+      peer->item_latency_us = peer->item_latency_us <= 0 ? latency_us
+                                                         : (peer->item_latency_us * 7 + latency_us) / 8;
+      ++peer->items_received;
+      limit_peer_score_samples(peer);
+    }
+
+    void node_impl::record_item_request_failed( peer_connection* peer )
+    {
+      VERIFY_CORRECT_THREAD();
+      ++peer->item_requests_failed;
+      limit_peer_score_samples(peer);
+    }
+
+    void node_impl::save_peer_score( const peer_connection* peer )
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::optional<fc::ip::endpoint> endpoint = peer->get_endpoint_for_connecting();
+      if (!endpoint || (peer->item_latency_us <= 0 && peer->sync_block_interval_us <= 0 && !peer->item_requests_failed))
+        return;
+      fc::optional<potential_peer_record> updated_peer_record = _potential_peer_db.lookup_entry_for_endpoint(*endpoint);
+      if (!updated_peer_record)
+        return;
+      // the connection started from the saved values (see move_peer_to_active_list()), so these replace them
+      const double max_us = std::numeric_limits<uint32_t>::max();
+      if (peer->item_latency_us > 0)
+        updated_peer_record->item_latency_us = (uint32_t)std::min(peer->item_latency_us, max_us);
+      if (peer->sync_block_interval_us > 0)
+        updated_peer_record->sync_block_interval_us = (uint32_t)std::min(peer->sync_block_interval_us, max_us);
+      updated_peer_record->number_of_items_received = peer->items_received;
+      updated_peer_record->number_of_item_requests_failed = peer->item_requests_failed;
+      _potential_peer_db.update_entry(*updated_peer_record);
+    }
+
+    /**
+     * Disconnects the worst scoring peer when it is much slower than the median, so that the connect
+     * loop replaces it.  Only peers with enough samples are compared, and nothing is done while we
+     * are short of connections or know of no other peer to try.
+     */
+    void node_impl::rotate_out_slow_peer()
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::time_point now = fc::time_point::now();
+      if (!_node_configuration.rotate_out_slow_peers ||
+          now < _next_slow_peer_rotation_time ||
+          _active_connections.size() < _node_configuration.desired_number_of_connections ||
+          _potential_peer_db.size() <= _active_connections.size())
+        return;
+      _next_slow_peer_rotation_time = now + fc::seconds(GRAPHENE_NET_SLOW_PEER_ROTATION_INTERVAL_SECONDS);
+
+      std::vector<peer_connection_ptr> scored_peers;
+      std::vector<double> scores;
+      for (const peer_connection_ptr& peer : _active_connections)
+        if (peer != _block_log_bootstrap_peer &&
+            (uint64_t)peer->items_received + peer->item_requests_failed >= GRAPHENE_NET_PEER_SCORE_MIN_SAMPLES)
+        {
+          double score = get_peer_score(peer.get());
+          if (score > 0)
+          {
+            scored_peers.push_back(peer);
+            scores.push_back(score);
+          }
+        }
+
+      double median_score = 0;
+      int slowest_index = find_slow_peer(scores, median_score);
+      if (slowest_index < 0)
+        return;
+      peer_connection_ptr slowest_peer = scored_peers[slowest_index];
+
+      wlog("Disconnecting slow peer ${peer}, its score is ${score} while the median is ${median}",
+           ("peer", slowest_peer->get_remote_endpoint())("score", scores[slowest_index])("median", median_score));
+      fc::exception detailed_error(FC_LOG_MESSAGE(warn, "Disconnecting a slow peer",
+                                                  ("score", scores[slowest_index])("median_score", median_score)));
+      disconnect_from_peer(slowest_peer.get(), "Disconnecting a slow peer to try another one", false, detailed_error);
+    }
+
+    /**
+     * Requests sync blocks in chain order, each peer gets the next blocks nobody has been asked
+     * for yet, the fastest peers first.  Peers aren't left idle between requests, a peer's
+     * request is topped up once half of it has arrived, and the number of blocks kept requested
+     * from it follows its measured throughput (see get_sync_request_size()).  Blocks requested
+     * or received but not yet handed to the client are bounded by
+     * maximum_number_of_sync_blocks_to_prefetch, which bounds how far ahead of the chain we fetch
+     * and how many blocks wait to be put back in order.
+     */
     void node_impl::fetch_sync_items_loop()
     {
       while( !_fetch_sync_items_loop_done.canceled() )
@@ -1056,33 +1370,56 @@ namespace graphene { namespace net {
             ASSERT_TASK_NOT_PREEMPTED();
             std::set<item_hash_t> sync_items_to_request;
 
-            // for each idle peer that we're syncing with
+            size_t blocks_in_window = _received_sync_items.size() + _new_received_sync_items.size() + _active_sync_requests.size();
+            size_t window_available = blocks_in_window < _node_configuration.maximum_number_of_sync_blocks_to_prefetch ?
+                                      _node_configuration.maximum_number_of_sync_blocks_to_prefetch - blocks_in_window : 0;
+
+            // the peers we're syncing with that aren't busy with anything but sync blocks
+            std::vector<peer_connection_ptr> sync_peers;
             for( const peer_connection_ptr& peer : _active_connections )
-            {
               if( peer->we_need_sync_items_from_peer &&
-                  sync_item_requests_to_send.find(peer) == sync_item_requests_to_send.end() && // if we've already scheduled a request for this peer, don't consider scheduling another
-                  peer->idle() )
+                  !peer->inhibit_fetching_sync_blocks &&
+                  peer->items_requested_from_peer.empty() &&
+                  !peer->item_ids_requested_from_peer )
+                sync_peers.push_back(peer);
+
+            // fastest first, so the blocks the chain needs next come from the peers that deliver them soonest
+            std::stable_sort(sync_peers.begin(), sync_peers.end(),
+                             [](const peer_connection_ptr& lhs, const peer_connection_ptr& rhs) {
+              if (lhs->sync_block_interval_us <= 0 || rhs->sync_block_interval_us <= 0)
+                return lhs->sync_block_interval_us > 0 && rhs->sync_block_interval_us <= 0;
+              return lhs->sync_block_interval_us < rhs->sync_block_interval_us;
+            });
+
+            for( const peer_connection_ptr& peer : sync_peers )
+            {
+              if (!window_available)
+                break;
+
+              uint32_t request_size = get_sync_request_size(peer.get());
+              size_t outstanding = peer->sync_items_requested_from_peer.size();
+              if (outstanding > request_size / 2)
+                continue;
+              size_t items_to_request = std::min<size_t>(request_size - outstanding, window_available);
+
+              std::vector<item_hash_t>& peer_requests = sync_item_requests_to_send[peer];
+              // loop through the items it has that we don't yet have on our blockchain
+              for( unsigned i = 0; i < peer->ids_of_items_to_get.size() && peer_requests.size() < items_to_request; ++i )
               {
-                if (!peer->inhibit_fetching_sync_blocks)
+                item_hash_t item_to_potentially_request = peer->ids_of_items_to_get[i];
+                // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
+                if( !have_already_received_sync_item(item_to_potentially_request) && // already got it, but for some reson it's still in our list of items to fetch
+                    sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&  // we have already decided to request it from another peer during this iteration
+                    _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end() ) // we've requested it in a previous iteration and we're still waiting for it to arrive
                 {
-                  // loop through the items it has that we don't yet have on our blockchain
-                  for( unsigned i = 0; i < peer->ids_of_items_to_get.size(); ++i )
-                  {
-                    item_hash_t item_to_potentially_request = peer->ids_of_items_to_get[i];
-                    // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
-                    if( !have_already_received_sync_item(item_to_potentially_request) && // already got it, but for some reson it's still in our list of items to fetch
-                        sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&  // we have already decided to request it from another peer during this iteration
-                        _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end() ) // we've requested it in a previous iteration and we're still waiting for it to arrive
-                    {
-                      // then schedule a request from this peer
-                      sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
-                      sync_items_to_request.insert( item_to_potentially_request );
-                      if (sync_item_requests_to_send[peer].size() >= _node_configuration.maximum_blocks_per_peer_during_syncing)
-                        break;
-                    }
-                  }
+                  // then schedule a request from this peer
+                  peer_requests.push_back(item_to_potentially_request);
+                  sync_items_to_request.insert( item_to_potentially_request );
                 }
               }
+              window_available -= peer_requests.size();
+              if (peer_requests.empty())
+                sync_item_requests_to_send.erase(peer);
             }
           } // end non-preemptable section
 
@@ -1141,10 +1478,11 @@ namespace graphene { namespace net {
         struct peer_and_items_to_fetch
         {
           peer_connection_ptr peer;
+          size_t outstanding_items; // items requested in earlier iterations that have not arrived yet
           std::vector<item_id> item_ids;
-          peer_and_items_to_fetch(const peer_connection_ptr& peer) : peer(peer) {}
+          peer_and_items_to_fetch(const peer_connection_ptr& peer) : peer(peer), outstanding_items(peer->items_requested_from_peer.size()) {}
           bool operator<(const peer_and_items_to_fetch& rhs) const { return peer < rhs.peer; }
-          size_t number_of_items() const { return item_ids.size(); }
+          size_t number_of_items() const { return outstanding_items + item_ids.size(); }
         };
         typedef boost::multi_index_container<peer_and_items_to_fetch,
                                              boost::multi_index::indexed_by<boost::multi_index::ordered_unique<boost::multi_index::member<peer_and_items_to_fetch, peer_connection_ptr, &peer_and_items_to_fetch::peer> >,
@@ -1152,9 +1490,13 @@ namespace graphene { namespace net {
                                                                                                                    boost::multi_index::const_mem_fun<peer_and_items_to_fetch, size_t, &peer_and_items_to_fetch::number_of_items> > > > fetch_messages_to_send_set;
         fetch_messages_to_send_set items_by_peer;
 
-        // initialize the fetch_messages_to_send with an empty set of items for all idle peers
+        // initialize the fetch_messages_to_send with an empty set of items for all peers that are not
+        // syncing with us and have room for more requests, requests are pipelined so a peer does not
+        // need to deliver everything we asked it for before we ask for more
+        const size_t max_items_per_peer = std::max<uint32_t>(_node_configuration.maximum_items_per_peer_during_normal_operation, 1);
         for (const peer_connection_ptr& peer : _active_connections)
-          if (peer->idle())
+          if (peer->sync_items_requested_from_peer.empty() && !peer->item_ids_requested_from_peer &&
+              peer->items_requested_from_peer.size() < max_items_per_peer)
             items_by_peer.insert(peer_and_items_to_fetch(peer));
 
         // now loop over all items we want to fetch
@@ -1170,33 +1512,49 @@ namespace graphene { namespace net {
           }
           else
           {
-            // find a peer that has it, we'll use the one who has the least requests going to it to load balance
-            bool item_fetched = false;
-            for (auto peer_iter = items_by_peer.get<requested_item_count_index>().begin(); peer_iter != items_by_peer.get<requested_item_count_index>().end(); ++peer_iter)
+            // find a peer that has it.  Transactions go to the one who has the least requests going to it
+            // to load balance, blocks to the one with the best score, unmeasured peers last
+            auto& peers_by_request_count = items_by_peer.get<requested_item_count_index>();
+            auto chosen_peer_iter = peers_by_request_count.end();
+            double chosen_peer_score = 0;
+            for (auto peer_iter = peers_by_request_count.begin(); peer_iter != peers_by_request_count.end(); ++peer_iter)
             {
               const peer_connection_ptr& peer = peer_iter->peer;
               // if they have the item and we haven't already decided to ask them for too many other items
-              if (peer_iter->item_ids.size() < GRAPHENE_NET_MAX_ITEMS_PER_PEER_DURING_NORMAL_OPERATION &&
+              if (peer_iter->number_of_items() < max_items_per_peer &&
                   peer->inventory_peer_advertised_to_us.find(item_iter->item) != peer->inventory_peer_advertised_to_us.end())
               {
                 if (item_iter->item.item_type == graphene::net::trx_message_type && peer->is_transaction_fetching_inhibited())
                   next_peer_unblocked_time = std::min(peer->transaction_fetching_inhibited_until, next_peer_unblocked_time);
-                else
+                else if (item_iter->item.item_type != graphene::net::block_message_type)
                 {
-                  //dlog("requesting item ${hash} from peer ${endpoint}",
-                  //     ("hash", iter->item.item_hash)("endpoint", peer->get_remote_endpoint()));
-                  item_id item_id_to_fetch = item_iter->item;
-                  peer->items_requested_from_peer.insert(peer_connection::item_to_time_map_type::value_type(item_id_to_fetch, fc::time_point::now()));
-                  item_iter = _items_to_fetch.erase(item_iter);
-                  item_fetched = true;
-                  items_by_peer.get<requested_item_count_index>().modify(peer_iter, [&item_id_to_fetch](peer_and_items_to_fetch& peer_and_items) {
-                    peer_and_items.item_ids.push_back(item_id_to_fetch);
-                  });
+                  chosen_peer_iter = peer_iter;
                   break;
                 }
+                else
+                {
+                  double score = get_peer_score(peer.get());
+                  if (chosen_peer_iter == peers_by_request_count.end() ||
+                      (score > 0 && (chosen_peer_score <= 0 || score < chosen_peer_score)))
+                  {
+                    chosen_peer_iter = peer_iter;
+                    chosen_peer_score = score;
+                  }
+                }
               }
             }
-            if (!item_fetched)
+            if (chosen_peer_iter != peers_by_request_count.end())
+            {
+              //dlog("requesting item ${hash} from peer ${endpoint}",
+              //     ("hash", iter->item.item_hash)("endpoint", peer->get_remote_endpoint()));
+              item_id item_id_to_fetch = item_iter->item;
+              chosen_peer_iter->peer->items_requested_from_peer.insert(peer_connection::item_to_time_map_type::value_type(item_id_to_fetch, fc::time_point::now()));
+              item_iter = _items_to_fetch.erase(item_iter);
+              peers_by_request_count.modify(chosen_peer_iter, [&item_id_to_fetch](peer_and_items_to_fetch& peer_and_items) {
+                peer_and_items.item_ids.push_back(item_id_to_fetch);
+              });
+            }
+            else
               ++item_iter;
           }
         }
@@ -1261,15 +1619,48 @@ namespace graphene { namespace net {
     {
       while (!_advertise_inventory_loop_done.canceled())
       {
+        // hold new transactions for the batch window so they go out in fewer inventory messages,
+        // a new block ends the wait right away
+        fc::time_point batch_end = _new_inventory_batch_start + fc::milliseconds(_node_configuration.transaction_advertise_batch_milliseconds);
+        while (!_new_inventory_has_blocks && fc::time_point::now() < batch_end && !_advertise_inventory_loop_done.canceled())
+        {
+          _retrigger_advertise_inventory_loop_promise = fc::promise<void>::ptr(new fc::promise<void>("graphene::net::retrigger_advertise_inventory_loop"));
+          try
+          {
+            _retrigger_advertise_inventory_loop_promise->wait(batch_end - fc::time_point::now());
+          }
+          catch (const fc::timeout_exception&)
+          {
+          }
+          _retrigger_advertise_inventory_loop_promise.reset();
+        }
+
         dlog("beginning an iteration of advertise inventory");
         // swap inventory into local variable, clearing the node's copy
         std::unordered_set<item_id> inventory_to_advertise;
         inventory_to_advertise.swap(_new_inventory);
+        _new_inventory_has_blocks = false;
+
+        fc::time_point advertised_time = fc::time_point::now();
+        for (const item_id& item_to_advertise : inventory_to_advertise)
+        {
+          fc::time_point received_time = _message_cache.message_advertised(item_to_advertise.item_hash, advertised_time);
+          if (received_time != fc::time_point() && bears::plugins::statsd::util::statsd_enabled())
+            bears::plugins::statsd::util::get_statsd().timing(
+              "p2p",
+              "relay_latency",
+              fc::variant( core_message_type_enum( item_to_advertise.item_type ) ).as_string(),
+              bears::plugins::statsd::util::timing_helper( advertised_time - received_time ),
+              0.1f
+            );
+        }
 
         // process all inventory to advertise and construct the inventory messages we'll send
         // first, then send them all in a batch (to avoid any fiber interruption points while
-        // we're computing the messages)
+        // we're computing the messages).  Block inventory goes to every peer before any
+        // transaction inventory
         std::list<std::pair<peer_connection_ptr, item_ids_inventory_message> > inventory_messages_to_send;
+        std::list<std::pair<peer_connection_ptr, item_ids_inventory_message> > block_inventory_messages_to_send;
 
         for (const peer_connection_ptr& peer : _active_connections)
         {
@@ -1277,7 +1668,7 @@ namespace graphene { namespace net {
           //wdump((peer->peer_needs_sync_items_from_us));
           if( !peer->peer_needs_sync_items_from_us )
           {
-            std::map<uint32_t, std::vector<item_hash_t> > items_to_advertise_by_type;
+            std::map<uint32_t, std::vector<item_hash_t>, std::greater<uint32_t> > items_to_advertise_by_type;
             // don't send the peer anything we've already advertised to it
             // or anything it has advertised to us
             // group the items we need to send by type, because we'll need to send one inventory message per type
@@ -1306,11 +1697,13 @@ namespace graphene { namespace net {
                    ("types", items_to_advertise_by_type.size())
                    ("endpoint", peer->get_remote_endpoint()));
             for (const auto& items_group : items_to_advertise_by_type)
-              inventory_messages_to_send.push_back(std::make_pair(peer, item_ids_inventory_message(items_group.first, items_group.second)));
+              (items_group.first == block_message_type ? block_inventory_messages_to_send : inventory_messages_to_send)
+                .push_back(std::make_pair(peer, item_ids_inventory_message(items_group.first, items_group.second)));
           }
           peer->clear_old_inventory();
         }
 
+        inventory_messages_to_send.splice(inventory_messages_to_send.begin(), block_inventory_messages_to_send);
         for (auto iter = inventory_messages_to_send.begin(); iter != inventory_messages_to_send.end(); ++iter)
           iter->first->send_message(iter->second);
         inventory_messages_to_send.clear();
@@ -1439,6 +1832,7 @@ namespace graphene { namespace net {
                 }
             if (disconnect_due_to_request_timeout)
             {
+              record_item_request_failed(active_peer.get());
               // we should probably disconnect nicely and give them a reason, but right now the logic
               // for rescheduling the requests only executes when the connection is fully closed,
               // and we want to get those requests rescheduled as soon as possible
@@ -1529,6 +1923,8 @@ namespace graphene { namespace net {
                            offsetof(current_time_request_message, request_sent_time));
       peers_to_send_keep_alive.clear();
 
+      rotate_out_slow_peer();
+
       if (!_node_is_shutting_down && !_terminate_inactive_connections_loop_done.canceled())
          _terminate_inactive_connections_loop_done = schedule_task( [this](){ terminate_inactive_connections_loop(); },
                                                                    fc::time_point::now() + fc::seconds(1),
@@ -1849,6 +2245,21 @@ namespace graphene { namespace net {
       case core_message_type_enum::get_current_connections_reply_message_type:
         on_get_current_connections_reply_message(originating_peer, received_message.as<get_current_connections_reply_message>());
         break;
+      case core_message_type_enum::compact_block_message_type:
+        on_compact_block_message(originating_peer, received_message.as<compact_block_message>());
+        break;
+      case core_message_type_enum::fetch_block_transactions_message_type:
+        on_fetch_block_transactions_message(originating_peer, received_message.as<fetch_block_transactions_message>());
+        break;
+      case core_message_type_enum::block_transactions_message_type:
+        on_block_transactions_message(originating_peer, received_message.as<block_transactions_message>());
+        break;
+      case core_message_type_enum::fetch_block_log_segment_message_type:
+        on_fetch_block_log_segment_message(originating_peer, received_message.as<fetch_block_log_segment_message>());
+        break;
+      case core_message_type_enum::block_log_segment_message_type:
+        on_block_log_segment_message(originating_peer, received_message.as<block_log_segment_message>());
+        break;
 
       default:
         // ignore any message in between core_message_type_first and _last that we don't handle above
@@ -1893,6 +2304,8 @@ namespace graphene { namespace net {
         user_data["last_known_fork_block_number"] = _hard_fork_block_numbers.back();
 
       user_data["chain_id"] = _delegate->get_chain_id();
+      if (_node_configuration.compact_blocks_enabled)
+        user_data["compact_blocks"] = true;
 
       return user_data;
     }
@@ -1918,6 +2331,8 @@ namespace graphene { namespace net {
         originating_peer->last_known_fork_block_number = user_data["last_known_fork_block_number"].as<uint32_t>();
       if (user_data.contains("chain_id"))
         originating_peer->chain_id = user_data["chain_id"].as<bears::protocol::chain_id_type>();
+      if (user_data.contains("compact_blocks"))
+        originating_peer->supports_compact_blocks = user_data["compact_blocks"].as_bool();
     }
 
     void node_impl::on_hello_message( peer_connection* originating_peer, const hello_message& hello_message_received )
@@ -2772,23 +3187,34 @@ namespace graphene { namespace net {
       }
     }
 
-    message node_impl::get_message_for_item(const item_id& item)
+    std::shared_ptr<fc::thread> node_impl::get_io_thread()
     {
-      activity_tracer aTracer(__FUNCTION__, *this);
-
-      try
+      VERIFY_CORRECT_THREAD();
+      if (_io_threads.size() != _node_configuration.io_threads)
       {
-        return _message_cache.get_message(item.item_hash);
+        // connections keep the thread they were given, replacing the pool only affects new connections
+        _io_threads.clear();
+        for (uint32_t i = 0; i < _node_configuration.io_threads; ++i)
+          _io_threads.push_back(std::make_shared<fc::thread>("p2p io " + std::to_string(i)));
       }
-      catch (fc::key_not_found_exception&)
-      {}
+      if (_io_threads.empty())
+        return std::shared_ptr<fc::thread>();
+      return _io_threads[_next_io_thread++ % _io_threads.size()];
+    }
+
+    std::shared_ptr<const message> node_impl::get_message_for_item(const item_id& item)
+    {
+      activity_tracer aTracer(__FUNCTION__, *this);
+
+      if (std::shared_ptr<const message> cached_message = _message_cache.find_message(item.item_hash))
+        return cached_message;
       try
       {
-        return _delegate->get_item(item);
+        return std::make_shared<const message>(_delegate->get_item(item));
       }
       catch (fc::key_not_found_exception&)
       {}
-      return item_not_available_message(item);
+      return std::make_shared<const message>(item_not_available_message(item));
     }
 
     void node_impl::on_fetch_items_message(peer_connection* originating_peer, const fetch_items_message& fetch_items_message_received)
@@ -2801,24 +3227,32 @@ namespace graphene { namespace net {
 
       fc::optional<message> last_block_message_sent;
 
-      std::list<message> reply_messages;
+      std::list<std::shared_ptr<const message>> reply_messages;
       for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
       {
-        try
+        if (std::shared_ptr<const message> cached_message = _message_cache.find_message(item_hash))
         {
-          message requested_message = _message_cache.get_message(item_hash);
+          const message& requested_message = *cached_message;
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
                ("id", requested_message.id()));
-          reply_messages.push_back(requested_message);
           if (fetch_items_message_received.item_type == block_message_type)
+          {
             last_block_message_sent = requested_message;
+            // blocks still in the cache are new, the peer has most likely seen their transactions
+            if (_node_configuration.compact_blocks_enabled && originating_peer->supports_compact_blocks &&
+                requested_message.msg_type == block_message_type)
+            {
+              reply_messages.push_back(std::make_shared<const message>(compact_block_message(item_hash, requested_message.as<graphene::net::block_message>().block)));
+              ++_compact_blocks_sent;
+              continue;
+            }
+          }
+          // the reply shares the cached copy of the message
+          reply_messages.push_back(std::move(cached_message));
           continue;
         }
-        catch (fc::key_not_found_exception&)
-        {
-           // it wasn't in our local cache, that's ok ask the client
-        }
+        // it wasn't in our local cache, that's ok ask the client
 
         item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
         try
@@ -2828,14 +3262,14 @@ namespace graphene { namespace net {
                ("id", requested_message.id())
                ("size", requested_message.size)
                ("endpoint", originating_peer->get_remote_endpoint()));
-          reply_messages.push_back(requested_message);
+          reply_messages.push_back(std::make_shared<const message>(requested_message));
           if (fetch_items_message_received.item_type == block_message_type)
             last_block_message_sent = requested_message;
           continue;
         }
         catch (fc::key_not_found_exception&)
         {
-          reply_messages.push_back(item_not_available_message(item_to_fetch));
+          reply_messages.push_back(std::make_shared<const message>(item_not_available_message(item_to_fetch)));
           dlog("received item request from peer ${endpoint} but we don't have it",
                ("endpoint", originating_peer->get_remote_endpoint()));
         }
@@ -2849,12 +3283,12 @@ namespace graphene { namespace net {
         originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
       }
 
-      for (const message& reply : reply_messages)
+      for (std::shared_ptr<const message>& reply : reply_messages)
       {
-        if (reply.msg_type == block_message_type)
-          originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+        if (reply->msg_type == block_message_type)
+          originating_peer->send_item(item_id(block_message_type, reply->as<graphene::net::block_message>().block_id));
         else
-          originating_peer->send_message(reply);
+          originating_peer->send_message(std::move(reply));
       }
     }
 
@@ -2866,6 +3300,8 @@ namespace graphene { namespace net {
       if (regular_item_iter != originating_peer->items_requested_from_peer.end())
       {
         originating_peer->items_requested_from_peer.erase( regular_item_iter );
+        record_item_request_failed(originating_peer);
+        originating_peer->partial_compact_blocks.erase( requested_item.item_hash );
         originating_peer->inventory_peer_advertised_to_us.erase( requested_item );
         if (is_item_in_any_peers_inventory(requested_item))
           _items_to_fetch.insert(prioritized_item_id(requested_item, _items_to_fetch_sequence_counter++));
@@ -2893,6 +3329,258 @@ namespace graphene { namespace net {
       dlog("Peer doesn't have an item we're looking for, which is fine because we weren't looking for it");
     }
 
+    void node_impl::on_compact_block_message(peer_connection* originating_peer, const compact_block_message& compact_block_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_hash_t& block_message_hash = compact_block_message_received.block_message_hash;
+      if (originating_peer->items_requested_from_peer.find(item_id(block_message_type, block_message_hash)) ==
+          originating_peer->items_requested_from_peer.end())
+      {
+        wlog("received a compact block ${hash} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+             ("hash", block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+        disconnect_from_peer(originating_peer, "You sent me a block that I didn't ask for", true,
+                             fc::exception(FC_LOG_MESSAGE(error, "You sent me a compact block that I didn't ask for, block message hash: ${hash}",
+                                                          ("hash", block_message_hash))));
+        return;
+      }
+      ++_compact_blocks_received;
+
+      peer_connection::partial_compact_block partial_block;
+      static_cast<signed_block_header&>(partial_block.block) = compact_block_message_received.header;
+      partial_block.block.transactions.resize(compact_block_message_received.short_transaction_ids.size());
+      for (uint32_t i = 0; i < compact_block_message_received.short_transaction_ids.size(); ++i)
+        if (!_message_cache.get_transaction(compact_block_message_received.short_transaction_ids[i], partial_block.block.transactions[i]))
+          partial_block.requested_indexes.push_back(i);
+
+      if (partial_block.requested_indexes.empty())
+      {
+        if (complete_compact_block(originating_peer, block_message_hash, partial_block.block))
+          return;
+        // a transaction we have shares its short id with one of the block, fetch them all
+        dlog("compact block ${hash} from peer ${endpoint} did not match the cached transactions",
+             ("hash", block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+      }
+      request_compact_block_transactions(originating_peer, block_message_hash, partial_block);
+    }
+
+    void node_impl::request_compact_block_transactions(peer_connection* originating_peer, const item_hash_t& block_message_hash,
+                                                       peer_connection::partial_compact_block& partial_block)
+    {
+      VERIFY_CORRECT_THREAD();
+      if (partial_block.requested_indexes.empty())
+      {
+        partial_block.requested_all_transactions = true;
+        for (uint32_t i = 0; i < partial_block.block.transactions.size(); ++i)
+          partial_block.requested_indexes.push_back(i);
+      }
+      _compact_block_transactions_fetched += partial_block.requested_indexes.size();
+
+      originating_peer->send_message(fetch_block_transactions_message(block_message_hash, partial_block.requested_indexes));
+      originating_peer->partial_compact_blocks[block_message_hash] = std::move(partial_block);
+    }
+
+    bool node_impl::complete_compact_block(peer_connection* originating_peer, const item_hash_t& block_message_hash,
+                                           const signed_block& block)
+    {
+      VERIFY_CORRECT_THREAD();
+      // the rebuilt block is only accepted when it packs to the exact block message that was requested
+      message rebuilt_message = graphene::net::block_message(block);
+      message_hash_type rebuilt_message_hash = rebuilt_message.id();
+      if (rebuilt_message_hash != block_message_hash)
+        return false;
+
+      process_block_message(originating_peer, rebuilt_message, rebuilt_message_hash);
+      return true;
+    }
+
+    void node_impl::on_fetch_block_transactions_message(peer_connection* originating_peer,
+                                                        const fetch_block_transactions_message& fetch_block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_hash_t& block_message_hash = fetch_block_transactions_message_received.block_message_hash;
+      item_id block_item(block_message_type, block_message_hash);
+
+      fc::optional<graphene::net::block_message> block;
+      if (std::shared_ptr<const message> cached_block = _message_cache.find_message(block_message_hash))
+        block = cached_block->as<graphene::net::block_message>();
+
+      block_transactions_message reply(block_message_hash);
+      if (block)
+      {
+        reply.transactions.reserve(fetch_block_transactions_message_received.transaction_indexes.size());
+        for (uint32_t index : fetch_block_transactions_message_received.transaction_indexes)
+        {
+          if (index >= block->block.transactions.size())
+          {
+            block.reset();
+            break;
+          }
+          reply.transactions.push_back(block->block.transactions[index]);
+        }
+      }
+
+      if (block)
+        originating_peer->send_message(reply);
+      else
+        originating_peer->send_message(item_not_available_message(block_item));
+    }
+
+    void node_impl::on_block_transactions_message(peer_connection* originating_peer, const block_transactions_message& block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_hash_t& block_message_hash = block_transactions_message_received.block_message_hash;
+      auto partial_iter = originating_peer->partial_compact_blocks.find(block_message_hash);
+      if (partial_iter == originating_peer->partial_compact_blocks.end())
+      {
+        dlog("received transactions of a compact block ${hash} we are not rebuilding from peer ${endpoint}",
+             ("hash", block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+        return;
+      }
+
+      peer_connection::partial_compact_block partial_block = std::move(partial_iter->second);
+      originating_peer->partial_compact_blocks.erase(partial_iter);
+
+      const std::vector<signed_transaction>& transactions = block_transactions_message_received.transactions;
+      if (transactions.size() == partial_block.requested_indexes.size())
+      {
+        for (uint32_t i = 0; i < transactions.size(); ++i)
+          partial_block.block.transactions[partial_block.requested_indexes[i]] = transactions[i];
+
+        if (complete_compact_block(originating_peer, block_message_hash, partial_block.block))
+          return;
+
+        if (!partial_block.requested_all_transactions)
+        {
+          partial_block.requested_indexes.clear();
+          request_compact_block_transactions(originating_peer, block_message_hash, partial_block);
+          return;
+        }
+      }
+
+      wlog("peer ${endpoint} sent transactions that do not rebuild the block ${hash} it offered, disconnecting from peer",
+           ("hash", block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+      disconnect_from_peer(originating_peer, "You sent me transactions that do not match the block you offered", true,
+                           fc::exception(FC_LOG_MESSAGE(error, "Transactions do not rebuild the block message ${hash}",
+                                                        ("hash", block_message_hash))));
+    }
+
+    void node_impl::on_fetch_block_log_segment_message(peer_connection* originating_peer, const fetch_block_log_segment_message& fetch_block_log_segment_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const uint32_t first_block_num = fetch_block_log_segment_message_received.first_block_num;
+      block_log_segment_message reply(first_block_num);
+      if (_node_configuration.serve_block_log)
+      {
+        try
+        {
+          uint32_t max_bytes = std::min<uint32_t>(fetch_block_log_segment_message_received.max_bytes, GRAPHENE_NET_BLOCK_LOG_SEGMENT_BYTES);
+          reply.block_count = _delegate->get_block_log_segment(first_block_num, max_bytes, reply.data, reply.first_block_position);
+        }
+        catch (const fc::exception& e)
+        {
+          wlog("unable to read the block log segment starting at block ${num} for peer ${endpoint}: ${e}",
+               ("num", first_block_num)("endpoint", originating_peer->get_remote_endpoint())("e", e));
+          reply = block_log_segment_message(first_block_num);
+        }
+      }
+
+      dlog("sending ${count} blocks of our block log starting at block ${num} to peer ${endpoint}",
+           ("count", reply.block_count)("num", first_block_num)("endpoint", originating_peer->get_remote_endpoint()));
+      originating_peer->send_message(reply);
+    }
+
+    void node_impl::on_block_log_segment_message(peer_connection* originating_peer, const block_log_segment_message& block_log_segment_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const uint32_t first_block_num = block_log_segment_message_received.first_block_num;
+      const uint32_t block_count = block_log_segment_message_received.block_count;
+      if (!_block_log_bootstrap_pending || originating_peer != _block_log_bootstrap_peer.get() ||
+          first_block_num != _block_log_bootstrap_next_block_num)
+      {
+        dlog("ignoring block log segment starting at block ${num} we did not ask peer ${endpoint} for",
+             ("num", first_block_num)("endpoint", originating_peer->get_remote_endpoint()));
+        return;
+      }
+
+      if (_block_log_bootstrap_timeout_done.valid() && !_block_log_bootstrap_timeout_done.ready())
+        _block_log_bootstrap_timeout_done.cancel("block log segment received");
+
+      if (block_count == 0)
+      {
+        ilog("Imported the block log of peer ${endpoint} up to block ${num}",
+             ("endpoint", originating_peer->get_remote_endpoint())("num", first_block_num - 1));
+        finish_block_log_bootstrap();
+        return;
+      }
+
+      // ask for the next segment before importing this one, so it is transferred while we apply the blocks
+      request_block_log_segment(first_block_num + block_count);
+
+      try
+      {
+        uint32_t head_block_num = _delegate->handle_block_log_segment(block_log_segment_message_received);
+        dlog("imported blocks ${first} to ${last} from the block log of peer ${endpoint}",
+             ("first", first_block_num)("last", head_block_num)("endpoint", originating_peer->get_remote_endpoint()));
+
+        // the import can take longer than the timeout, only start waiting for the next segment now
+        if (_block_log_bootstrap_pending && _block_log_bootstrap_next_block_num == first_block_num + block_count)
+          schedule_block_log_segment_timeout();
+      }
+      catch (const fc::exception& e)
+      {
+        wlog("unable to import the block log segment starting at block ${num} from peer ${endpoint}, syncing normally: ${e}",
+             ("num", first_block_num)("endpoint", originating_peer->get_remote_endpoint())("e", e));
+        finish_block_log_bootstrap();
+      }
+    }
+
+    void node_impl::start_block_log_bootstrap(const peer_connection_ptr& peer)
+    {
+      VERIFY_CORRECT_THREAD();
+      _block_log_bootstrap_peer = peer;
+      uint32_t head_block_num = _delegate->get_block_number(_delegate->get_head_block_id());
+      ilog("Bootstrapping from the block log of peer ${endpoint} after block ${num}",
+           ("endpoint", peer->get_remote_endpoint())("num", head_block_num));
+      request_block_log_segment(head_block_num + 1);
+      schedule_block_log_segment_timeout();
+    }
+
+    void node_impl::request_block_log_segment(uint32_t first_block_num)
+    {
+      VERIFY_CORRECT_THREAD();
+      _block_log_bootstrap_next_block_num = first_block_num;
+      _block_log_bootstrap_peer->send_message(fetch_block_log_segment_message(first_block_num, GRAPHENE_NET_BLOCK_LOG_SEGMENT_BYTES));
+    }
+
+    void node_impl::schedule_block_log_segment_timeout()
+    {
+      VERIFY_CORRECT_THREAD();
+      // a peer that does not know fetch_block_log_segment_message ignores it, don't wait for it forever
+      if (_block_log_bootstrap_timeout_done.valid() && !_block_log_bootstrap_timeout_done.ready())
+        _block_log_bootstrap_timeout_done.cancel("block log segment timeout rescheduled");
+
+      const uint32_t first_block_num = _block_log_bootstrap_next_block_num;
+      _block_log_bootstrap_timeout_done = fc::schedule([this, first_block_num]()
+      {
+        if (_block_log_bootstrap_pending && _block_log_bootstrap_next_block_num == first_block_num)
+        {
+          wlog("Block log bootstrap peer ${endpoint} did not send the segment starting at block ${num}, syncing normally",
+               ("endpoint", _node_configuration.block_log_bootstrap_peer)("num", first_block_num));
+          finish_block_log_bootstrap();
+        }
+      }, fc::time_point::now() + fc::seconds(GRAPHENE_NET_BLOCK_LOG_BOOTSTRAP_TIMEOUT_SECONDS), "block_log_segment_timeout");
+    }
+
+    void node_impl::finish_block_log_bootstrap()
+    {
+      VERIFY_CORRECT_THREAD();
+      if (!_block_log_bootstrap_pending)
+        return;
+      _block_log_bootstrap_pending = false;
+      _block_log_bootstrap_peer.reset();
+      start_synchronizing();
+    }
+
     void node_impl::on_item_ids_inventory_message(peer_connection* originating_peer, const item_ids_inventory_message& item_ids_inventory_message_received)
     {
       VERIFY_CORRECT_THREAD();
@@ -3022,9 +3710,18 @@ namespace graphene { namespace net {
         }
       }
 
+      save_peer_score(originating_peer);
+
       _closing_connections.erase(originating_peer_ptr);
       _handshaking_connections.erase(originating_peer_ptr);
       _terminating_connections.erase(originating_peer_ptr);
+
+      if (_block_log_bootstrap_peer == originating_peer_ptr)
+      {
+        wlog("Lost the connection to block log bootstrap peer ${endpoint}, syncing normally",
+             ("endpoint", originating_peer->get_remote_endpoint()));
+        finish_block_log_bootstrap();
+      }
       if (_active_connections.find(originating_peer_ptr) != _active_connections.end())
       {
         _active_connections.erase(originating_peer_ptr);
@@ -3529,7 +4226,7 @@ namespace graphene { namespace net {
           }
           peer->clear_old_inventory();
         }
-        message_propagation_data propagation_data{message_receive_time, message_validated_time, originating_peer->node_id};
+        message_propagation_data propagation_data{message_receive_time, message_validated_time, originating_peer->node_id, fc::time_point()};
         broadcast( block_message_to_process, propagation_data );
         _message_cache.block_accepted();
 
@@ -3615,6 +4312,7 @@ namespace graphene { namespace net {
       auto item_iter = originating_peer->items_requested_from_peer.find(item_id(graphene::net::block_message_type, message_hash));
       if (item_iter != originating_peer->items_requested_from_peer.end())
       {
+        record_item_arrival(originating_peer, item_iter->second);
         originating_peer->items_requested_from_peer.erase(item_iter);
         process_block_during_normal_operation(originating_peer, block_message_to_process, message_hash);
         if (originating_peer->idle())
@@ -3634,6 +4332,7 @@ namespace graphene { namespace net {
           try
           {
             originating_peer->last_sync_item_received_time = fc::time_point::now();
+            record_sync_block_arrival(originating_peer);
             _active_sync_requests.erase(block_message_to_process.block_id);
             process_block_during_sync(originating_peer, block_message_to_process, message_hash);
             if (originating_peer->idle())
@@ -3646,6 +4345,8 @@ namespace graphene { namespace net {
               else
                 trigger_fetch_sync_items_loop();
             }
+            else if (originating_peer->sync_items_requested_from_peer.size() <= get_sync_request_size(originating_peer) / 2)
+              trigger_fetch_sync_items_loop(); // top up the peer's request before it runs dry
             return;
           }
           catch (const fc::canceled_exception& e)
@@ -3927,6 +4628,10 @@ namespace graphene { namespace net {
         user_data["last_known_block_hash"] = peer->last_block_delegate_has_seen;
         user_data["last_known_block_number"] = _delegate->get_block_number(peer->last_block_delegate_has_seen);
         user_data["last_known_block_time"] = peer->last_block_time_delegate_has_seen;
+        user_data["item_latency_us"] = (uint64_t)peer->item_latency_us;
+        user_data["items_received"] = peer->items_received;
+        user_data["item_requests_failed"] = peer->item_requests_failed;
+        user_data["score"] = get_peer_score(peer.get());
 
         data_for_this_peer.user_data = user_data;
         reply.current_connections.emplace_back(data_for_this_peer);
@@ -3965,6 +4670,7 @@ namespace graphene { namespace net {
       }
       else
       {
+        record_item_arrival(originating_peer, iter->second);
         originating_peer->items_requested_from_peer.erase( iter );
         if (originating_peer->idle())
           trigger_fetch_items_loop();
@@ -3996,7 +4702,7 @@ namespace graphene { namespace net {
         }
 
         // finally, if the delegate validated the message, broadcast it to our other peers
-        message_propagation_data propagation_data{message_receive_time, message_validated_time, originating_peer->node_id};
+        message_propagation_data propagation_data{message_receive_time, message_validated_time, originating_peer->node_id, fc::time_point()};
         broadcast( message_to_process, propagation_data );
       }
     }
@@ -4004,6 +4710,8 @@ namespace graphene { namespace net {
     void node_impl::start_synchronizing_with_peer( const peer_connection_ptr& peer )
     {
       VERIFY_CORRECT_THREAD();
+      if( _block_log_bootstrap_pending )
+        return; // finish_block_log_bootstrap() starts synchronizing with every peer
       peer->ids_of_items_to_get.clear();
       peer->number_of_unfetched_item_ids = 0;
       peer->we_need_sync_items_from_peer = true;
@@ -4024,6 +4732,9 @@ namespace graphene { namespace net {
       VERIFY_CORRECT_THREAD();
       peer->send_message(current_time_request_message(),
                          offsetof(current_time_request_message, request_sent_time));
+      if( _block_log_bootstrap_pending && !_block_log_bootstrap_peer && peer->get_remote_endpoint() &&
+          *peer->get_remote_endpoint() == *_node_configuration.block_log_bootstrap_peer )
+        start_block_log_bootstrap( peer );
       start_synchronizing_with_peer( peer );
       if( _active_connections.size() != _last_reported_number_of_connections )
       {
@@ -4120,6 +4831,19 @@ namespace graphene { namespace net {
         wlog( "Exception thrown while terminating Process backlog of sync items task, ignoring" );
       }
 
+      try
+      {
+        if( _block_log_bootstrap_timeout_done.valid() )
+          _block_log_bootstrap_timeout_done.cancel_and_wait("node_impl::close()");
+      }
+      catch ( const fc::canceled_exception& )
+      {
+      }
+      catch ( const fc::exception& e )
+      {
+        wlog( "Exception thrown while terminating block log bootstrap timeout task, ignoring: ${e}", ("e", e) );
+      }
+
       unsigned handle_message_call_count = 0;
       while( true )
       {
@@ -4585,6 +5309,7 @@ namespace graphene { namespace net {
       }
 
       _node_public_key = _node_configuration.private_key.get_public_key().serialize();
+      _message_cache.set_max_size_in_bytes( _node_configuration.message_cache_max_bytes );
 
       fc::path potential_peer_database_file_name(_node_configuration_directory / POTENTIAL_PEER_DATABASE_FILENAME);
       try
@@ -4811,6 +5536,20 @@ namespace graphene { namespace net {
       _handshaking_connections.erase(peer);
       _closing_connections.erase(peer);
       _terminating_connections.erase(peer);
+
+      // start from what we measured the last time we were connected, save_peer_score() writes it back
+      fc::optional<fc::ip::endpoint> endpoint = peer->get_endpoint_for_connecting();
+      if (endpoint)
+      {
+        fc::optional<potential_peer_record> peer_record = _potential_peer_db.lookup_entry_for_endpoint(*endpoint);
+        if (peer_record)
+        {
+          peer->item_latency_us = peer_record->item_latency_us;
+          peer->sync_block_interval_us = peer_record->sync_block_interval_us;
+          peer->items_received = peer_record->number_of_items_received;
+          peer->item_requests_failed = peer_record->number_of_item_requests_failed;
+        }
+      }
       fc_ilog(fc::logger::get("sync"), "New peer is connected (${peer}), now ${count} active peers",
               ("peer", peer->get_remote_endpoint())
               ("count", _active_connections.size()));
@@ -4870,7 +5609,7 @@ namespace graphene { namespace net {
       ilog( "node._new_received_sync_items size: ${size}", ("size", _new_received_sync_items.size() ) );
       ilog( "node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size() ) );
       ilog( "node._new_inventory size: ${size}", ("size", _new_inventory.size() ) );
-      ilog( "node._message_cache size: ${size}", ("size", _message_cache.size() ) );
+      ilog( "node._message_cache size: ${size} (${bytes} bytes)", ("size", _message_cache.size() )("bytes", _message_cache.size_in_bytes() ) );
       for( const peer_connection_ptr& peer : _active_connections )
       {
         ilog( "  peer ${endpoint}", ("endpoint", peer->get_remote_endpoint() ) );
@@ -5061,7 +5800,11 @@ namespace graphene { namespace net {
       message_hash_type hash_of_item_to_broadcast = item_to_broadcast.id();
 
       _message_cache.cache_message( item_to_broadcast, hash_of_item_to_broadcast, propagation_data, hash_of_message_contents );
+      if( _new_inventory.empty() )
+        _new_inventory_batch_start = fc::time_point::now();
       _new_inventory.insert( item_id(item_to_broadcast.msg_type, hash_of_item_to_broadcast ) );
+      if( item_to_broadcast.msg_type == graphene::net::block_message_type )
+        _new_inventory_has_blocks = true;
       trigger_advertise_inventory_loop();
     }
 
@@ -5069,7 +5812,7 @@ namespace graphene { namespace net {
     {
       VERIFY_CORRECT_THREAD();
       // this version is called directly from the client
-      message_propagation_data propagation_data{fc::time_point::now(), fc::time_point::now(), _node_id};
+      message_propagation_data propagation_data{fc::time_point::now(), fc::time_point::now(), _node_id, fc::time_point()};
       broadcast( item_to_broadcast, propagation_data );
     }
 
@@ -5104,6 +5847,30 @@ namespace graphene { namespace net {
       ilog( "set_advanced_node_parameters ${params}", ("params", params) );
 
       fc::from_variant( params, _node_configuration );
+      _message_cache.set_max_size_in_bytes( _node_configuration.message_cache_max_bytes );
+
+      if( _node_configuration.block_log_bootstrap_peer && !_block_log_bootstrap_attempted )
+      {
+        _block_log_bootstrap_attempted = true;
+        _block_log_bootstrap_pending = true;
+        for( const peer_connection_ptr& peer : _active_connections )
+          if( peer->get_remote_endpoint() && *peer->get_remote_endpoint() == *_node_configuration.block_log_bootstrap_peer )
+          {
+            start_block_log_bootstrap( peer );
+            break;
+          }
+
+        if( !_block_log_bootstrap_peer )
+          _block_log_bootstrap_timeout_done = fc::schedule( [this]()
+          {
+            if( _block_log_bootstrap_pending && !_block_log_bootstrap_peer )
+            {
+              wlog( "Block log bootstrap peer ${endpoint} did not connect, syncing normally",
+                    ("endpoint", _node_configuration.block_log_bootstrap_peer) );
+              finish_block_log_bootstrap();
+            }
+          }, fc::time_point::now() + fc::seconds( GRAPHENE_NET_BLOCK_LOG_BOOTSTRAP_TIMEOUT_SECONDS ), "block_log_bootstrap_timeout" );
+      }
 
       if( _node_configuration.private_key == fc::ecc::private_key() )
       {
@@ -5193,6 +5960,14 @@ namespace graphene { namespace net {
       info["node_public_key"] = _node_public_key;
       info["node_id"] = _node_id;
       info["firewalled"] = _is_firewalled;
+      info["compact_blocks_sent"] = _compact_blocks_sent;
+      info["compact_blocks_received"] = _compact_blocks_received;
+      info["compact_block_transactions_fetched"] = _compact_block_transactions_fetched;
+      info["message_cache_size"] = _message_cache.size();
+      info["message_cache_bytes"] = _message_cache.size_in_bytes();
+      info["message_cache_hits"] = _message_cache.hits();
+      info["message_cache_misses"] = _message_cache.misses();
+      info["message_cache_evictions"] = _message_cache.evictions();
       return info;
     }
     fc::variant_object node_impl::network_get_usage_stats() const
@@ -5678,6 +6453,17 @@ namespace graphene { namespace net {
       INVOKE_AND_COLLECT_STATISTICS(error_encountered, message, error);
     }
 
+    uint32_t statistics_gathering_node_delegate_wrapper::get_block_log_segment(uint32_t first_block_num, uint32_t max_bytes,
+                                                                               std::vector<char>& data, uint64_t& first_block_position)
+    {
+      INVOKE_AND_COLLECT_STATISTICS(get_block_log_segment, first_block_num, max_bytes, data, first_block_position);
+    }
+
+    uint32_t statistics_gathering_node_delegate_wrapper::handle_block_log_segment(const graphene::net::block_log_segment_message& segment)
+    {
+      INVOKE_AND_COLLECT_STATISTICS(handle_block_log_segment, segment);
+    }
+
 #undef INVOKE_AND_COLLECT_STATISTICS
 
   } // end namespace detail
@@ -30,6 +30,8 @@
 
 #include <boost/scope_exit.hpp>
 
+#include <algorithm>
+
 #ifdef DEFAULT_LOGGER
 # undef DEFAULT_LOGGER
 #endif
@@ -43,24 +45,34 @@
 
 namespace graphene { namespace net
   {
-    message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
+    std::shared_ptr<const message> peer_connection::real_queued_message::get_message(peer_connection_delegate*)
     {
       if (message_send_time_field_offset != (size_t)-1)
       {
         // patch the current time into the message.  Since this operates on the packed version of the structure,
         // it won't work for anything after a variable-length field
         std::vector<char> packed_current_time = fc::raw::pack_to_vector(fc::time_point::now());
-        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send.data.size());
-        memcpy(message_to_send.data.data() + message_send_time_field_offset,
+        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send->data.size());
+        memcpy(message_to_send->data.data() + message_send_time_field_offset,
                packed_current_time.data(), packed_current_time.size());
       }
       return message_to_send;
     }
     size_t peer_connection::real_queued_message::get_size_in_queue()
     {
-      return message_to_send.data.size();
+      return message_to_send->data.size();
+    }
+    std::shared_ptr<const message> peer_connection::shared_queued_message::get_message(peer_connection_delegate*)
+    {
+      return message_to_send;
     }
-    message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
+
+    size_t peer_connection::shared_queued_message::get_size_in_queue()
+    {
+      return message_to_send->data.size();
+    }
+
+    std::shared_ptr<const message> peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
     {
       return node->get_message_for_item(item_to_send);
     }
@@ -72,7 +84,7 @@ namespace graphene { namespace net
 
     peer_connection::peer_connection(peer_connection_delegate* delegate) :
       _node(delegate),
-      _message_connection(this),
+      _message_connection(this, delegate->get_io_thread()),
       _total_queued_messages_size(0),
       direction(peer_connection_direction::unknown),
       is_firewalled(firewalled_state::unknown),
@@ -294,13 +306,13 @@ namespace graphene { namespace net
       while (!_queued_messages.empty())
       {
         _queued_messages.front()->transmission_start_time = fc::time_point::now();
-        message message_to_send = _queued_messages.front()->get_message(_node);
+        std::shared_ptr<const message> message_to_send = _queued_messages.front()->get_message(_node);
         try
         {
           //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
           //     "to send message of type ${type} for peer ${endpoint}",
-          //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-          _message_connection.send_message(message_to_send);
+          //     ("type", message_to_send->msg_type)("endpoint", get_remote_endpoint()));
+          _message_connection.send_message(std::move(message_to_send));
           //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
           //     ("endpoint", get_remote_endpoint()));
         }
@@ -378,6 +390,13 @@ namespace graphene { namespace net
       send_queueable_message(std::move(message_to_enqueue));
     }
 
+    void peer_connection::send_message(std::shared_ptr<const message> message_to_send)
+    {
+      VERIFY_CORRECT_THREAD();
+      std::unique_ptr<queued_message> message_to_enqueue(new shared_queued_message(std::move(message_to_send)));
+      send_queueable_message(std::move(message_to_enqueue));
+    }
+
     void peer_connection::send_item(const item_id& item_to_send)
     {
       VERIFY_CORRECT_THREAD();
@@ -526,4 +545,28 @@ namespace graphene { namespace net
       return fc::optional<fc::ip::endpoint>();
     }
 
+    double compute_peer_score(double item_latency_us, uint32_t items_received, uint32_t item_requests_failed)
+    {
+      if (item_latency_us <= 0)
+        return 0;
+      uint64_t requests = (uint64_t)items_received + item_requests_failed;
+      double failure_rate = requests ? (double)item_requests_failed / requests : 0;
+      return item_latency_us / (1 - std::min(failure_rate, 0.9));
+    }
+
+    int find_slow_peer(const std::vector<double>& scores, double& median_score)
+    {
+      if (scores.size() < 3)
+        return -1;
+
+      std::vector<double> sorted_scores(scores);
+      std::sort(sorted_scores.begin(), sorted_scores.end());
+      median_score = sorted_scores[sorted_scores.size() / 2];
+
+      auto slowest = std::max_element(scores.begin(), scores.end());
+      if (*slowest <= median_score * GRAPHENE_NET_SLOW_PEER_SCORE_FACTOR)
+        return -1;
+      return (int)(slowest - scores.begin());
+    }
+
 } } // end namespace graphene::net
@@ -33,6 +33,8 @@
 #include <fc/exception/exception.hpp>
 
 #include <graphene/net/stcp_socket.hpp>
+#include <graphene/net/message_buffer_pool.hpp>
+#include <graphene/net/config.hpp>
 
 namespace graphene { namespace net {
 
@@ -84,6 +86,9 @@ void stcp_socket::bind( const fc::ip::endpoint& local_endpoint )
  *   This method must read at least 16 bytes at a time from
  *   the underlying TCP socket so that it can decrypt them. It
  *   will buffer any left-over.
+ *
+ *   The ciphertext is read into a pooled buffer, which the socket keeps alive if the read is
+ *   canceled, and decrypted straight into the caller's buffer.
  */
 size_t stcp_socket::readsome( char* buffer, size_t len )
 { try {
@@ -100,19 +105,16 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
     } buffer_in_use_checker(_read_buffer_in_use);
 #endif
 
-    const size_t read_buffer_length = 4096;
-    if (!_read_buffer)
-      _read_buffer.reset(new char[read_buffer_length], [](char* p){ delete[] p; });
-
-    len = std::min<size_t>(read_buffer_length, len);
+    len = std::min<size_t>(GRAPHENE_NET_SOCKET_READ_BUFFER_SIZE, len);
+    std::shared_ptr<char> read_buffer = message_buffer_pool::instance().get_buffer(len);
 
-    size_t s = _sock.readsome( _read_buffer, len, 0 );
+    size_t s = _sock.readsome( read_buffer, len, 0 );
     if( s % 16 ) 
     {
-      _sock.read(_read_buffer, 16 - (s%16), s);
+      _sock.read(read_buffer, 16 - (s%16), s);
       s += 16-(s%16);
     }
-    _recv_aes.decode( _read_buffer.get(), s, buffer );
+    _recv_aes.decode( read_buffer.get(), s, buffer );
     return s;
 } FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
 
@@ -141,23 +143,72 @@ size_t stcp_socket::writesome( const char* buffer, size_t len )
     } buffer_in_use_checker(_write_buffer_in_use);
 #endif
 
-    const std::size_t write_buffer_length = 4096;
-    if (!_write_buffer)
-      _write_buffer.reset(new char[write_buffer_length], [](char* p){ delete[] p; });
-    len = std::min<size_t>(write_buffer_length, len);
-    memset(_write_buffer.get(), 0, len); // just in case aes.encode screws up
+    std::shared_ptr<char> write_buffer = message_buffer_pool::instance().get_buffer(len);
+    memset(write_buffer.get(), 0, len); // just in case aes.encode screws up
     /**
      * every sizeof(crypt_buf) bytes the aes channel
      * has an error and doesn't decrypt properly...  disable
      * for now because we are going to upgrade to something
      * better.
      */
-    uint32_t ciphertext_len = _send_aes.encode( buffer, len, _write_buffer.get() );
+    uint32_t ciphertext_len = _send_aes.encode( buffer, len, write_buffer.get() );
     assert(ciphertext_len == len);
-    _sock.write( _write_buffer, ciphertext_len );
+    _sock.write( write_buffer, ciphertext_len );
     return ciphertext_len;
 } FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
 
+void stcp_socket::write_framed( const char* header, size_t header_len, const char* body, size_t body_len )
+{ try {
+    size_t len = header_len + body_len;
+    size_t len_with_padding = 16 * ((len + 15) / 16);
+
+#ifndef NDEBUG
+    struct check_buffer_in_use {
+      bool& _buffer_in_use;
+      check_buffer_in_use(bool& buffer_in_use) : _buffer_in_use(buffer_in_use) { assert(!_buffer_in_use); _buffer_in_use = true; }
+      ~check_buffer_in_use() { assert(_buffer_in_use); _buffer_in_use = false; }
+    } buffer_in_use_checker(_write_buffer_in_use);
+#endif
+
+    // The cipher only takes whole 16 byte blocks.  The runs of whole blocks are encrypted where
+    // they are, only the blocks straddling the header, the body and the padding are put together.
+    std::shared_ptr<char> write_buffer = message_buffer_pool::instance().get_buffer(len_with_padding);
+    uint32_t ciphertext_len = 0;
+    char block[16];
+    size_t block_len = 0;
+    auto encode = [&]( const char* data, size_t data_len )
+    {
+      if( !data_len )
+        return;
+      if( block_len )
+      {
+        size_t count = std::min<size_t>( data_len, sizeof(block) - block_len );
+        memcpy( block + block_len, data, count );
+        block_len += count;
+        data += count;
+        data_len -= count;
+        if( block_len < sizeof(block) )
+          return;
+        ciphertext_len += _send_aes.encode( block, sizeof(block), write_buffer.get() + ciphertext_len );
+        block_len = 0;
+      }
+      size_t whole_blocks_len = data_len - data_len % sizeof(block);
+      if( whole_blocks_len )
+        ciphertext_len += _send_aes.encode( data, whole_blocks_len, write_buffer.get() + ciphertext_len );
+      block_len = data_len - whole_blocks_len;
+      memcpy( block, data + whole_blocks_len, block_len );
+    };
+    encode( header, header_len );
+    encode( body, body_len );
+    if( block_len )
+    {
+      memset( block + block_len, 0, sizeof(block) - block_len );
+      ciphertext_len += _send_aes.encode( block, sizeof(block), write_buffer.get() + ciphertext_len );
+    }
+    assert(ciphertext_len == len_with_padding);
+    _sock.write( write_buffer, ciphertext_len );
+} FC_RETHROW_EXCEPTIONS( warn, "", ("header_len",header_len)("body_len",body_len) ) }
+
 size_t stcp_socket::writesome( const std::shared_ptr<const char>& buf, size_t len, size_t offset )
 {
   return writesome(buf.get() + offset, len);
@@ -50,7 +50,7 @@ typedef multi_index_container<
          >
       >
    >,
-   allocator< key_lookup_object >
+   node_allocator< key_lookup_object >
 > key_lookup_index;
 
 } } } // bears::plugins::account_by_key
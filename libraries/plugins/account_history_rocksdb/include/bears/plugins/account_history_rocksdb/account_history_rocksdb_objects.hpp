@@ -89,7 +89,7 @@ typedef multi_index_container<
             >
          >
       >,
-      allocator< volatile_operation_object >
+      node_allocator< volatile_operation_object >
    > volatile_operation_index;
 
 } } } // bears::plugins::account_history_rocksdb
@@ -49,10 +49,10 @@ block_api_impl::~block_api_impl() {}
 DEFINE_API_IMPL( block_api_impl, get_block_header )
 {
    get_block_header_return result;
-   auto block = _db.fetch_block_by_number( args.block_num );
+   auto header = _db.fetch_block_header_by_number( args.block_num );
 
-   if( block )
-      result.header = *block;
+   if( header )
+      result.header = *header;
 
    return result;
 }
@@ -19,9 +19,7 @@ struct api_signed_block_object : public signed_block
    {
       block_id = id();
       signing_key = signee();
-      transaction_ids.reserve( transactions.size() );
-      for( const signed_transaction& tx : transactions )
-         transaction_ids.push_back( tx.id() );
+      transaction_ids = calculate_transaction_ids( transactions );
    }
    api_signed_block_object() {}
 
@@ -1413,10 +1413,10 @@ DEFINE_API_IMPL( database_api_impl, verify_signatures )
 {
    // get_signature_keys can throw for dup sigs. Allow this to throw.
    flat_set< public_key_type > sig_keys;
-   for( const auto&  sig : args.signatures )
+   for( auto& key : fc::ecc::recover_public_keys( args.signatures, args.hash ) )
    {
       BEARS_ASSERT(
-         sig_keys.insert( fc::ecc::public_key( sig, args.hash ) ).second,
+         sig_keys.insert( std::move( key ) ).second,
          protocol::tx_duplicate_sig,
          "Duplicate Signature detected" );
    }
@@ -74,10 +74,13 @@ struct api_comment_object
          root_permlink = to_string( root->permlink );
       }
 #ifndef IS_LOW_MEM
-      const auto& con = db.get< chain::comment_content_object, chain::by_comment >( o.id );
-      title = to_string( con.title );
-      body = to_string( con.body );
-      json_metadata = to_string( con.json_metadata );
+      auto con = db.find_comment_content( o.id );
+      if( con.valid() )
+      {
+         title = std::move( con->title );
+         body = std::move( con->body );
+         json_metadata = std::move( con->json_metadata );
+      }
 #endif
    }
 
@@ -163,15 +166,9 @@ struct api_account_object
    api_account_object( const account_object& a, const database& db ) :
       id( a.id ),
       name( a.name ),
-      memo_key( a.memo_key ),
-      json_metadata( to_string( a.json_metadata ) ),
       proxy( a.proxy ),
-      last_account_update( a.last_account_update ),
       created( a.created ),
       mined( a.mined ),
-      recovery_account( a.recovery_account ),
-      reset_account( a.reset_account ),
-      last_account_recovery( a.last_account_recovery ),
       comment_count( a.comment_count ),
       lifetime_vote_count( a.lifetime_vote_count ),
       post_count( a.post_count ),
@@ -219,6 +216,14 @@ struct api_account_object
       active = authority( auth.active );
       posting = authority( auth.posting );
       last_owner_update = auth.last_owner_update;
+
+      const auto& meta = db.get< account_metadata_object, by_account >( name );
+      memo_key = meta.memo_key;
+      json_metadata = to_string( meta.json_metadata );
+      last_account_update = meta.last_account_update;
+      recovery_account = meta.recovery_account;
+      reset_account = meta.reset_account;
+      last_account_recovery = meta.last_account_recovery;
 #ifdef BEARS_ENABLE_SMT
       const auto& by_control_account_index = db.get_index<smt_token_index>().indices().get<by_control_account>();
       auto smt_obj_itr = by_control_account_index.find( name );
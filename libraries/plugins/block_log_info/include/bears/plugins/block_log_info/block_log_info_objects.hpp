@@ -68,7 +68,7 @@ typedef multi_index_container<
    indexed_by<
       ordered_unique< tag< by_id >, member< block_log_hash_state_object, block_log_hash_state_id_type, &block_log_hash_state_object::id > >
    >,
-   allocator< block_log_hash_state_object >
+   node_allocator< block_log_hash_state_object >
 > block_log_hash_state_index;
 
 typedef multi_index_container<
@@ -76,7 +76,7 @@ typedef multi_index_container<
    indexed_by<
       ordered_unique< tag< by_id >, member< block_log_pending_message_object, block_log_pending_message_id_type, &block_log_pending_message_object::id > >
    >,
-   allocator< block_log_pending_message_object >
+   node_allocator< block_log_pending_message_object >
 > block_log_pending_message_index;
 
 } } } // bears::plugins::block_log_info
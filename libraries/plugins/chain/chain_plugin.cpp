@@ -1,5 +1,7 @@
 #include <bears/chain/database_exceptions.hpp>
 
+#include <bears/protocol/signature_cache.hpp>
+
 #include <bears/plugins/chain/chain_plugin.hpp>
 #include <bears/plugins/statsd/utility.hpp>
 
@@ -42,7 +44,15 @@ struct generate_block_request
    signed_block block;
 };
 
-typedef fc::static_variant< const signed_block*, const signed_transaction*, generate_block_request* > write_request_ptr;
+struct import_blocks_request
+{
+   import_blocks_request( const std::vector< signed_block >& b ) : blocks( b ) {}
+
+   const std::vector< signed_block >& blocks;
+   uint32_t head_block_num = 0;
+};
+
+typedef fc::static_variant< const signed_block*, const signed_transaction*, generate_block_request*, import_blocks_request* > write_request_ptr;
 typedef fc::static_variant< boost::promise< void >*, fc::future< void >* > promise_ptr;
 
 struct write_context
@@ -68,6 +78,9 @@ class chain_plugin_impl
       uint64_t                         shared_memory_size = 0;
       uint16_t                         shared_file_full_threshold = 0;
       uint16_t                         shared_file_scale_rate = 0;
+      uint32_t                         chainbase_flags = 0;
+      database::comment_content_mode   comment_content = database::comment_content_in_state;
+      bool                             slim_transaction_index = false;
       bfs::path                        shared_memory_dir;
       bool                             replay = false;
       bool                             resync   = false;
@@ -80,6 +93,9 @@ class chain_plugin_impl
       uint32_t                         stop_replay_at = 0;
       uint32_t                         benchmark_interval = 0;
       uint32_t                         flush_interval = 0;
+      uint32_t                         flush_rate = 0;
+      uint32_t                         checkpoint_interval = 0;
+      bfs::path                        checkpoint_dir;
       flat_map<uint32_t,block_id_type> loaded_checkpoints;
 
       uint32_t allow_future_time = 5;
@@ -111,6 +127,14 @@ struct write_request_visitor
          STATSD_START_TIMER( "chain", "write_time", "push_block", 1.0f )
          result = db->push_block( *block, skip );
          STATSD_STOP_TIMER( "chain", "write_time", "push_block" )
+
+         if( bears::plugins::statsd::util::statsd_enabled() )
+         {
+            auto stats = bears::protocol::signature_cache::instance().get_stats();
+            STATSD_GAUGE( "chain", "signature_cache", "hits", stats.hits, 1.0f )
+            STATSD_GAUGE( "chain", "signature_cache", "misses", stats.misses, 1.0f )
+            STATSD_GAUGE( "chain", "signature_cache", "size", stats.size, 1.0f )
+         }
       }
       catch( fc::exception& e )
       {
@@ -179,6 +203,31 @@ struct write_request_visitor
 
       return result;
    }
+
+   bool operator()( import_blocks_request* req )
+   {
+      bool result = false;
+
+      try
+      {
+         STATSD_START_TIMER( "chain", "write_time", "import_blocks", 1.0f )
+         req->head_block_num = db->import_irreversible_blocks( req->blocks );
+         STATSD_STOP_TIMER( "chain", "write_time", "import_blocks" )
+
+         result = true;
+      }
+      catch( fc::exception& e )
+      {
+         *except = e;
+      }
+      catch( ... )
+      {
+         *except = fc::unhandled_exception( FC_LOG_MESSAGE( warn, "Unexpected exception while importing blocks." ),
+                                           std::current_exception() );
+      }
+
+      return result;
+   }
 };
 
 struct request_promise_visitor
@@ -259,6 +308,11 @@ void chain_plugin_impl::start_write_processing()
                   }
                }
             });
+
+            // Nothing writes to the state until the next write lock, readers go on during the checkpoint
+            // and while comment content is appended to its store
+            db.create_due_checkpoint();
+            db.archive_comment_content();
          }
 
          if( !is_syncing )
@@ -300,10 +354,29 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("shared-file-full-threshold", bpo::value<uint16_t>()->default_value(0),
             "A 2 precision percentage (0-10000) that defines the threshold for when to autoscale the shared memory file. Setting this to 0 disables autoscaling. Recommended value for consensus node is 9500 (95%). Full node is 9900 (99%)" )
          ("shared-file-scale-rate", bpo::value<uint16_t>()->default_value(0),
-            "A 2 precision percentage (0-10000) that defines how quickly to scale the shared memory file. When autoscaling occurs the file's size will be increased by this percent. Setting this to 0 disables autoscaling. Recommended value is between 1000-2000 (10-20%)" )
+            "A 2 precision percentage (0-10000) that defines how quickly to scale the shared memory file. When autoscaling occurs the file's size will be increased by this percent, in place and without stopping block processing. Setting this to 0 disables autoscaling. Recommended value is between 1000-2000 (10-20%)" )
+         ("shared-file-huge-pages", bpo::bool_switch()->default_value(false),
+            "Advise the kernel to back the shared memory file with transparent huge pages. Takes effect when shared-file-dir is on tmpfs with shmem huge pages set to advise. A shared-file-dir on hugetlbfs always uses huge pages.")
+         ("shared-file-prefault", bpo::bool_switch()->default_value(false), "Fault in the whole shared memory file on startup instead of on first access")
+         ("shared-file-lock", bpo::bool_switch()->default_value(false), "Lock the shared memory file in RAM. Requires a memlock limit of at least shared-file-size.")
+         ("shared-file-numa-interleave", bpo::bool_switch()->default_value(false), "Interleave the pages of the shared memory file over all NUMA nodes, faults in the whole file on startup")
+         ("comment-content-store", bpo::value<string>()->default_value("state"),
+            "Where comment titles, bodies and json metadata are kept. 'state' keeps them in the shared memory file, 'file' moves them to an append only file next to it once irreversible, 'none' does not store them (consensus only nodes). Changing this requires a replay, a state built with another setting is not opened.")
+         ("slim-transaction-index", bpo::bool_switch()->default_value(false),
+            "Keep only the id, expiration and block number of recent transactions in the shared memory file. Recent transactions are then served from the fork database and block log.")
          ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("flush-state-interval", bpo::value<uint32_t>(),
             "flush shared memory changes to disk every N blocks")
+         ("flush-state-rate", bpo::value<uint32_t>()->default_value(0),
+            "Continuously write shared memory changes back to disk from a background thread, covering at most N MiB of the file per second. Replaces flush-state-interval. 0 disables the background flush.")
+         ("state-checkpoint-interval", bpo::value<uint32_t>()->default_value(0),
+            "Checkpoint the shared memory file every N blocks. After an unclean shutdown the node resumes from the checkpoint and the blocks in the block log after it. Checkpoints are clones of the file and need a file system with reflinks (btrfs, xfs), they are disabled elsewhere. 0 disables checkpoints.")
+         ("state-checkpoint-dir", bpo::value<bfs::path>()->default_value("checkpoint"),
+            "the location of the shared memory checkpoint (absolute path or relative to shared-file-dir). Has to be on the same file system as shared-file-dir for the checkpoint to be a clone.")
+         ("signature-recovery-threads", bpo::value<uint32_t>()->default_value(0),
+            "Number of additional threads used to recover public keys from transaction signatures. 0 recovers on the calling thread.")
+         ("signature-cache-size", bpo::value<uint32_t>()->default_value(50000),
+            "Number of public keys recovered from transaction signatures to keep cached. 0 disables the cache.")
          ;
    cli.add_options()
          ("replay-blockchain", bpo::bool_switch()->default_value(false), "clear chain database and replay all blocks" )
@@ -338,6 +411,30 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
    if( options.count( "shared-file-scale-rate" ) )
       my->shared_file_scale_rate = options.at( "shared-file-scale-rate" ).as< uint16_t >();
 
+   if( options.at( "shared-file-huge-pages" ).as< bool >() )
+      my->chainbase_flags |= chainbase::database::huge_pages;
+   if( options.at( "shared-file-prefault" ).as< bool >() )
+      my->chainbase_flags |= chainbase::database::prefault;
+   if( options.at( "shared-file-lock" ).as< bool >() )
+      my->chainbase_flags |= chainbase::database::lock_memory;
+   if( options.at( "shared-file-numa-interleave" ).as< bool >() )
+      my->chainbase_flags |= chainbase::database::numa_interleave;
+
+   if( options.count( "comment-content-store" ) )
+   {
+      auto content_store = options.at( "comment-content-store" ).as< string >();
+      if( content_store == "state" )
+         my->comment_content = database::comment_content_in_state;
+      else if( content_store == "file" )
+         my->comment_content = database::comment_content_archived;
+      else if( content_store == "none" )
+         my->comment_content = database::comment_content_disabled;
+      else
+         FC_ASSERT( false, "Unknown comment-content-store ${s}, expected state, file or none", ("s", content_store) );
+   }
+
+   my->slim_transaction_index = options.at( "slim-transaction-index" ).as< bool >();
+
    my->replay              = options.at( "replay-blockchain").as<bool>();
    my->resync              = options.at( "resync-blockchain").as<bool>();
    my->stop_replay_at      =
@@ -351,6 +448,23 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       my->flush_interval = options.at( "flush-state-interval" ).as<uint32_t>();
    else
       my->flush_interval = 10000;
+   my->flush_rate = options.at( "flush-state-rate" ).as< uint32_t >();
+
+   my->checkpoint_interval = options.at( "state-checkpoint-interval" ).as< uint32_t >();
+   my->checkpoint_dir = options.at( "state-checkpoint-dir" ).as< bfs::path >();
+   if( my->checkpoint_dir.is_relative() )
+      my->checkpoint_dir = my->shared_memory_dir / my->checkpoint_dir;
+
+   if( options.count( "signature-recovery-threads" ) )
+   {
+      auto recovery_threads = options.at( "signature-recovery-threads" ).as< uint32_t >();
+      if( recovery_threads )
+         ilog( "Recovering signature keys on ${n} additional threads", ("n", recovery_threads) );
+      fc::ecc::set_recovery_threads( recovery_threads );
+   }
+
+   if( options.count( "signature-cache-size" ) )
+      bears::protocol::signature_cache::instance().set_capacity( options.at( "signature-cache-size" ).as< uint32_t >() );
 
    if(options.count("checkpoint"))
    {
@@ -406,7 +520,21 @@ void chain_plugin::plugin_startup()
       my->db.wipe( app().data_dir() / "blockchain", my->shared_memory_dir, true );
    }
 
+   // A checkpoint is only valid for the state it was taken from
+   if( my->replay || my->resync )
+      bfs::remove_all( my->checkpoint_dir / "shared_memory.bin" );
+
+   // Checkpoints are taken between writes, a full copy of the file would stall block application
+   if( my->checkpoint_interval && !chainbase::database::can_clone( my->shared_memory_dir, my->checkpoint_dir ) )
+   {
+      elog( "State checkpoints are disabled, the shared memory file cannot be cloned into ${path}. Put state-checkpoint-dir on the file system of shared-file-dir, which has to support reflinks (btrfs, xfs).",
+         ("path", my->checkpoint_dir.generic_string()) );
+      my->checkpoint_interval = 0;
+   }
+
    my->db.set_flush_interval( my->flush_interval );
+   my->db.set_background_flush( size_t( my->flush_rate ) * 1024 * 1024 );
+   my->db.set_checkpoint_interval( my->checkpoint_interval, my->checkpoint_dir );
    my->db.add_checkpoints( my->loaded_checkpoints );
    my->db.set_require_locking( my->check_locks );
 
@@ -426,7 +554,8 @@ void chain_plugin::plugin_startup()
       {
          auto info = idx->get_statistics(onlyStaticInfo);
          index_memory_details_cntr.emplace_back(std::move(info._value_type_name), info._item_count,
-            info._item_sizeof, info._item_additional_allocation, info._additional_container_allocation);
+            info._item_sizeof, info._item_additional_allocation, info._additional_container_allocation,
+            info._pool_reserved, info._pool_free);
       }
    };
 
@@ -437,6 +566,9 @@ void chain_plugin::plugin_startup()
    db_open_args.shared_file_size = my->shared_memory_size;
    db_open_args.shared_file_full_threshold = my->shared_file_full_threshold;
    db_open_args.shared_file_scale_rate = my->shared_file_scale_rate;
+   db_open_args.chainbase_flags = my->chainbase_flags;
+   db_open_args.comment_content = my->comment_content;
+   db_open_args.slim_transaction_index = my->slim_transaction_index;
    db_open_args.do_validate_invariants = my->validate_invariants;
    db_open_args.stop_replay_at = my->stop_replay_at;
    db_open_args.benchmark_is_enabled = my->benchmark_is_enabled;
@@ -502,11 +634,38 @@ void chain_plugin::plugin_startup()
    {
       db_open_args.benchmark = bears::chain::database::TBenchmark(dump_memory_details, benchmark_lambda);
 
+      bool has_checkpoint = my->checkpoint_interval && bfs::exists( my->checkpoint_dir / "shared_memory.bin" );
+      auto open_from_checkpoint = [&]()
+      { try {
+         wlog( "Resuming from the shared memory checkpoint in ${path}", ("path", my->checkpoint_dir.generic_string()) );
+         try
+         {
+            my->db.close();
+         }
+         FC_CAPTURE_AND_LOG( () )
+         chainbase::database::restore_checkpoint( my->checkpoint_dir, my->shared_memory_dir );
+         my->db.open( db_open_args );
+      } FC_CAPTURE_AND_RETHROW() };
+
       try
       {
          ilog("Opening shared memory from ${path}", ("path",my->shared_memory_dir.generic_string()));
 
-         my->db.open( db_open_args );
+         try
+         {
+            my->db.open( db_open_args );
+         }
+         catch( const fc::exception& e )
+         {
+            if( !has_checkpoint )
+               throw;
+            wlog( "Error opening database: ${e}", ("e", e) );
+            open_from_checkpoint();
+         }
+
+         // A process that did not close the file may have stopped in the middle of changing it
+         if( has_checkpoint && my->db.opened_after_crash() )
+            open_from_checkpoint();
 
          if( dump_memory_details )
             dumper.dump( true, get_indexes_memory_details );
@@ -526,6 +685,9 @@ void chain_plugin::plugin_startup()
 
 void chain_plugin::plugin_shutdown()
 {
+   auto sig_stats = bears::protocol::signature_cache::instance().get_stats();
+   ilog( "Signature cache hits: ${h}, misses: ${m}", ("h", sig_stats.hits)("m", sig_stats.misses) );
+
    ilog("closing chain database");
    my->stop_write_processing();
    my->db.close();
@@ -597,6 +759,25 @@ bears::chain::signed_block chain_plugin::generate_block(
    return req.block;
 }
 
+uint32_t chain_plugin::import_irreversible_blocks( const std::vector< bears::chain::signed_block >& blocks )
+{
+   import_blocks_request req( blocks );
+   boost::promise< void > prom;
+   write_context cxt;
+   cxt.req_ptr = &req;
+   cxt.prom_ptr = &prom;
+
+   my->write_queue.push( &cxt );
+
+   prom.get_future().get();
+
+   if( cxt.except ) throw *(cxt.except);
+
+   FC_ASSERT( cxt.success, "Blocks could not be imported" );
+
+   return req.head_block_num;
+}
+
 int16_t chain_plugin::set_write_lock_hold_time( int16_t new_time )
 {
    FC_ASSERT( get_state() == appbase::abstract_plugin::state::initialized,
@@ -42,6 +42,13 @@ public:
       uint32_t skip = database::skip_nothing
       );
 
+   /**
+    * Applies a run of irreversible blocks taken from a trusted peer's block log and appends
+    * them to the block log, see database::import_irreversible_blocks(). Returns the new head
+    * block number.
+    */
+   uint32_t import_irreversible_blocks( const std::vector< bears::chain::signed_block >& blocks );
+
    /**
     * Sets the time (in ms) that the write thread will hold the lock for.
     * A time of -1 is no limit and pre-empts all readers. A time of 0 will
@@ -191,7 +191,7 @@ typedef multi_index_container<
          composite_key_compare< std::less< account_name_type >, std::less< account_name_type > >
       >
    >,
-   allocator< follow_object >
+   node_allocator< follow_object >
 > follow_index;
 
 struct by_blogger_guest_count;
@@ -234,7 +234,7 @@ typedef multi_index_container<
          composite_key_compare< std::less< comment_id_type >, std::less< account_name_type >, std::less< feed_id_type > >
       >
    >,
-   allocator< feed_object >
+   node_allocator< feed_object >
 > feed_index;
 
 struct by_blog;
@@ -259,7 +259,7 @@ typedef multi_index_container<
          composite_key_compare< std::less< comment_id_type >, std::less< account_name_type >, std::less< blog_id_type > >
       >
    >,
-   allocator< blog_object >
+   node_allocator< blog_object >
 > blog_index;
 
 typedef multi_index_container<
@@ -268,7 +268,7 @@ typedef multi_index_container<
       ordered_unique< tag< by_id >, member< reputation_object, reputation_id_type, &reputation_object::id > >,
       ordered_unique< tag< by_account >, member< reputation_object, account_name_type, &reputation_object::account > >
    >,
-   allocator< reputation_object >
+   node_allocator< reputation_object >
 > reputation_index;
 
 
@@ -281,7 +281,7 @@ typedef multi_index_container<
       ordered_unique< tag< by_id >, member< follow_count_object, follow_count_id_type, &follow_count_object::id > >,
       ordered_unique< tag< by_account >, member< follow_count_object, account_name_type, &follow_count_object::account > >
    >,
-   allocator< follow_count_object >
+   node_allocator< follow_count_object >
 > follow_count_index;
 
 } } } // bears::plugins::follow
@@ -144,7 +144,7 @@ typedef multi_index_container<
          composite_key_compare< std::less< uint32_t >, std::less< fc::time_point_sec > >
       >
    >,
-   allocator< bucket_object >
+   node_allocator< bucket_object >
 > bucket_index;
 
 struct by_time;
@@ -154,7 +154,7 @@ typedef multi_index_container<
       ordered_unique< tag< by_id >, member< order_history_object, order_history_id_type, &order_history_object::id > >,
       ordered_non_unique< tag< by_time >, member< order_history_object, time_point_sec, &order_history_object::time > >
    >,
-   allocator< order_history_object >
+   node_allocator< order_history_object >
 > order_history_index;
 
 } } } // bears::plugins::market_history
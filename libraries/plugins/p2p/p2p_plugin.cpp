@@ -6,7 +6,9 @@
 #include <graphene/net/exceptions.hpp>
 
 #include <bears/chain/database_exceptions.hpp>
+#include <bears/chain/util/signal.hpp>
 
+#include <fc/bloom_filter.hpp>
 #include <fc/network/ip.hpp>
 #include <fc/network/resolve.hpp>
 #include <fc/thread/thread.hpp>
@@ -21,6 +23,7 @@
 #include <atomic>
 #include <chrono>
 #include <future>
+#include <mutex>
 
 using std::string;
 using std::vector;
@@ -39,6 +42,8 @@ using bears::protocol::block_header;
 using bears::protocol::signed_block_header;
 using bears::protocol::signed_block;
 using bears::protocol::block_id_type;
+using bears::protocol::signed_transaction;
+using bears::protocol::transaction_id_type;
 
 namespace detail {
 
@@ -73,6 +78,53 @@ std::vector<fc::ip::endpoint> resolve_string_to_ip_endpoints( const std::string&
    FC_CAPTURE_AND_RETHROW( (endpoint_string) )
 }
 
+/**
+ * Remembers the ids of recently accepted transactions so repeats can be dropped before they reach the
+ * chain. Two bloom filters are kept, when the newer one is full the older one is cleared and takes its
+ * place, so the ids of roughly the last one to two generations of transactions are remembered.
+ *
+ * A false positive drops a valid transaction at this node only, it still reaches the network through
+ * our other peers.
+ */
+class recent_transaction_filter
+{
+   public:
+      recent_transaction_filter()
+      {
+         fc::bloom_parameters parameters;
+         parameters.projected_element_count = transactions_per_generation;
+         parameters.false_positive_probability = 1.0 / 1000000;
+         parameters.compute_optimal_parameters();
+         _current = fc::bloom_filter( parameters );
+         _previous = fc::bloom_filter( parameters );
+      }
+
+      void insert( const transaction_id_type& id )
+      {
+         std::lock_guard< std::mutex > lock( _mutex );
+         if( _current.element_count() >= transactions_per_generation )
+         {
+            std::swap( _current, _previous );
+            _current.clear();
+         }
+         _current.insert( (const unsigned char*)id.data(), id.data_size() );
+      }
+
+      bool contains( const transaction_id_type& id )const
+      {
+         std::lock_guard< std::mutex > lock( _mutex );
+         return _current.contains( (const unsigned char*)id.data(), id.data_size() )
+             || _previous.contains( (const unsigned char*)id.data(), id.data_size() );
+      }
+
+   private:
+      static const uint32_t transactions_per_generation = 100000;
+
+      fc::bloom_filter     _current;
+      fc::bloom_filter     _previous;
+      mutable std::mutex   _mutex;
+};
+
 class p2p_plugin_impl : public graphene::net::node_delegate
 {
 public:
@@ -104,14 +156,29 @@ public:
    virtual graphene::net::item_hash_t get_head_block_id() const override;
    virtual uint32_t estimate_last_known_fork_from_git_revision_timestamp( uint32_t ) const override;
    virtual void error_encountered( const std::string& message, const fc::oexception& error ) override;
+   virtual uint32_t get_block_log_segment( uint32_t, uint32_t, std::vector< char >&, uint64_t& ) override;
+   virtual uint32_t handle_block_log_segment( const graphene::net::block_log_segment_message& ) override;
+
+   /** Drops transactions that can not be valid without reading the chain state, see handle_transaction */
+   void precheck_transaction( const signed_transaction& trx )const;
+   void on_post_apply_block( const bears::chain::block_notification& note );
 
    fc::optional<fc::ip::endpoint> endpoint;
    vector<fc::ip::endpoint> seeds;
    string user_agent;
    fc::mutable_variant_object config;
    uint32_t max_connections = 0;
+   fc::optional< uint32_t > io_threads;
+   bool serve_block_log = false;
+   fc::optional< fc::ip::endpoint > block_log_bootstrap_peer;
    bool force_validate = false;
    bool block_producer = false;
+   uint32_t precheck_thread_count = 2;
+   std::vector< std::shared_ptr< fc::thread > > precheck_threads;
+   uint32_t next_precheck_thread = 0;
+   recent_transaction_filter recent_transactions;
+   std::atomic< uint32_t > max_transaction_size{ BEARS_MAX_BLOCK_SIZE };
+   boost::signals2::connection post_apply_block_conn;
    std::atomic_bool   running;
    std::atomic_bool   activeHandleBlock;
    std::atomic_bool   activeHandleTx;
@@ -199,6 +266,9 @@ bool p2p_plugin_impl::handle_block( const graphene::net::block_message& blk_msg,
          // you can help the network code out by throwing a block_older_than_undo_history exception.
          // when the net code sees that, it will stop trying to push blocks from that chain, but
          // leave that peer connected so that they can get sync blocks from us
+         // The block was just unpacked from the network and is never edited, memoize the
+         // transaction encodings so the chain does not repack and rehash them.
+         blk_msg.block.memoize( chain.db().get_chain_id() );
          bool result = chain.accept_block( blk_msg.block, sync_mode, ( block_producer | force_validate ) ? chain::database::skip_nothing : chain::database::skip_transaction_signatures );
 
          if( !sync_mode )
@@ -248,7 +318,25 @@ void p2p_plugin_impl::handle_transaction( const graphene::net::trx_message& trx_
       {
          shutdown_helper helper(*this, activeHandleTx, handleTxFinished);
 
+         trx_msg.trx.memoize( chain.db().get_chain_id() );
+
+         // Junk is dropped here instead of costing a trip through the write queue. Waiting on a
+         // precheck thread lets the p2p thread take in other transactions, which are checked in parallel.
+         // The wait can be canceled when the node shuts down, so the task checks its own copy of
+         // the transaction, which shares the memoized encoding, rather than the message.
+         if( precheck_threads.empty() )
+            precheck_transaction( trx_msg.trx );
+         else
+         {
+            auto trx = std::make_shared< const signed_transaction >( trx_msg.trx );
+            precheck_threads[ next_precheck_thread++ % precheck_threads.size() ]->async( [this, trx]()
+            {
+               precheck_transaction( *trx );
+            }, "precheck_transaction" ).wait();
+         }
+
          chain.accept_transaction( trx_msg.trx );
+         recent_transactions.insert( trx_msg.trx.id() );
 
       } FC_CAPTURE_AND_RETHROW( (trx_msg) )
    }
@@ -262,6 +350,45 @@ void p2p_plugin_impl::handle_transaction( const graphene::net::trx_message& trx_
    }
 }
 
+void p2p_plugin_impl::precheck_transaction( const signed_transaction& trx )const
+{
+   try
+   {
+      FC_ASSERT( trx.packed_size() <= max_transaction_size.load(), "Transaction is larger than the maximum block size allows",
+         ("size", trx.packed_size())("max", max_transaction_size.load()) );
+
+      FC_ASSERT( !recent_transactions.contains( trx.id() ), "Transaction was recently accepted" );
+
+      // The head block time trails the wall clock, allow a block interval of difference either way
+      fc::time_point_sec now = fc::time_point::now();
+      FC_ASSERT( trx.expiration > now - fc::seconds( BEARS_BLOCK_INTERVAL ), "Transaction is expired",
+         ("expiration", trx.expiration)("now", now) );
+      FC_ASSERT( trx.expiration <= now + fc::seconds( BEARS_MAX_TIME_UNTIL_EXPIRATION + BEARS_BLOCK_INTERVAL ),
+         "Transaction expires too far in the future", ("expiration", trx.expiration)("now", now) );
+
+      trx.validate();
+
+      // Recovering the keys fills the signature cache, verifying the authority on the write thread
+      // then looks them up. Whether the signatures are canonical depends on the hardfork and is
+      // left to the chain.
+      trx.get_signature_keys( chain.db().get_chain_id(), fc::ecc::non_canonical );
+   }
+   catch( const fc::exception& )
+   {
+      STATSD_INCREMENT( "p2p", "transaction", "precheck_rejected", 1.0f )
+      throw;
+   }
+}
+
+void p2p_plugin_impl::on_post_apply_block( const bears::chain::block_notification& note )
+{
+   // Called on the write thread, the chain state can be read without a lock
+   for( const auto& trx : note.block.transactions )
+      recent_transactions.insert( trx.id() );
+
+   max_transaction_size.store( chain.db().get_dynamic_global_properties().maximum_block_size - 256 );
+}
+
 void p2p_plugin_impl::handle_message( const graphene::net::message& message_to_process )
 {
    // not a transaction, not a block
@@ -328,13 +455,23 @@ graphene::net::message p2p_plugin_impl::get_item( const graphene::net::item_id&
    {
       return chain.db().with_read_lock( [&]()
       {
-         auto opt_block = chain.db().fetch_block_by_id(id.item_hash);
+         auto opt_block = chain.db().fetch_block_view_by_id(id.item_hash);
          if( !opt_block )
             elog("Couldn't find block ${id} -- corresponding ID in our chain is ${id2}",
                ("id", id.item_hash)("id2", chain.db().get_block_id_for_num(block_header::num_from_id(id.item_hash))));
          FC_ASSERT( opt_block.valid() );
          // ilog("Serving up block #${num}", ("num", opt_block->block_num()));
-         return block_message(std::move(*opt_block));
+
+         // A packed block_message is the packed block followed by its id, so the message can be
+         // assembled from the stored bytes without unpacking and repacking the block.
+         graphene::net::message msg;
+         msg.msg_type = graphene::net::block_message_type;
+         msg.data.reserve( opt_block->size() + sizeof( block_id_type ) );
+         msg.data.insert( msg.data.end(), opt_block->data(), opt_block->data() + opt_block->size() );
+         auto packed_id = fc::raw::pack_to_vector( id.item_hash );
+         msg.data.insert( msg.data.end(), packed_id.begin(), packed_id.end() );
+         msg.size = msg.data.size();
+         return msg;
       });
    }
    return chain.db().with_read_lock( [&]()
@@ -494,8 +631,8 @@ fc::time_point_sec p2p_plugin_impl::get_block_time( const graphene::net::item_ha
    {
       return chain.db().with_read_lock( [&]()
       {
-         auto opt_block = chain.db().fetch_block_by_id( block_id );
-         if( opt_block.valid() ) return opt_block->timestamp;
+         auto opt_block = chain.db().fetch_block_view_by_id( block_id );
+         if( opt_block.valid() ) return opt_block->header().timestamp;
          return fc::time_point_sec::min();
       });
    } FC_CAPTURE_AND_RETHROW( (block_id) )
@@ -519,6 +656,41 @@ void p2p_plugin_impl::error_encountered( const string& message, const fc::oexcep
    // notify GUI or something cool
 }
 
+uint32_t p2p_plugin_impl::get_block_log_segment( uint32_t first_block_num, uint32_t max_bytes, std::vector< char >& data, uint64_t& first_block_position )
+{ try {
+   // The block log locks itself, readers of the chain state are not held up
+   return chain.db().read_raw_block_log( first_block_num, max_bytes, data, first_block_position );
+} FC_CAPTURE_AND_RETHROW( (first_block_num)(max_bytes) ) }
+
+uint32_t p2p_plugin_impl::handle_block_log_segment( const graphene::net::block_log_segment_message& segment )
+{ try {
+   if( running.load() )
+   {
+      shutdown_helper helper(*this, activeHandleBlock, handleBlockFinished);
+
+      std::vector< signed_block > blocks = bears::chain::block_log::unpack_raw_blocks( segment.data, segment.first_block_position );
+      FC_ASSERT( blocks.size() == segment.block_count, "Block log segment does not hold the number of blocks it claims",
+         ("blocks", blocks.size())("block_count", segment.block_count) );
+      FC_ASSERT( blocks.front().block_num() == segment.first_block_num, "Block log segment does not start at the block it claims",
+         ("block_num", blocks.front().block_num())("first_block_num", segment.first_block_num) );
+
+      uint32_t head_block_num = chain.import_irreversible_blocks( blocks );
+
+      if( head_block_num / 100000 != ( segment.first_block_num - 1 ) / 100000 )
+         ilog( "Bootstrapping from block log --- Imported block: #${n} time: ${t}",
+            ("n", head_block_num)("t", blocks.back().timestamp) );
+
+      return head_block_num;
+   }
+   else
+   {
+      ilog("Block log segment ignored due to started p2p_plugin shutdown");
+      if(handleBlockFinished.second.valid() == false)
+         handleBlockFinished.first.set_value();
+      FC_THROW("Preventing further processing of ignored block log segment...");
+   }
+} FC_CAPTURE_AND_RETHROW( (segment.first_block_num)(segment.block_count) ) }
+
 fc::time_point_sec p2p_plugin_impl::get_blockchain_now()
 { try {
    return fc::time_point::now();
@@ -555,8 +727,12 @@ void p2p_plugin::set_program_options( bpo::options_description& cli, bpo::option
    cfg.add_options()
       ("p2p-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:9876"), "The local IP address and port to listen for incoming connections.")
       ("p2p-max-connections", bpo::value<uint32_t>(), "Maxmimum number of incoming connections on P2P endpoint.")
+      ("p2p-transaction-precheck-threads", bpo::value<uint32_t>()->default_value( 2 ), "Number of threads checking received transactions before they are pushed to the chain, 0 checks them on the P2P thread.")
+      ("p2p-io-threads", bpo::value<uint32_t>(), "Number of threads reading, writing, encrypting and framing P2P messages, 0 does it on the P2P thread. (Default: 2)")
       ("seed-node", bpo::value<vector<string>>()->composing(), "The IP address and port of a remote peer to sync with. Deprecated in favor of p2p-seed-node.")
       ("p2p-seed-node", bpo::value<vector<string>>()->composing()->default_value( default_seeds, seed_ss.str() ), "The IP address and port of a remote peer to sync with.")
+      ("p2p-serve-block-log", bpo::value<bool>()->default_value( false ), "Send segments of the block log to peers bootstrapping from this node.")
+      ("p2p-block-log-bootstrap-peer", bpo::value<string>(), "The IP address and port of a trusted peer serving its block log. Its irreversible blocks are imported before syncing.")
       ("p2p-parameters", bpo::value<string>(), ("P2P network parameters. (Default: " + fc::json::to_string(graphene::net::node_configuration()) + " )").c_str() )
       ;
    cli.add_options()
@@ -577,6 +753,11 @@ void p2p_plugin::plugin_initialize(const boost::program_options::variables_map&
    if( options.count( "p2p-max-connections" ) )
       my->max_connections = options.at( "p2p-max-connections" ).as< uint32_t >();
 
+   if( options.count( "p2p-io-threads" ) )
+      my->io_threads = options.at( "p2p-io-threads" ).as< uint32_t >();
+
+   my->precheck_thread_count = options.at( "p2p-transaction-precheck-threads" ).as< uint32_t >();
+
    if( options.count( "seed-node" ) || options.count( "p2p-seed-node" ) )
    {
       vector< string > seeds;
@@ -618,6 +799,16 @@ void p2p_plugin::plugin_initialize(const boost::program_options::variables_map&
       }
    }
 
+   my->serve_block_log = options.at( "p2p-serve-block-log" ).as< bool >();
+
+   if( options.count( "p2p-block-log-bootstrap-peer" ) )
+   {
+      string endpoint_string = options.at( "p2p-block-log-bootstrap-peer" ).as< string >();
+      std::vector<fc::ip::endpoint> endpoints = detail::resolve_string_to_ip_endpoints( endpoint_string );
+      FC_ASSERT( endpoints.size(), "Could not resolve block log bootstrap peer ${endpoint}", ("endpoint", endpoint_string) );
+      my->block_log_bootstrap_peer = endpoints.front();
+   }
+
    my->force_validate = options.at( "p2p-force-validate" ).as< bool >();
 
    if( !my->force_validate && options.at( "force-validate" ).as< bool >() )
@@ -631,10 +822,23 @@ void p2p_plugin::plugin_initialize(const boost::program_options::variables_map&
       fc::variant var = fc::json::from_string( options.at("p2p-parameters").as<string>(), fc::json::strict_parser );
       my->config = var.get_object();
    }
+
+   my->post_apply_block_conn = my->chain.db().add_post_apply_block_handler( [&]( const bears::chain::block_notification& note )
+   {
+      my->on_post_apply_block( note );
+   }, *this );
 }
 
 void p2p_plugin::plugin_startup()
 {
+   my->chain.db().with_read_lock( [&]()
+   {
+      my->max_transaction_size.store( my->chain.db().get_dynamic_global_properties().maximum_block_size - 256 );
+   });
+
+   for( uint32_t i = 0; i < my->precheck_thread_count; ++i )
+      my->precheck_threads.push_back( std::make_shared< fc::thread >( "p2p precheck " + std::to_string( i ) ) );
+
    my->p2p_thread.async( [this]
    {
       my->node.reset(new graphene::net::node(my->user_agent));
@@ -669,6 +873,32 @@ void p2p_plugin::plugin_startup()
          my->config.set( "maximum_number_of_connections", fc::variant( my->max_connections ) );
       }
 
+      if( my->io_threads )
+      {
+         if( my->config.find( "io_threads" ) != my->config.end() )
+            ilog( "Overriding advanded_node_parameters[ \"io_threads\" ] with ${threads}", ("threads", *my->io_threads) );
+
+         my->config.set( "io_threads", fc::variant( *my->io_threads ) );
+      }
+
+      if( my->serve_block_log )
+         my->config.set( "serve_block_log", fc::variant( true ) );
+
+      if( my->block_log_bootstrap_peer )
+      {
+         my->config.set( "block_log_bootstrap_peer", fc::variant( *my->block_log_bootstrap_peer ) );
+
+         try
+         {
+            ilog( "P2P bootstrapping from the block log of ${ep}", ("ep", *my->block_log_bootstrap_peer) );
+            my->node->add_node( *my->block_log_bootstrap_peer );
+            my->node->connect_to_endpoint( *my->block_log_bootstrap_peer );
+         }
+         catch( graphene::net::already_connected_to_requested_peer& )
+         {
+         }
+      }
+
       my->node->set_advanced_node_parameters( my->config );
       my->node->listen_to_p2p_network();
       my->node->connect_to_p2p_network();
@@ -741,6 +971,7 @@ void p2p_plugin::plugin_shutdown() {
    while(bfState != std::future_status::ready && tfState != std::future_status::ready);
 
    ilog("P2P Plugin: checking handle_block and handle_transaction activity");
+   bears::chain::util::disconnect_signal( my->post_apply_block_conn );
    my->node->close();
    fc::promise<void>::ptr quitDone(new fc::promise<void>("P2P thread quit"));
    my->p2p_thread.quit(quitDone.get());
@@ -748,6 +979,10 @@ void p2p_plugin::plugin_shutdown() {
    quitDone->wait();
    ilog("p2p_thread quit done");
    my->node.reset();
+
+   for( const auto& thread : my->precheck_threads )
+      thread->quit();
+   my->precheck_threads.clear();
 }
 
 void p2p_plugin::broadcast_block( const bears::protocol::signed_block& block )
@@ -83,7 +83,7 @@ typedef multi_index_container<
    indexed_by<
       ordered_unique< tag< by_id >, member< rc_resource_param_object, rc_resource_param_object::id_type, &rc_resource_param_object::id > >
    >,
-   allocator< rc_resource_param_object >
+   node_allocator< rc_resource_param_object >
 > rc_resource_param_index;
 
 typedef multi_index_container<
@@ -91,7 +91,7 @@ typedef multi_index_container<
    indexed_by<
       ordered_unique< tag< by_id >, member< rc_pool_object, rc_pool_object::id_type, &rc_pool_object::id > >
    >,
-   allocator< rc_pool_object >
+   node_allocator< rc_pool_object >
 > rc_pool_index;
 
 typedef multi_index_container<
@@ -100,7 +100,7 @@ typedef multi_index_container<
       ordered_unique< tag< by_id >, member< rc_account_object, rc_account_object::id_type, &rc_account_object::id > >,
       ordered_unique< tag< by_name >, member< rc_account_object, account_name_type, &rc_account_object::account > >
    >,
-   allocator< rc_account_object >
+   node_allocator< rc_account_object >
 > rc_account_index;
 
 } } } // bears::plugins::rc
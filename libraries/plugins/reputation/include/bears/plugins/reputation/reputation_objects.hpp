@@ -49,7 +49,7 @@ typedef multi_index_container<
       ordered_unique< tag< by_id >, member< reputation_object, reputation_id_type, &reputation_object::id > >,
       ordered_unique< tag< by_account >, member< reputation_object, account_name_type, &reputation_object::account > >
    >,
-   allocator< reputation_object >
+   node_allocator< reputation_object >
 > reputation_index;
 
 
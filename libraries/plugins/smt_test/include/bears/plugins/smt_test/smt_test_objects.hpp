@@ -54,7 +54,7 @@ typedef multi_index_container<
          >
       >
    >,
-   allocator< smt_token_object >
+   node_allocator< smt_token_object >
 > smt_token_index;
 
 } } } // bears::plugins::smt_test
@@ -210,7 +210,7 @@ typedef multi_index_container<
             composite_key_compare< std::less<tag_name_type>, std::less< bool >,std::greater< int64_t >, std::less< tag_id_type > >
       >
    >,
-   allocator< tag_object >
+   node_allocator< tag_object >
 > tag_index;
 
 /**
@@ -273,7 +273,7 @@ typedef multi_index_container<
          composite_key_compare<  std::greater< fc::uint128  >, std::less< tag_name_type > >
       >
   >,
-  allocator< tag_stats_object >
+  node_allocator< tag_stats_object >
 > tag_stats_index;
 
 
@@ -108,7 +108,7 @@ typedef multi_index_container <
          >
       >
    >,
-   allocator< account_bandwidth_object >
+   node_allocator< account_bandwidth_object >
 > account_bandwidth_index;
 
 struct by_account;
@@ -119,7 +119,7 @@ typedef multi_index_container <
       ordered_unique< tag< by_id >,
          member< reserve_ratio_object, reserve_ratio_id_type, &reserve_ratio_object::id > >
    >,
-   allocator< reserve_ratio_object >
+   node_allocator< reserve_ratio_object >
 > reserve_ratio_index;
 
 } } } // bears::plugins::witness
@@ -139,7 +139,8 @@ namespace detail {
       }
    };
 
-   void check_memo( const string& memo, const chain::account_object& account, const account_authority_object& auth )
+   void check_memo( const string& memo, const chain::account_object& account, const account_authority_object& auth,
+      const chain::account_metadata_object& meta )
    {
       vector< public_key_type > keys;
 
@@ -186,7 +187,7 @@ namespace detail {
                "Detected private posting key in memo field. You should change your posting keys." );
       }
 
-      const auto& memo_key = account.memo_key;
+      const auto& memo_key = meta.memo_key;
       for( auto& key : keys )
          BEARS_ASSERT( memo_key != key,  plugin_exception,
             "Detected private memo key in memo field. You should change your memo key." );
@@ -233,7 +234,8 @@ namespace detail {
          if( o.memo.length() > 0 )
             check_memo( o.memo,
                         _db.get< chain::account_object, chain::by_name >( o.from ),
-                        _db.get< account_authority_object, chain::by_account >( o.from ) );
+                        _db.get< account_authority_object, chain::by_account >( o.from ),
+                        _db.get< chain::account_metadata_object, chain::by_account >( o.from ) );
       }
 
       void operator()( const transfer_to_savings_operation& o )const
@@ -241,7 +243,8 @@ namespace detail {
          if( o.memo.length() > 0 )
             check_memo( o.memo,
                         _db.get< chain::account_object, chain::by_name >( o.from ),
-                        _db.get< account_authority_object, chain::by_account >( o.from ) );
+                        _db.get< account_authority_object, chain::by_account >( o.from ),
+                        _db.get< chain::account_metadata_object, chain::by_account >( o.from ) );
       }
 
       void operator()( const transfer_from_savings_operation& o )const
@@ -249,7 +252,8 @@ namespace detail {
          if( o.memo.length() > 0 )
             check_memo( o.memo,
                         _db.get< chain::account_object, chain::by_name >( o.from ),
-                        _db.get< account_authority_object, chain::by_account >( o.from ) );
+                        _db.get< account_authority_object, chain::by_account >( o.from ),
+                        _db.get< chain::account_metadata_object, chain::by_account >( o.from ) );
       }
    };
 
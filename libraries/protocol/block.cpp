@@ -46,18 +46,82 @@ namespace bears { namespace protocol {
 
       vector<digest_type> ids;
       ids.resize( transactions.size() );
+
+      // Memoized transactions already know their digest, hash the rest as one batch
+      vector< vector< char > > packed;
+      vector< const char* > messages;
+      vector< uint32_t > sizes;
+      vector< uint32_t > positions;
+
       for( uint32_t i = 0; i < transactions.size(); ++i )
-         ids[i] = transactions[i].merkle_digest();
+      {
+         if( transactions[i].is_memoized() )
+         {
+            ids[i] = transactions[i].merkle_digest();
+            continue;
+         }
+
+         packed.push_back( fc::raw::pack_to_vector( transactions[i] ) );
+         positions.push_back( i );
+      }
+
+      if( packed.size() )
+      {
+         messages.reserve( packed.size() );
+         sizes.reserve( packed.size() );
+         for( const auto& p : packed )
+         {
+            messages.push_back( p.data() );
+            sizes.push_back( p.size() );
+         }
+
+         vector< digest_type > digests( packed.size() );
+         digest_type::hash_batch( messages.data(), sizes.data(), digests.data(), digests.size() );
+         for( uint32_t i = 0; i < positions.size(); ++i )
+            ids[ positions[i] ] = digests[i];
+      }
+
+      return merkle_root_from_digests( ids );
+   }
+
+   void signed_block::memoize( const chain_id_type& chain_id )const
+   {
+      for( const auto& trx : transactions )
+         trx.memoize( chain_id );
+   }
+
+   checksum_type merkle_root_from_digests( vector< digest_type >& ids )
+   {
+      if( ids.size() == 0 )
+         return checksum_type();
+
+      static_assert( sizeof( digest_type ) == 32, "digest pairs are hashed straight from the vector" );
+
+      vector< const char* > pairs;
+      vector< uint32_t > sizes;
+      vector< digest_type > level;
 
       vector<digest_type>::size_type current_number_of_hashes = ids.size();
       while( current_number_of_hashes > 1 )
       {
-         // hash ID's in pairs
+         // hash ID's in pairs, a packed pair is the two digests back to back so every
+         // pair of the level is hashed as one batch straight from the vector
          uint32_t i_max = current_number_of_hashes - (current_number_of_hashes&1);
          uint32_t k = 0;
 
+         pairs.clear();
+         sizes.clear();
          for( uint32_t i = 0; i < i_max; i += 2 )
-            ids[k++] = digest_type::hash( std::make_pair( ids[i], ids[i+1] ) );
+         {
+            pairs.push_back( ids[i].data() );
+            sizes.push_back( 2 * sizeof( digest_type ) );
+         }
+
+         level.resize( pairs.size() );
+         digest_type::hash_batch( pairs.data(), sizes.data(), level.data(), level.size() );
+
+         for( ; k < level.size(); ++k )
+            ids[k] = level[k];
 
          if( current_number_of_hashes&1 )
             ids[k++] = ids[i_max];
@@ -7,9 +7,16 @@ namespace bears { namespace protocol {
    struct signed_block : public signed_block_header
    {
       checksum_type calculate_merkle_root()const;
+
+      /// Memoizes the encoding of every transaction, see signed_transaction::memoize()
+      void memoize( const chain_id_type& chain_id )const;
+
       vector<signed_transaction> transactions;
    };
 
+   /// Reduces transaction merkle digests to the block merkle root. The vector is used as scratch space.
+   checksum_type merkle_root_from_digests( vector< digest_type >& ids );
+
 } } // bears::protocol
 
 FC_REFLECT_DERIVED( bears::protocol::signed_block, (bears::protocol::signed_block_header), (transactions) )
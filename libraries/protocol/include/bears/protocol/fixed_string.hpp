@@ -72,7 +72,7 @@ class fixed_string_impl
       typedef _Storage Storage;
 
       fixed_string_impl() = default;
-      fixed_string_impl( const fixed_string_impl& c ) : data( c.data ){}
+      fixed_string_impl( const fixed_string_impl& c ) = default;
       fixed_string_impl( const char* str ) : fixed_string_impl( std::string( str ) ) {}
       fixed_string_impl( const std::string& str )
       {
@@ -103,11 +103,7 @@ class fixed_string_impl
 
       uint32_t length()const { return size(); }
 
-      fixed_string_impl& operator = ( const fixed_string_impl& str )
-      {
-         data = str.data;
-         return *this;
-      }
+      fixed_string_impl& operator = ( const fixed_string_impl& str ) = default;
 
       fixed_string_impl& operator = ( const char* str )
       {
@@ -0,0 +1,92 @@
+#pragma once
+#include <bears/protocol/transaction.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace bears { namespace protocol {
+
+   /**
+    *  Bounded cache of public keys recovered from transaction signatures, keyed by the signature
+    *  digest and the signature itself.
+    *
+    *  A transaction is signature checked when it is first pushed, every time the pending
+    *  transactions are re-applied, when a block is generated and again when its block arrives.
+    *  The recovered keys only depend on the key of the cache, so all but the first check can skip
+    *  the elliptic curve math.
+    *
+    *  The cache is split into independently locked shards. Each shard keeps two generations of
+    *  entries, when the current generation is full the previous one is dropped and the current one
+    *  takes its place. Hits in the previous generation are moved back to the current one.
+    */
+   class signature_cache
+   {
+      public:
+         struct stats_type
+         {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t size = 0;
+         };
+
+         static signature_cache& instance();
+
+         /** Maximum number of cached keys, 0 disables the cache. Clears the cache. */
+         void        set_capacity( size_t entries );
+         size_t      capacity()const { return _capacity; }
+
+         bool        get( const digest_type& digest, const signature_type& sig, public_key_type& key );
+         void        put( const digest_type& digest, const signature_type& sig, const public_key_type& key );
+         void        clear();
+
+         stats_type  get_stats()const;
+
+         /**
+          *  Recovers and caches the keys of every signature of the given transactions that is not
+          *  cached yet, in one batch spread over the fc::ecc recovery threads. Signatures that fail
+          *  to recover are left for the regular signature check to report.
+          */
+         void        prefetch( const vector< signed_transaction >& trxs, const chain_id_type& chain_id );
+
+      private:
+         signature_cache();
+
+         struct cache_key
+         {
+            digest_type    digest;
+            signature_type sig;
+
+            bool operator==( const cache_key& other )const
+            {
+               return digest == other.digest && sig == other.sig;
+            }
+         };
+
+         struct cache_key_hash
+         {
+            size_t operator()( const cache_key& k )const;
+         };
+
+         typedef std::unordered_map< cache_key, public_key_type, cache_key_hash > generation_type;
+
+         struct shard
+         {
+            mutable std::mutex   mutex;
+            generation_type      current;
+            generation_type      previous;
+         };
+
+         static const uint32_t num_shards = 16;
+
+         shard&      get_shard( const cache_key& k );
+         bool        lookup( const cache_key& k, public_key_type& key );
+         void        insert( shard& s, const cache_key& k, const public_key_type& key );
+
+         shard                     _shards[ num_shards ];
+         std::atomic< size_t >     _capacity;
+         std::atomic< uint64_t >   _hits{ 0 };
+         std::atomic< uint64_t >   _misses{ 0 };
+   };
+
+} } // bears::protocol
@@ -0,0 +1,62 @@
+#pragma once
+#include <bears/protocol/block.hpp>
+
+#include <memory>
+
+namespace bears { namespace protocol {
+
+   /**
+    *  A read-only view over a packed signed_block.
+    *
+    *  The header is decoded and the transactions are located inside the buffer when the view is
+    *  constructed, the view is not changed afterwards and can be read from several threads.
+    *  Transactions stay packed and can be decoded one at a time on demand. Block ids,
+    *  transaction ids and merkle digests are hashed straight from the packed bytes, so consumers
+    *  that only need ids or the header never materialize the transaction vector.
+    */
+   class signed_block_view
+   {
+      public:
+         typedef std::shared_ptr< const std::vector< char > > buffer_ptr;
+
+         signed_block_view() {}
+         explicit signed_block_view( std::vector< char >&& packed_block );
+         explicit signed_block_view( buffer_ptr packed_block );
+
+         const signed_block_header& header()const { return _header; }
+         block_id_type              id()const;
+         uint32_t                   block_num()const { return _header.block_num(); }
+
+         uint32_t                   transaction_count()const { return _transaction_count; }
+         signed_transaction         transaction( uint32_t idx )const;
+         transaction_id_type        transaction_id( uint32_t idx )const;
+         vector< transaction_id_type > transaction_ids()const;
+         digest_type                transaction_merkle_digest( uint32_t idx )const;
+         checksum_type              calculate_merkle_root()const;
+
+         /** Decodes the complete block. */
+         signed_block               unpack()const;
+
+         const char*                data()const { return _packed ? _packed->data() : nullptr; }
+         size_t                     size()const { return _packed ? _packed->size() : 0; }
+         const buffer_ptr&          buffer()const { return _packed; }
+
+      private:
+         struct packed_range
+         {
+            uint32_t begin      = 0;
+            uint32_t signatures = 0;
+            uint32_t end        = 0;
+         };
+
+         void init();
+         const packed_range& range( uint32_t idx )const;
+
+         buffer_ptr                             _packed;
+         signed_block_header                    _header;
+         uint32_t                               _header_size = 0;
+         uint32_t                               _transaction_count = 0;
+         std::vector< packed_range >            _ranges;
+   };
+
+} } // bears::protocol
@@ -9,6 +9,20 @@ namespace bears { namespace protocol {
 
 using fc::ecc::canonical_signature_type;
 
+   /**
+    *  Memoized encoding of a signed transaction. It is never modified once built, so it can be
+    *  shared between copies of a transaction and read from several threads.
+    */
+   struct transaction_cache
+   {
+      vector< char >    packed;              ///< packed signed_transaction
+      uint32_t          signatures_pos = 0;  ///< size of the packed transaction without signatures
+      digest_type       digest;
+      digest_type       merkle_digest;
+      chain_id_type     chain_id;
+      digest_type       sig_digest;
+   };
+
    struct transaction
    {
       uint16_t           ref_block_num    = 0;
@@ -48,12 +62,26 @@ using fc::ecc::canonical_signature_type;
                                      flat_set< account_name_type >& owner,
                                      flat_set< account_name_type >& posting,
                                      vector< authority >& other )const;
+
+      /**
+       *  Drops the memoized encoding, see signed_transaction::memoize(). sign(), set_expiration(),
+       *  set_reference_block() and clear() call this. The memoized encoding is invalid after any
+       *  other change to a memoized transaction, such as assigning expiration or adding to
+       *  operations or signatures directly, and the code making it must call this. Debug builds
+       *  assert that the encoding still matches the fields whenever it is used.
+       */
+      void invalidate_cache()const { _cache.reset(); }
+      bool is_memoized()const { return _cache != nullptr; }
+
+   protected:
+      /// Memoized encoding, nothing but invalidate_cache() notices direct changes to the fields
+      mutable std::shared_ptr< const transaction_cache > _cache;
    };
 
    struct signed_transaction : public transaction
    {
       signed_transaction( const transaction& trx = transaction() )
-         : transaction(trx){}
+         : transaction(trx){ invalidate_cache(); }
 
       const signature_type& sign( const private_key_type& key, const chain_id_type& chain_id, canonical_signature_type canon_type/* = fc::ecc::fc_canonical*/ );
 
@@ -100,7 +128,21 @@ using fc::ecc::canonical_signature_type;
 
       digest_type merkle_digest()const;
 
-      void clear() { operations.clear(); signatures.clear(); }
+      /**
+       *  Opt-in memoization of the packed bytes, id, merkle digest and signature digest.
+       *  Only memoize transactions that will not be edited afterwards, e.g. ones received
+       *  from the network or owned by the chain. The cache travels with copies of the
+       *  transaction, so the encoding is not repacked and rehashed on every call.
+       */
+      void memoize( const chain_id_type& chain_id )const;
+
+      /// Packed size, served from the memoized encoding when there is one
+      size_t packed_size()const;
+
+      /// Packed bytes, served from the memoized encoding when there is one
+      vector< char > pack()const;
+
+      void clear() { operations.clear(); signatures.clear(); invalidate_cache(); }
    };
 
    struct annotated_signed_transaction : public signed_transaction {
@@ -114,6 +156,9 @@ using fc::ecc::canonical_signature_type;
    };
 
 
+   /// Ids of many transactions, the transactions that are not memoized are hashed as one batch
+   vector< transaction_id_type > calculate_transaction_ids( const vector< signed_transaction >& trxs );
+
    /// @} transactions group
 
 } } // bears::protocol
@@ -0,0 +1,154 @@
+#include <bears/protocol/signature_cache.hpp>
+
+#include <fc/crypto/elliptic.hpp>
+
+namespace bears { namespace protocol {
+
+   signature_cache& signature_cache::instance()
+   {
+      static signature_cache cache;
+      return cache;
+   }
+
+   signature_cache::signature_cache() : _capacity( 50000 ) {}
+
+   size_t signature_cache::cache_key_hash::operator()( const cache_key& k )const
+   {
+      // Both the digest and the signature are uniformly distributed, a few of their bytes are enough
+      uint64_t d, s;
+      memcpy( &d, k.digest.data(), sizeof( d ) );
+      memcpy( &s, k.sig.begin() + 1, sizeof( s ) );
+      return size_t( d ^ ( s * 0x9E3779B97F4A7C15ull ) );
+   }
+
+   signature_cache::shard& signature_cache::get_shard( const cache_key& k )
+   {
+      return _shards[ uint8_t( k.sig.data[32] ) % num_shards ];
+   }
+
+   void signature_cache::set_capacity( size_t entries )
+   {
+      _capacity = entries;
+      clear();
+   }
+
+   void signature_cache::clear()
+   {
+      for( auto& s : _shards )
+      {
+         std::lock_guard< std::mutex > lock( s.mutex );
+         s.current.clear();
+         s.previous.clear();
+      }
+   }
+
+   bool signature_cache::lookup( const cache_key& k, public_key_type& key )
+   {
+      auto& s = get_shard( k );
+      std::lock_guard< std::mutex > lock( s.mutex );
+
+      auto itr = s.current.find( k );
+      if( itr != s.current.end() )
+      {
+         key = itr->second;
+         return true;
+      }
+
+      itr = s.previous.find( k );
+      if( itr != s.previous.end() )
+      {
+         key = itr->second;
+         s.previous.erase( itr );
+         insert( s, k, key );
+         return true;
+      }
+
+      return false;
+   }
+
+   void signature_cache::insert( shard& s, const cache_key& k, const public_key_type& key )
+   {
+      size_t generation_size = std::max< size_t >( _capacity / ( 2 * num_shards ), 1 );
+      if( s.current.size() >= generation_size )
+      {
+         s.previous = std::move( s.current );
+         s.current = generation_type();
+      }
+
+      s.current[ k ] = key;
+   }
+
+   bool signature_cache::get( const digest_type& digest, const signature_type& sig, public_key_type& key )
+   {
+      if( _capacity == 0 )
+         return false;
+
+      if( lookup( cache_key{ digest, sig }, key ) )
+      {
+         ++_hits;
+         return true;
+      }
+
+      ++_misses;
+      return false;
+   }
+
+   void signature_cache::put( const digest_type& digest, const signature_type& sig, const public_key_type& key )
+   {
+      if( _capacity == 0 )
+         return;
+
+      cache_key k{ digest, sig };
+      auto& s = get_shard( k );
+      std::lock_guard< std::mutex > lock( s.mutex );
+      insert( s, k, key );
+   }
+
+   signature_cache::stats_type signature_cache::get_stats()const
+   {
+      stats_type result;
+      result.hits = _hits;
+      result.misses = _misses;
+      for( auto& s : _shards )
+      {
+         std::lock_guard< std::mutex > lock( s.mutex );
+         result.size += s.current.size() + s.previous.size();
+      }
+      return result;
+   }
+
+   void signature_cache::prefetch( const vector< signed_transaction >& trxs, const chain_id_type& chain_id )
+   {
+      // Without recovery threads the keys are recovered just as fast by the signature check itself
+      if( _capacity == 0 || fc::ecc::get_recovery_threads() == 0 )
+         return;
+
+      vector< std::pair< signature_type, digest_type > > missing;
+      for( const auto& trx : trxs )
+      {
+         if( trx.signatures.empty() )
+            continue;
+
+         auto d = trx.sig_digest( chain_id );
+         for( const auto& sig : trx.signatures )
+         {
+            public_key_type key;
+            if( !lookup( cache_key{ d, sig }, key ) )
+               missing.emplace_back( sig, d );
+         }
+      }
+
+      if( missing.empty() )
+         return;
+
+      try
+      {
+         // Canonicity depends on the hardfork and is checked again when the cached key is used
+         auto keys = fc::ecc::recover_public_keys( missing, fc::ecc::non_canonical );
+         for( size_t i = 0; i < keys.size(); ++i )
+            put( missing[i].second, missing[i].first, keys[i] );
+      }
+      catch( const fc::exception& ) {}
+   }
+
+} } // bears::protocol
@@ -0,0 +1,144 @@
+#include <bears/protocol/signed_block_view.hpp>
+#include <bears/protocol/exceptions.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/bitutil.hpp>
+
+namespace bears { namespace protocol {
+
+   signed_block_view::signed_block_view( std::vector< char >&& packed_block )
+      : _packed( std::make_shared< const std::vector< char > >( std::move( packed_block ) ) )
+   {
+      init();
+   }
+
+   signed_block_view::signed_block_view( buffer_ptr packed_block )
+      : _packed( std::move( packed_block ) )
+   {
+      init();
+   }
+
+   void signed_block_view::init()
+   { try {
+      FC_ASSERT( _packed && _packed->size() > 0, "Cannot view an empty block" );
+
+      fc::datastream< const char* > ds( _packed->data(), _packed->size() );
+      fc::raw::unpack( ds, _header );
+      _header_size = ds.tellp();
+
+      fc::unsigned_int count;
+      fc::raw::unpack( ds, count );
+      _transaction_count = count.value;
+
+      // Each packed transaction occupies at least a few bytes, reject obviously bogus counts early
+      FC_ASSERT( _transaction_count <= ds.remaining(), "Transaction count exceeds packed block size",
+         ("count", _transaction_count)("remaining", ds.remaining()) );
+
+      // Packed transactions carry no length, walk them once to find their boundaries so the view
+      // is never written after construction. A single scratch transaction is reused, nothing
+      // decoded here is handed out to callers.
+      _ranges.reserve( _transaction_count );
+      signed_transaction scratch;
+
+      for( uint32_t i = 0; i < _transaction_count; ++i )
+      {
+         packed_range r;
+         r.begin = ds.tellp();
+         fc::raw::unpack( ds, static_cast< protocol::transaction& >( scratch ) );
+         r.signatures = ds.tellp();
+         fc::raw::unpack( ds, scratch.signatures );
+         r.end = ds.tellp();
+         _ranges.push_back( r );
+      }
+   } FC_CAPTURE_AND_RETHROW() }
+
+   block_id_type signed_block_view::id()const
+   {
+      auto tmp = fc::sha224::hash( data(), _header_size );
+      tmp._hash[0] = fc::endian_reverse_u32( block_num() ); // store the block num in the ID, same as signed_block_header::id()
+      block_id_type result;
+      memcpy( result._hash, tmp._hash, std::min( sizeof( result ), sizeof( tmp ) ) );
+      return result;
+   }
+
+   const signed_block_view::packed_range& signed_block_view::range( uint32_t idx )const
+   {
+      FC_ASSERT( idx < _transaction_count, "Transaction index out of range",
+         ("idx", idx)("count", _transaction_count) );
+
+      return _ranges[ idx ];
+   }
+
+   signed_transaction signed_block_view::transaction( uint32_t idx )const
+   {
+      const auto& r = range( idx );
+      signed_transaction trx;
+      fc::datastream< const char* > ds( data() + r.begin, r.end - r.begin );
+      fc::raw::unpack( ds, trx );
+      return trx;
+   }
+
+   transaction_id_type signed_block_view::transaction_id( uint32_t idx )const
+   {
+      const auto& r = range( idx );
+      auto h = digest_type::hash( data() + r.begin, r.signatures - r.begin );
+      transaction_id_type result;
+      memcpy( result._hash, h._hash, std::min( sizeof( result ), sizeof( h ) ) );
+      return result;
+   }
+
+   vector< transaction_id_type > signed_block_view::transaction_ids()const
+   {
+      vector< const char* > messages( _transaction_count );
+      vector< uint32_t > sizes( _transaction_count );
+      for( uint32_t i = 0; i < _transaction_count; ++i )
+      {
+         const auto& r = range( i );
+         messages[i] = data() + r.begin;
+         sizes[i] = r.signatures - r.begin;
+      }
+
+      vector< digest_type > digests( _transaction_count );
+      digest_type::hash_batch( messages.data(), sizes.data(), digests.data(), digests.size() );
+
+      vector< transaction_id_type > result( _transaction_count );
+      for( uint32_t i = 0; i < _transaction_count; ++i )
+         memcpy( result[i]._hash, digests[i]._hash, std::min( sizeof( result[i] ), sizeof( digests[i] ) ) );
+      return result;
+   }
+
+   digest_type signed_block_view::transaction_merkle_digest( uint32_t idx )const
+   {
+      const auto& r = range( idx );
+      return digest_type::hash( data() + r.begin, r.end - r.begin );
+   }
+
+   checksum_type signed_block_view::calculate_merkle_root()const
+   {
+      if( _transaction_count == 0 )
+         return checksum_type();
+
+      vector< const char* > messages( _transaction_count );
+      vector< uint32_t > sizes( _transaction_count );
+      for( uint32_t i = 0; i < _transaction_count; ++i )
+      {
+         const auto& r = range( i );
+         messages[i] = data() + r.begin;
+         sizes[i] = r.end - r.begin;
+      }
+
+      vector< digest_type > ids( _transaction_count );
+      digest_type::hash_batch( messages.data(), sizes.data(), ids.data(), ids.size() );
+
+      return merkle_root_from_digests( ids );
+   }
+
+   signed_block signed_block_view::unpack()const
+   {
+      signed_block result;
+      if( _packed )
+         fc::raw::unpack_from_vector( *_packed, result );
+      return result;
+   }
+
+} } // bears::protocol
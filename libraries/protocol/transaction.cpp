@@ -1,17 +1,40 @@
 
 #include <bears/protocol/transaction.hpp>
 #include <bears/protocol/transaction_util.hpp>
+#include <bears/protocol/signature_cache.hpp>
 
 #include <fc/io/raw.hpp>
 #include <fc/bitutil.hpp>
 #include <fc/smart_ref_impl.hpp>
 
 #include <algorithm>
+#include <cassert>
 
 namespace bears { namespace protocol {
 
+namespace {
+
+/// A memoized transaction edited without invalidate_cache() serves stale ids and digests, catch it in debug builds
+inline void check_cache( const transaction& trx, const transaction_cache& cache )
+{
+   assert( fc::raw::pack_to_vector( trx ) == vector< char >( cache.packed.begin(), cache.packed.begin() + cache.signatures_pos ) );
+}
+
+inline void check_cache( const signed_transaction& trx, const transaction_cache& cache )
+{
+   assert( fc::raw::pack_to_vector( trx ) == cache.packed );
+}
+
+}
+
 digest_type signed_transaction::merkle_digest()const
 {
+   if( _cache )
+   {
+      check_cache( *this, *_cache );
+      return _cache->merkle_digest;
+   }
+
    digest_type::encoder enc;
    fc::raw::pack( enc, *this );
    return enc.result();
@@ -19,6 +42,12 @@ digest_type signed_transaction::merkle_digest()const
 
 digest_type transaction::digest()const
 {
+   if( _cache )
+   {
+      check_cache( *this, *_cache );
+      return _cache->digest;
+   }
+
    digest_type::encoder enc;
    fc::raw::pack( enc, *this );
    return enc.result();
@@ -26,12 +55,69 @@ digest_type transaction::digest()const
 
 digest_type transaction::sig_digest( const chain_id_type& chain_id )const
 {
+   if( _cache )
+   {
+      check_cache( *this, *_cache );
+      if( _cache->chain_id == chain_id )
+         return _cache->sig_digest;
+
+      digest_type::encoder enc;
+      fc::raw::pack( enc, chain_id );
+      enc.write( _cache->packed.data(), _cache->signatures_pos );
+      return enc.result();
+   }
+
    digest_type::encoder enc;
    fc::raw::pack( enc, chain_id );
    fc::raw::pack( enc, *this );
    return enc.result();
 }
 
+void signed_transaction::memoize( const chain_id_type& chain_id )const
+{
+   if( _cache && _cache->chain_id == chain_id )
+      return;
+
+   auto cache = std::make_shared< transaction_cache >();
+   cache->packed = fc::raw::pack_to_vector( static_cast< const transaction& >( *this ) );
+   cache->signatures_pos = cache->packed.size();
+   auto packed_signatures = fc::raw::pack_to_vector( signatures );
+   cache->packed.insert( cache->packed.end(), packed_signatures.begin(), packed_signatures.end() );
+
+   cache->digest = digest_type::hash( cache->packed.data(), cache->signatures_pos );
+   cache->merkle_digest = digest_type::hash( cache->packed.data(), cache->packed.size() );
+   cache->chain_id = chain_id;
+
+   digest_type::encoder enc;
+   fc::raw::pack( enc, chain_id );
+   enc.write( cache->packed.data(), cache->signatures_pos );
+   cache->sig_digest = enc.result();
+
+   _cache = std::move( cache );
+}
+
+size_t signed_transaction::packed_size()const
+{
+   if( _cache )
+   {
+      check_cache( *this, *_cache );
+      return _cache->packed.size();
+   }
+
+   return fc::raw::pack_size( *this );
+}
+
+vector< char > signed_transaction::pack()const
+{
+   if( _cache )
+   {
+      check_cache( *this, *_cache );
+      return _cache->packed;
+   }
+
+   return fc::raw::pack_to_vector( *this );
+}
+
 void transaction::validate() const
 {
    FC_ASSERT( operations.size() > 0, "A transaction must have at least one operation", ("trx",*this) );
@@ -47,30 +133,72 @@ bears::protocol::transaction_id_type bears::protocol::transaction::id() const
    return result;
 }
 
+vector< transaction_id_type > calculate_transaction_ids( const vector< signed_transaction >& trxs )
+{
+   vector< transaction_id_type > result( trxs.size() );
+
+   vector< vector< char > > packed;
+   vector< uint32_t > positions;
+   for( uint32_t i = 0; i < trxs.size(); ++i )
+   {
+      if( trxs[i].is_memoized() )
+         result[i] = trxs[i].id();
+      else
+      {
+         packed.push_back( fc::raw::pack_to_vector( static_cast< const transaction& >( trxs[i] ) ) );
+         positions.push_back( i );
+      }
+   }
+
+   if( packed.empty() )
+      return result;
+
+   vector< const char* > messages;
+   vector< uint32_t > sizes;
+   messages.reserve( packed.size() );
+   sizes.reserve( packed.size() );
+   for( const auto& p : packed )
+   {
+      messages.push_back( p.data() );
+      sizes.push_back( p.size() );
+   }
+
+   vector< digest_type > digests( packed.size() );
+   digest_type::hash_batch( messages.data(), sizes.data(), digests.data(), digests.size() );
+
+   for( uint32_t i = 0; i < positions.size(); ++i )
+   {
+      transaction_id_type& id = result[ positions[i] ];
+      memcpy( id._hash, digests[i]._hash, std::min( sizeof( id ), sizeof( digests[i] ) ) );
+   }
+
+   return result;
+}
+
 const signature_type& bears::protocol::signed_transaction::sign( const private_key_type& key, const chain_id_type& chain_id, canonical_signature_type canon_type )
 {
    digest_type h = sig_digest( chain_id );
    signatures.push_back( key.sign_compact( h, canon_type ) );
+   invalidate_cache();
    return signatures.back();
 }
 
 signature_type bears::protocol::signed_transaction::sign( const private_key_type& key, const chain_id_type& chain_id, canonical_signature_type canon_type )const
 {
-   digest_type::encoder enc;
-   fc::raw::pack( enc, chain_id );
-   fc::raw::pack( enc, *this );
-   return key.sign_compact( enc.result(), canon_type );
+   return key.sign_compact( sig_digest( chain_id ), canon_type );
 }
 
 void transaction::set_expiration( fc::time_point_sec expiration_time )
 {
     expiration = expiration_time;
+    invalidate_cache();
 }
 
 void transaction::set_reference_block( const block_id_type& reference_block )
 {
    ref_block_num = fc::endian_reverse_u32(reference_block._hash[0]);
    ref_block_prefix = reference_block._hash[1];
+   invalidate_cache();
 }
 
 void transaction::get_required_authorities( flat_set< account_name_type >& active,
@@ -85,14 +213,40 @@ void transaction::get_required_authorities( flat_set< account_name_type >& activ
 flat_set<public_key_type> signed_transaction::get_signature_keys( const chain_id_type& chain_id, canonical_signature_type canon_type )const
 { try {
    auto d = sig_digest( chain_id );
+   auto& cache = signature_cache::instance();
    flat_set<public_key_type> result;
-   for( const auto&  sig : signatures )
+   vector< signature_type > missing;
+
+   for( const auto& sig : signatures )
    {
+      public_key_type key;
+      if( !cache.get( d, sig, key ) )
+      {
+         missing.push_back( sig );
+         continue;
+      }
+
+      // The key may have been cached under a different canonical type
+      FC_ASSERT( fc::ecc::public_key::is_canonical( sig, canon_type ), "signature is not canonical" );
       BEARS_ASSERT(
-         result.insert( fc::ecc::public_key( sig, d, canon_type ) ).second,
+         result.insert( key ).second,
          tx_duplicate_sig,
          "Duplicate Signature detected" );
    }
+
+   if( missing.size() )
+   {
+      auto keys = fc::ecc::recover_public_keys( missing, d, canon_type );
+      for( size_t i = 0; i < keys.size(); ++i )
+      {
+         cache.put( d, missing[i], keys[i] );
+         BEARS_ASSERT(
+            result.insert( keys[i] ).second,
+            tx_duplicate_sig,
+            "Duplicate Signature detected" );
+      }
+   }
+
    return result;
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -23,10 +23,12 @@ public:
    struct index_memory_details_t
    {
       index_memory_details_t(std::string&& name, size_t size, size_t i_sizeof,
-         size_t item_add_allocation, size_t add_container_allocation)
+         size_t item_add_allocation, size_t add_container_allocation,
+         size_t reserved = 0, size_t free = 0)
          : index_name(name), index_size(size), item_sizeof(i_sizeof),
            item_additional_allocation(item_add_allocation),
-           additional_container_allocation(add_container_allocation)
+           additional_container_allocation(add_container_allocation),
+           pool_reserved(reserved), pool_free(free)
       {
          total_index_mem_usage = additional_container_allocation;
          total_index_mem_usage += item_additional_allocation;
@@ -40,6 +42,9 @@ public:
       size_t         item_additional_allocation = 0;
       /// Additional memory used for container internal structures (like tree nodes).
       size_t         additional_container_allocation = 0;
+      /// Memory reserved by the node pool of the index and the part of it not held by an item
+      size_t         pool_reserved = 0;
+      size_t         pool_free = 0;
       size_t         total_index_mem_usage = 0;
    };
 
@@ -182,7 +187,7 @@ private:
 
 FC_REFLECT( bears::utilities::benchmark_dumper::index_memory_details_t,
             (index_name)(index_size)(item_sizeof)(item_additional_allocation)
-            (additional_container_allocation)(total_index_mem_usage)
+            (additional_container_allocation)(pool_reserved)(pool_free)(total_index_mem_usage)
           )
 
 FC_REFLECT( bears::utilities::benchmark_dumper::database_object_sizeof_t,
@@ -29,6 +29,15 @@
 
 #include <bears/protocol/protocol.hpp>
 
+#include <bears/chain/account_object.hpp>
+
+#include <chainbase/chainbase.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
 #include <algorithm>
 #include <iostream>
 #include <sstream>
@@ -37,6 +46,68 @@
 
 using namespace bears::protocol;
 
+/**
+ * The account as it is, and account_object and account_metadata_object as one object like the
+ * account before they were split. Both are measured copying whole objects into the undo state
+ * and undoing them from the words a modify changed, so the undo sizes compare the layouts alone.
+ */
+template< bool DeltaUndo >
+struct split_account_object : public chainbase::object< bears::chain::account_object_type, split_account_object< DeltaUndo > >
+{
+   typedef chainbase::oid< split_account_object > id_type;
+
+   template< typename Constructor, typename Allocator >
+   split_account_object( Constructor&& c, chainbase::allocator< Allocator > a )
+      :account( []( bears::chain::account_object& ){}, a )
+   {
+      c( *this );
+   }
+
+   id_type                                  id;
+   bears::chain::account_object             account;
+};
+
+template< bool DeltaUndo >
+struct unsplit_account_object : public chainbase::object< bears::chain::account_object_type, unsplit_account_object< DeltaUndo > >
+{
+   typedef chainbase::oid< unsplit_account_object > id_type;
+
+   template< typename Constructor, typename Allocator >
+   unsplit_account_object( Constructor&& c, chainbase::allocator< Allocator > a )
+      :account( []( bears::chain::account_object& ){}, a ),
+       metadata( []( bears::chain::account_metadata_object& ){}, a )
+   {
+      c( *this );
+   }
+
+   id_type                                  id;
+   bears::chain::account_object             account;
+   bears::chain::account_metadata_object    metadata;
+};
+
+template< typename Object >
+using account_layout_index = boost::multi_index_container<
+   Object,
+   boost::multi_index::indexed_by<
+      boost::multi_index::ordered_unique< boost::multi_index::member< Object, typename Object::id_type, &Object::id > >
+   >,
+   chainbase::allocator< Object >
+>;
+
+namespace chainbase {
+   template< bool DeltaUndo >
+   struct get_index_type< split_account_object< DeltaUndo > > { typedef account_layout_index< split_account_object< DeltaUndo > > type; };
+   template< bool DeltaUndo >
+   struct get_index_type< unsplit_account_object< DeltaUndo > > { typedef account_layout_index< unsplit_account_object< DeltaUndo > > type; };
+
+   template< bool DeltaUndo >
+   struct use_delta_undo< split_account_object< DeltaUndo > > : std::integral_constant< bool, DeltaUndo > {};
+   template< bool DeltaUndo >
+   struct use_delta_undo< unsplit_account_object< DeltaUndo > > : std::integral_constant< bool, DeltaUndo > {};
+}
+
+CHAINBASE_SET_DELTA_UNDO_MEMBERS( unsplit_account_object< true >, (metadata.json_metadata) )
+
 std::vector< fc::variant_object > g_op_types;
 
 template< typename T >
@@ -46,6 +117,38 @@ uint64_t get_wire_size()
    return fc::raw::pack_to_vector( data ).size();
 }
 
+/**
+ * Creates num_objects objects in a new database and returns the shared memory an undo session
+ * holds per object after modifying each of them once
+ */
+template< typename Index, typename Constructor, typename Modifier >
+uint64_t get_undo_size_per_modify( uint32_t num_objects, Constructor&& c, Modifier&& m )
+{
+   typedef typename Index::value_type object_type;
+
+   auto dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+   chainbase::database db;
+   db.open( dir, 0, 1024*1024*512 );
+   db.add_index< Index >();
+
+   std::vector< const object_type* > objects;
+   for( uint32_t i = 0; i < num_objects; ++i )
+      objects.push_back( &db.create< object_type >( [&]( object_type& o ){ c( o, i ); } ) );
+
+   uint64_t undo_size = 0;
+   {
+      auto session = db.start_undo_session();
+      size_t free_memory = db.get_free_memory();
+      for( const auto* o : objects )
+         db.modify( *o, m );
+      undo_size = free_memory - db.get_free_memory();
+   }
+
+   db.close();
+   boost::filesystem::remove_all( dir );
+   return undo_size / num_objects;
+}
+
 struct size_check_type_visitor
 {
    typedef void result_type;
@@ -106,8 +209,41 @@ int main( int argc, char** argv )
       }
       std::cout << "]\n";
       std::cerr << "Size of block header: " << sizeof( block_header ) << " " << fc::raw::pack_size( block_header() ) << "\n";
+
+      // The first modify of an object in an undo session records its old value, keep that small for
+      // the objects most operations modify
+      std::cerr << "Size of account_object: " << sizeof( bears::chain::account_object ) << "\n";
+      std::cerr << "Size of account_metadata_object: " << sizeof( bears::chain::account_metadata_object ) << "\n";
+      std::cerr << "Size of the account before the split: " << sizeof( unsplit_account_object< false > ) << "\n";
+
+      // A balance change, with json_metadata of a typical profile on the unsplit account
+      const uint32_t num_accounts = 10000;
+      const std::string json_metadata( 256, 'x' );
+      auto split_undo_size = []( auto delta_undo )
+      {
+         typedef split_account_object< decltype( delta_undo )::value > object_type;
+         return get_undo_size_per_modify< account_layout_index< object_type > >( num_accounts,
+            []( object_type& a, uint32_t i ) { a.account.name = "account" + std::to_string( i ); },
+            []( object_type& a ) { a.account.balance.amount += 1; } );
+      };
+      auto unsplit_undo_size = [&]( auto delta_undo )
+      {
+         typedef unsplit_account_object< decltype( delta_undo )::value > object_type;
+         return get_undo_size_per_modify< account_layout_index< object_type > >( num_accounts,
+            [&]( object_type& a, uint32_t i )
+            {
+               a.account.name = "account" + std::to_string( i );
+               bears::chain::from_string( a.metadata.json_metadata, json_metadata );
+            },
+            []( object_type& a ) { a.account.balance.amount += 1; } );
+      };
+      std::cerr << "Undo bytes per account modify, copying whole objects: "
+                << split_undo_size( std::false_type() ) << ", before the split: " << unsplit_undo_size( std::false_type() ) << "\n";
+      std::cerr << "Undo bytes per account modify, undoing changed words: "
+                << split_undo_size( std::true_type() ) << ", before the split: " << unsplit_undo_size( std::true_type() ) << "\n";
    }
    catch ( const fc::exception& e ){ edump((e.to_detail_string())); }
+   catch ( const std::exception& e ){ edump((std::string( e.what() ))); }
    idump((sizeof(signed_block)));
    idump((fc::raw::pack_size(signed_block())));
    return 0;
@@ -0,0 +1,500 @@
+/**
+ * Runs a network of graphene::net::node instances in one process, connected over loopback, to
+ * measure the p2p layer without live peers. Each node is backed by a stand-in delegate that keeps
+ * a plain chain of blocks and accepts every block that links and every new transaction, so only
+ * the cost of the network code is measured.
+ *
+ * The benchmark has two phases:
+ *  - sync: node 0 starts with sync_blocks blocks, the other nodes start empty and sync from the
+ *    network. Reports how long it takes until every node has them.
+ *  - live: transactions are injected at random nodes at the given rate and node 0 produces a block
+ *    of the pending transactions every block interval. Reports block and transaction propagation
+ *    percentiles, compact block cache misses and CPU time per delivered item.
+ *
+ * The topology and the load are drawn from the seed, so runs with the same options are comparable.
+ *
+ * Usage: p2p_network_bench [--nodes N] [--peers K] [--sync-blocks S] [--blocks B]
+ *                          [--block-interval MS] [--tps T] [--seed X]
+ */
+
+#include <graphene/net/node.hpp>
+#include <graphene/net/exceptions.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace graphene::net;
+using bears::protocol::block_header;
+using bears::protocol::block_id_type;
+using bears::protocol::signed_block;
+using bears::protocol::signed_transaction;
+using bears::protocol::transaction_id_type;
+
+class bench_delegate : public node_delegate
+{
+   public:
+      mutable std::mutex                                 mutex;
+      std::vector< signed_block >                        blocks;
+      std::vector< block_id_type >                       block_ids;
+      std::map< transaction_id_type, signed_transaction > transactions;
+
+      std::map< block_id_type, fc::time_point >          block_arrival;
+      std::map< transaction_id_type, fc::time_point >    transaction_arrival;
+      uint64_t                                           items_delivered = 0;
+      uint64_t                                           live_block_transactions = 0;
+
+      uint32_t head_block_num()const
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         return blocks.size();
+      }
+
+      void push_block( const signed_block& b )
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         append( b );
+      }
+
+      void push_transaction( const signed_transaction& trx )
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         transactions[ trx.id() ] = trx;
+      }
+
+      block_id_type head_block_id()const
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         return block_ids.empty() ? block_id_type() : block_ids.back();
+      }
+
+      virtual bears::protocol::chain_id_type get_chain_id()const override
+      {
+         return bears::protocol::chain_id_type();
+      }
+
+      virtual bool has_item( const item_id& id ) override
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         if( id.item_type == block_message_type )
+            return is_known_block( id.item_hash );
+         return transactions.find( id.item_hash ) != transactions.end();
+      }
+
+      virtual bool handle_block( const block_message& blk_msg, bool sync_mode,
+                                 std::vector< fc::uint160_t >& contained_transaction_message_ids ) override
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         ++items_delivered;
+         if( is_known_block( blk_msg.block_id ) )
+            return false;
+
+         block_id_type head = block_ids.empty() ? block_id_type() : block_ids.back();
+         if( blk_msg.block.previous != head )
+            FC_THROW_EXCEPTION( unlinkable_block_exception, "block ${num} does not link to head block ${head}",
+               ("num", blk_msg.block.block_num())("head", blocks.size()) );
+
+         append( blk_msg.block );
+         block_arrival[ blk_msg.block_id ] = fc::time_point::now();
+         if( !sync_mode )
+            live_block_transactions += blk_msg.block.transactions.size();
+         return false;
+      }
+
+      virtual void handle_transaction( const trx_message& trx_msg ) override
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         ++items_delivered;
+         transaction_id_type id = trx_msg.trx.id();
+         FC_ASSERT( transactions.find( id ) == transactions.end(), "duplicate transaction" );
+         transactions[ id ] = trx_msg.trx;
+         transaction_arrival[ id ] = fc::time_point::now();
+      }
+
+      virtual void handle_message( const message& ) override {}
+
+      virtual std::vector< item_hash_t > get_block_ids( const std::vector< item_hash_t >& blockchain_synopsis,
+                                                        uint32_t& remaining_item_count, uint32_t limit ) override
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         std::vector< item_hash_t > result;
+         remaining_item_count = 0;
+         if( blocks.empty() )
+            return result;
+
+         uint32_t last_known = 0;
+         for( auto itr = blockchain_synopsis.rbegin(); itr != blockchain_synopsis.rend(); ++itr )
+         {
+            if( *itr == item_hash_t() || is_known_block( *itr ) )
+            {
+               last_known = block_header::num_from_id( *itr );
+               break;
+            }
+            FC_ASSERT( itr + 1 != blockchain_synopsis.rend(), "peer is on another chain" );
+         }
+
+         for( uint32_t num = std::max< uint32_t >( last_known, 1 ); num <= blocks.size() && result.size() < limit; ++num )
+            result.push_back( block_ids[ num - 1 ] );
+         if( !result.empty() )
+            remaining_item_count = blocks.size() - block_header::num_from_id( result.back() );
+         return result;
+      }
+
+      virtual message get_item( const item_id& id ) override
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         if( id.item_type == block_message_type )
+         {
+            uint32_t num = block_header::num_from_id( id.item_hash );
+            FC_ASSERT( is_known_block( id.item_hash ) );
+            return block_message( blocks[ num - 1 ] );
+         }
+         auto itr = transactions.find( id.item_hash );
+         FC_ASSERT( itr != transactions.end() );
+         return trx_message( itr->second );
+      }
+
+      virtual std::vector< item_hash_t > get_blockchain_synopsis( const item_hash_t& reference_point,
+                                                                  uint32_t number_of_blocks_after_reference_point ) override
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         std::vector< item_hash_t > synopsis;
+         uint32_t high = reference_point == item_hash_t() ? blocks.size() : block_header::num_from_id( reference_point );
+         high = std::min< uint32_t >( high, blocks.size() );
+         if( high == 0 )
+            return synopsis;
+
+         // The chain never forks, so every block from the first one on is summarized
+         uint32_t true_high = high + number_of_blocks_after_reference_point;
+         for( uint32_t low = 1; low <= high; low += ( true_high - low + 2 ) / 2 )
+            synopsis.push_back( block_ids[ low - 1 ] );
+         return synopsis;
+      }
+
+      virtual void sync_status( uint32_t, uint32_t ) override {}
+      virtual void connection_count_changed( uint32_t ) override {}
+
+      virtual uint32_t get_block_number( const item_hash_t& block_id ) override
+      {
+         return block_header::num_from_id( block_id );
+      }
+
+      virtual fc::time_point_sec get_block_time( const item_hash_t& block_id ) override
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         if( block_id == item_hash_t() )
+            return fc::time_point_sec();
+         if( !is_known_block( block_id ) )
+            return fc::time_point_sec::min();
+         return blocks[ block_header::num_from_id( block_id ) - 1 ].timestamp;
+      }
+
+      virtual fc::time_point_sec get_blockchain_now() override { return fc::time_point::now(); }
+
+      virtual item_hash_t get_head_block_id()const override { return head_block_id(); }
+
+      virtual uint32_t estimate_last_known_fork_from_git_revision_timestamp( uint32_t )const override { return 0; }
+
+      virtual void error_encountered( const std::string& message, const fc::oexception& error ) override
+      {
+         std::cerr << message << "\n";
+      }
+
+      virtual uint32_t get_block_log_segment( uint32_t, uint32_t, std::vector< char >&, uint64_t& ) override
+      {
+         return 0;
+      }
+
+      virtual uint32_t handle_block_log_segment( const block_log_segment_message& ) override
+      {
+         FC_THROW( "not serving a block log" );
+      }
+
+   private:
+      bool is_known_block( const item_hash_t& id )const
+      {
+         uint32_t num = block_header::num_from_id( id );
+         return num > 0 && num <= block_ids.size() && block_ids[ num - 1 ] == id;
+      }
+
+      void append( const signed_block& b )
+      {
+         blocks.push_back( b );
+         block_ids.push_back( b.id() );
+         for( const auto& trx : b.transactions )
+            transactions[ trx.id() ] = trx;
+      }
+};
+
+struct bench_node
+{
+   bench_delegate            delegate;
+   std::shared_ptr< node >   p2p;
+   fc::ip::endpoint          endpoint;
+};
+
+struct options
+{
+   uint32_t nodes = 8;
+   uint32_t peers = 3;
+   uint32_t sync_blocks = 2000;
+   uint32_t blocks = 20;
+   uint32_t block_interval_ms = 1000;
+   uint32_t tps = 200;
+   uint32_t seed = 42;
+};
+
+signed_block make_block( const bench_delegate& producer, fc::time_point_sec timestamp, std::vector< signed_transaction > transactions )
+{
+   signed_block b;
+   b.previous = producer.head_block_id();
+   b.timestamp = timestamp;
+   b.witness = "bench";
+   b.transactions = std::move( transactions );
+   b.transaction_merkle_root = b.calculate_merkle_root();
+   return b;
+}
+
+double cpu_seconds()
+{
+   rusage usage;
+   getrusage( RUSAGE_SELF, &usage );
+   return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + ( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec ) / 1e6;
+}
+
+void print_percentiles( const std::string& name, std::vector< int64_t > us, uint64_t expected )
+{
+   std::cout << name << ": " << us.size() << "/" << expected << " delivered";
+   if( !us.empty() )
+   {
+      std::sort( us.begin(), us.end() );
+      auto pct = [&]( double p ) { return us[ std::min< size_t >( us.size() - 1, size_t( p * us.size() ) ) ] / 1000.0; };
+      std::cout << std::fixed << std::setprecision( 2 )
+                << ", ms p50: " << pct( 0.5 ) << " p90: " << pct( 0.9 ) << " p99: " << pct( 0.99 ) << " max: " << us.back() / 1000.0;
+   }
+   std::cout << "\n";
+}
+
+bool wait_for( const std::function< bool() >& done, fc::microseconds timeout )
+{
+   fc::time_point end = fc::time_point::now() + timeout;
+   while( !done() )
+   {
+      if( fc::time_point::now() > end )
+         return false;
+      fc::usleep( fc::milliseconds( 10 ) );
+   }
+   return true;
+}
+
+int main( int argc, char** argv )
+{
+   options opts;
+   for( int i = 1; i + 1 < argc; i += 2 )
+   {
+      std::string name = argv[i];
+      uint32_t value = std::stoul( argv[i + 1] );
+      if( name == "--nodes" )               opts.nodes = std::max< uint32_t >( value, 2 );
+      else if( name == "--peers" )          opts.peers = std::max< uint32_t >( value, 1 );
+      else if( name == "--sync-blocks" )    opts.sync_blocks = value;
+      else if( name == "--blocks" )         opts.blocks = value;
+      else if( name == "--block-interval" ) opts.block_interval_ms = std::max< uint32_t >( value, 1 );
+      else if( name == "--tps" )            opts.tps = value;
+      else if( name == "--seed" )           opts.seed = value;
+      else
+      {
+         std::cerr << "Usage: " << argv[0] << " [--nodes N] [--peers K] [--sync-blocks S] [--blocks B]"
+                   << " [--block-interval MS] [--tps T] [--seed X]\n";
+         return 1;
+      }
+   }
+
+   try
+   {
+      fc::logger::get( DEFAULT_LOGGER ).set_log_level( fc::log_level::error );
+
+      std::mt19937 rng( opts.seed );
+      fc::temp_directory dir( fc::temp_directory_path() );
+      std::vector< std::unique_ptr< bench_node > > nodes;
+
+      // Node 0 starts with the chain the others have to sync, its blocks are a block interval apart in the past
+      bench_node* producer = nullptr;
+      fc::time_point_sec start_time = fc::time_point::now() - fc::milliseconds( int64_t( opts.block_interval_ms ) * ( opts.sync_blocks + 1 ) );
+      for( uint32_t i = 0; i < opts.nodes; ++i )
+      {
+         nodes.emplace_back( new bench_node() );
+         bench_node& n = *nodes.back();
+         if( i == 0 )
+         {
+            producer = &n;
+            for( uint32_t b = 1; b <= opts.sync_blocks; ++b )
+               n.delegate.push_block( make_block( n.delegate, start_time + uint32_t( uint64_t( opts.block_interval_ms ) * b / 1000 ), {} ) );
+         }
+
+         n.p2p = std::make_shared< node >( "p2p_network_bench" );
+         n.p2p->load_configuration( dir.path() / ( "node" + std::to_string( i ) ) );
+         n.p2p->set_node_delegate( &n.delegate );
+         n.p2p->listen_on_endpoint( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ), false );
+
+         fc::mutable_variant_object params;
+         params[ "peer_advertising_disabled" ] = true;
+         params[ "desired_number_of_connections" ] = opts.peers;
+         n.p2p->set_advanced_node_parameters( params );
+         n.p2p->listen_to_p2p_network();
+         n.p2p->connect_to_p2p_network();
+         n.p2p->sync_from( item_id( block_message_type, n.delegate.head_block_id() ), std::vector< uint32_t >() );
+         n.endpoint = n.p2p->get_actual_listening_endpoint();
+      }
+
+      // Every node connects to up to peers random nodes started before it
+      fc::time_point sync_start = fc::time_point::now();
+      double sync_cpu_start = cpu_seconds();
+      for( uint32_t i = 1; i < opts.nodes; ++i )
+      {
+         std::vector< uint32_t > candidates( i );
+         std::iota( candidates.begin(), candidates.end(), 0 );
+         std::shuffle( candidates.begin(), candidates.end(), rng );
+         candidates.resize( std::min< uint32_t >( i, opts.peers ) );
+         for( uint32_t c : candidates )
+         {
+            nodes[i]->p2p->add_node( nodes[c]->endpoint );
+            nodes[i]->p2p->connect_to_endpoint( nodes[c]->endpoint );
+         }
+      }
+
+      bool synced = wait_for( [&]()
+      {
+         for( const auto& n : nodes )
+            if( n->delegate.head_block_num() < opts.sync_blocks )
+               return false;
+         return true;
+      }, fc::seconds( 600 ) );
+      fc::microseconds sync_time = fc::time_point::now() - sync_start;
+
+      std::cout << "nodes: " << opts.nodes << " peers per node: " << opts.peers << " seed: " << opts.seed << "\n";
+      std::cout << std::fixed << std::setprecision( 2 )
+                << "sync: " << opts.sync_blocks << " blocks to " << opts.nodes - 1 << " nodes in " << sync_time.count() / 1e6 << " s"
+                << ( synced ? "" : " (timed out)" )
+                << ", " << ( sync_time.count() ? opts.sync_blocks * 1e6 / sync_time.count() : 0 ) << " blocks/s"
+                << ", cpu " << cpu_seconds() - sync_cpu_start << " s\n";
+
+      // Live phase, transactions spread evenly over each block interval
+      std::map< block_id_type, fc::time_point > block_injected;
+      std::map< transaction_id_type, std::pair< fc::time_point, uint32_t > > transaction_injected;
+      uint64_t delivered_before = 0;
+      for( const auto& n : nodes )
+      {
+         std::lock_guard< std::mutex > lock( n->delegate.mutex );
+         delivered_before += n->delegate.items_delivered;
+      }
+      double live_cpu_start = cpu_seconds();
+
+      uint32_t transactions_per_block = uint64_t( opts.tps ) * opts.block_interval_ms / 1000;
+      uint32_t trx_counter = 0;
+      std::uniform_int_distribution< uint32_t > pick_node( 0, opts.nodes - 1 );
+      for( uint32_t b = 0; b < opts.blocks; ++b )
+      {
+         fc::time_point block_time = fc::time_point::now() + fc::milliseconds( opts.block_interval_ms );
+         std::vector< signed_transaction > pending;
+         for( uint32_t t = 0; t < transactions_per_block; ++t )
+         {
+            signed_transaction trx;
+            trx.ref_block_num = uint16_t( trx_counter );
+            trx.ref_block_prefix = trx_counter++;
+            trx.expiration = fc::time_point_sec( fc::time_point::now() ) + 3600;
+
+            uint32_t origin = pick_node( rng );
+            nodes[ origin ]->delegate.push_transaction( trx );
+            transaction_injected[ trx.id() ] = std::make_pair( fc::time_point::now(), origin );
+            nodes[ origin ]->p2p->broadcast_transaction( trx );
+            pending.push_back( trx );
+
+            fc::time_point next = block_time - fc::milliseconds( int64_t( opts.block_interval_ms ) * ( transactions_per_block - t - 1 ) / transactions_per_block );
+            if( next > fc::time_point::now() )
+               fc::usleep( next - fc::time_point::now() );
+         }
+         if( block_time > fc::time_point::now() )
+            fc::usleep( block_time - fc::time_point::now() );
+
+         signed_block block = make_block( producer->delegate, fc::time_point::now(), std::move( pending ) );
+         producer->delegate.push_block( block );
+         block_injected[ block.id() ] = fc::time_point::now();
+         producer->p2p->broadcast( block_message( block ) );
+      }
+
+      uint32_t final_head = opts.sync_blocks + opts.blocks;
+      wait_for( [&]()
+      {
+         for( const auto& n : nodes )
+            if( n->delegate.head_block_num() < final_head )
+               return false;
+         return true;
+      }, fc::seconds( 10 ) );
+      fc::usleep( fc::seconds( 1 ) );
+      double live_cpu = cpu_seconds() - live_cpu_start;
+
+      std::vector< int64_t > block_latency, transaction_latency;
+      uint64_t delivered = 0, live_block_transactions = 0, compact_blocks_received = 0, compact_transactions_fetched = 0;
+      for( uint32_t i = 0; i < opts.nodes; ++i )
+      {
+         fc::variant_object info = nodes[i]->p2p->network_get_info();
+         compact_blocks_received += info[ "compact_blocks_received" ].as_uint64();
+         compact_transactions_fetched += info[ "compact_block_transactions_fetched" ].as_uint64();
+
+         std::lock_guard< std::mutex > lock( nodes[i]->delegate.mutex );
+         delivered += nodes[i]->delegate.items_delivered;
+         live_block_transactions += nodes[i]->delegate.live_block_transactions;
+         if( i != 0 )
+            for( const auto& injected : block_injected )
+            {
+               auto arrival = nodes[i]->delegate.block_arrival.find( injected.first );
+               if( arrival != nodes[i]->delegate.block_arrival.end() )
+                  block_latency.push_back( ( arrival->second - injected.second ).count() );
+            }
+         for( const auto& injected : transaction_injected )
+         {
+            if( injected.second.second == i )
+               continue;
+            auto arrival = nodes[i]->delegate.transaction_arrival.find( injected.first );
+            if( arrival != nodes[i]->delegate.transaction_arrival.end() )
+               transaction_latency.push_back( ( arrival->second - injected.second.first ).count() );
+         }
+      }
+      delivered -= delivered_before;
+
+      print_percentiles( "block propagation", block_latency, uint64_t( block_injected.size() ) * ( opts.nodes - 1 ) );
+      print_percentiles( "transaction propagation", transaction_latency, uint64_t( transaction_injected.size() ) * ( opts.nodes - 1 ) );
+      std::cout << "compact blocks received: " << compact_blocks_received
+                << ", transactions fetched for them: " << compact_transactions_fetched
+                << " of " << live_block_transactions << " in live blocks"
+                << ", cache hit rate: " << ( live_block_transactions ? 100.0 * ( 1.0 - double( compact_transactions_fetched ) / live_block_transactions ) : 100.0 ) << "%\n";
+      std::cout << "live cpu: " << live_cpu << " s for " << delivered << " delivered items, "
+                << ( delivered ? live_cpu * 1e6 / delivered : 0 ) << " us/item\n";
+
+      for( auto& n : nodes )
+         n->p2p->close();
+      nodes.clear();
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+
+   return 0;
+}
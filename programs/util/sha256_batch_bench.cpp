@@ -0,0 +1,62 @@
+/**
+ * Compares hashing messages one at a time with fc::sha256::hash_batch.
+ *
+ * Usage: sha256_batch_bench [count]
+ *
+ * Hashes count messages (default 100000) of 64 bytes (merkle pairs), 256 and 1024 bytes (typical
+ * transactions) both ways and prints the time taken by each.
+ */
+
+#include <fc/crypto/sha256.hpp>
+#include <fc/time.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main( int argc, char** argv )
+{
+   const uint32_t count = argc > 1 ? std::strtoul( argv[1], nullptr, 10 ) : 100000;
+
+   for( uint32_t size : { 64u, 256u, 1024u } )
+   {
+      std::vector< std::string > data;
+      std::vector< const char* > messages;
+      std::vector< uint32_t >    sizes;
+      for( uint32_t i = 0; i < count; ++i )
+      {
+         std::string m( size, '\0' );
+         for( uint32_t j = 0; j < size; ++j )
+            m[j] = char( i * 31 + j * 7 );
+         data.push_back( std::move( m ) );
+      }
+      for( const auto& m : data )
+      {
+         messages.push_back( m.data() );
+         sizes.push_back( m.size() );
+      }
+
+      std::vector< fc::sha256 > single( count ), batch( count );
+
+      auto start = fc::time_point::now();
+      for( uint32_t i = 0; i < count; ++i )
+         single[i] = fc::sha256::hash( messages[i], sizes[i] );
+      auto single_time = fc::time_point::now() - start;
+
+      start = fc::time_point::now();
+      fc::sha256::hash_batch( messages.data(), sizes.data(), batch.data(), count );
+      auto batch_time = fc::time_point::now() - start;
+
+      if( single != batch )
+      {
+         std::cerr << "sha256 batch of " << size << " byte messages differs from hashing one at a time\n";
+         return 1;
+      }
+
+      std::cout << "sha256 " << count << " x " << size << " bytes: one at a time "
+                << single_time.count() << " us, batch " << batch_time.count() << " us\n";
+   }
+
+   return 0;
+}
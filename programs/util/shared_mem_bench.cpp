@@ -0,0 +1,133 @@
+/**
+ * Measures random index lookups in a chainbase database for each way of mapping the shared memory
+ * file. This only isolates the TLB and cache misses of tree traversals over a large state, it does
+ * not predict replay times. Compare replays with the shared-file-* options of the chain plugin for
+ * that.
+ *
+ * Usage: shared_mem_bench <dir> [objects] [lookups] [flags...]
+ *
+ * The database is created in <dir>. Put <dir> on tmpfs (with shmem huge pages set to advise) or
+ * on hugetlbfs to compare huge pages against regular pages. Each flag is one of huge_pages,
+ * prefault, lock_memory or numa_interleave, every flag given is benchmarked on its own and all
+ * of them together after the plain mapping.
+ */
+
+#include <chainbase/chainbase.hpp>
+
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace boost::multi_index;
+
+struct bench_object : public chainbase::object< 0, bench_object >
+{
+   template< typename Constructor, typename Allocator >
+   bench_object( Constructor&& c, Allocator&& )
+   {
+      c( *this );
+   }
+
+   id_type  id;
+   uint64_t key = 0;
+   uint64_t value = 0;
+};
+
+struct by_key;
+
+typedef multi_index_container<
+   bench_object,
+   indexed_by<
+      ordered_unique< member< bench_object, bench_object::id_type, &bench_object::id > >,
+      ordered_unique< tag< by_key >, member< bench_object, uint64_t, &bench_object::key > >
+   >,
+   chainbase::allocator< bench_object >
+> bench_index;
+
+CHAINBASE_SET_INDEX_TYPE( bench_object, bench_index )
+
+uint32_t parse_flag( const std::string& name )
+{
+   if( name == "huge_pages" )      return chainbase::database::huge_pages;
+   if( name == "prefault" )        return chainbase::database::prefault;
+   if( name == "lock_memory" )     return chainbase::database::lock_memory;
+   if( name == "numa_interleave" ) return chainbase::database::numa_interleave;
+   throw std::runtime_error( "unknown flag " + name );
+}
+
+double run( const boost::filesystem::path& dir, uint32_t flags, uint64_t objects, uint64_t lookups )
+{
+   boost::filesystem::remove_all( dir );
+
+   chainbase::database db;
+   db.open( dir, flags, objects * 128 + 1024*1024*64 );
+   db.add_index< bench_index >();
+
+   std::mt19937_64 rng( 42 );
+   for( uint64_t i = 0; i < objects; ++i )
+      db.create< bench_object >( [&]( bench_object& o )
+      {
+         o.key = i * 2654435761ull;
+         o.value = i;
+      });
+
+   const auto& idx = db.get_index< bench_index, by_key >();
+   uint64_t sum = 0;
+
+   auto start = std::chrono::steady_clock::now();
+   for( uint64_t i = 0; i < lookups; ++i )
+   {
+      auto itr = idx.find( ( rng() % objects ) * 2654435761ull );
+      sum += itr->value;
+   }
+   auto end = std::chrono::steady_clock::now();
+
+   db.close();
+   boost::filesystem::remove_all( dir );
+
+   volatile uint64_t sink = sum;
+   (void)sink;
+   return std::chrono::duration< double, std::nano >( end - start ).count() / lookups;
+}
+
+int main( int argc, char** argv )
+{
+   if( argc < 2 )
+   {
+      std::cerr << "Usage: " << argv[0] << " <dir> [objects] [lookups] [flags...]\n";
+      return 1;
+   }
+
+   try
+   {
+      boost::filesystem::path dir = boost::filesystem::path( argv[1] ) / "shared_mem_bench";
+      uint64_t objects = argc > 2 ? std::stoull( argv[2] ) : 10000000;
+      uint64_t lookups = argc > 3 ? std::stoull( argv[3] ) : 10000000;
+
+      std::vector< std::pair< std::string, uint32_t > > runs = { { "default", 0 } };
+      uint32_t all = 0;
+      for( int i = 4; i < argc; ++i )
+      {
+         runs.emplace_back( argv[i], parse_flag( argv[i] ) );
+         all |= runs.back().second;
+      }
+      if( runs.size() > 2 )
+         runs.emplace_back( "all", all );
+
+      std::cout << "objects: " << objects << " lookups: " << lookups << "\n";
+      for( const auto& r : runs )
+         std::cout << r.first << ": " << run( dir, r.second, objects, lookups ) << " ns/lookup\n";
+   }
+   catch( const std::exception& e )
+   {
+      std::cerr << e.what() << "\n";
+      return 1;
+   }
+
+   return 0;
+}
@@ -47,9 +47,9 @@ BEARS_DEFINE_PLUGIN_EVALUATOR( test_plugin, test_b_operation, test_b );
 
 void test_a_evaluator::do_apply( const test_a_operation& o )
 {
-   const auto& account = db().get_account( o.account );
+   const auto& account = db().get< account_metadata_object, by_account >( o.account );
 
-   db().modify( account, [&]( account_object& a )
+   db().modify( account, [&]( account_metadata_object& a )
    {
       a.json_metadata = "a";
    });
@@ -57,9 +57,9 @@ void test_a_evaluator::do_apply( const test_a_operation& o )
 
 void test_b_evaluator::do_apply( const test_b_operation& o )
 {
-   const auto& account = db().get_account( o.account );
+   const auto& account = db().get< account_metadata_object, by_account >( o.account );
 
-   db().modify( account, [&]( account_object& a )
+   db().modify( account, [&]( account_metadata_object& a )
    {
       a.json_metadata = "b";
    });
@@ -28,6 +28,13 @@
 #include <bears/protocol/protocol.hpp>
 
 #include <bears/protocol/bears_operations.hpp>
+#include <bears/protocol/signed_block_view.hpp>
+#include <bears/protocol/signature_cache.hpp>
+#include <bears/protocol/exceptions.hpp>
+
+#include <bears/chain/comment_content_store.hpp>
+
+#include <bears/utilities/tempdir.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/hex.hpp>
@@ -324,4 +331,223 @@ BOOST_AUTO_TEST_CASE( merkle_root )
    BOOST_CHECK( block.calculate_merkle_root() == c(dO) );
 }
 
+BOOST_AUTO_TEST_CASE( signed_block_view_test )
+{
+   signed_block block;
+   block.previous = block_id_type( "0000000a00000000000000000000000000000000" );
+   block.timestamp = fc::time_point_sec( 1000000 );
+   block.witness = "initminer";
+
+   for( uint32_t i = 0; i < 5; i++ )
+   {
+      signed_transaction tx;
+      tx.ref_block_prefix = i;
+      transfer_operation op;
+      op.from = "alice";
+      op.to = "bob";
+      op.amount = asset( i + 1, BEARS_SYMBOL );
+      tx.operations.push_back( op );
+      tx.signatures.push_back( signature_type() );
+      block.transactions.push_back( tx );
+   }
+   block.transaction_merkle_root = block.calculate_merkle_root();
+
+   signed_block_view view( fc::raw::pack_to_vector( block ) );
+
+   BOOST_REQUIRE_EQUAL( view.block_num(), block.block_num() );
+   BOOST_REQUIRE( view.id() == block.id() );
+   BOOST_REQUIRE( view.header().witness == block.witness );
+   BOOST_REQUIRE_EQUAL( view.transaction_count(), block.transactions.size() );
+   BOOST_REQUIRE( view.calculate_merkle_root() == block.transaction_merkle_root );
+
+   for( uint32_t i = 0; i < view.transaction_count(); i++ )
+   {
+      BOOST_REQUIRE( view.transaction_id( i ) == block.transactions[i].id() );
+      BOOST_REQUIRE( view.transaction_merkle_digest( i ) == block.transactions[i].merkle_digest() );
+      BOOST_REQUIRE( view.transaction( i ).id() == block.transactions[i].id() );
+   }
+
+   BOOST_REQUIRE( view.unpack().id() == block.id() );
+   BOOST_REQUIRE_THROW( view.transaction( view.transaction_count() ), fc::assert_exception );
+
+   signed_block empty;
+   signed_block_view empty_view( fc::raw::pack_to_vector( empty ) );
+   BOOST_REQUIRE_EQUAL( empty_view.transaction_count(), 0 );
+   BOOST_REQUIRE( empty_view.calculate_merkle_root() == checksum_type() );
+   BOOST_REQUIRE( empty_view.id() == empty.id() );
+}
+
+BOOST_AUTO_TEST_CASE( transaction_memoization )
+{
+   signed_transaction tx;
+   tx.ref_block_prefix = 7;
+   tx.set_expiration( fc::time_point_sec( 1000000 ) );
+   transfer_operation op;
+   op.from = "alice";
+   op.to = "bob";
+   op.amount = asset( 100, BEARS_SYMBOL );
+   tx.operations.push_back( op );
+   tx.signatures.push_back( signature_type() );
+
+   const auto id = tx.id();
+   const auto merkle = tx.merkle_digest();
+   const auto sig_digest = tx.sig_digest( BEARS_CHAIN_ID );
+
+   BOOST_REQUIRE( !tx.is_memoized() );
+   tx.memoize( BEARS_CHAIN_ID );
+   BOOST_REQUIRE( tx.is_memoized() );
+
+   BOOST_REQUIRE( tx.id() == id );
+   BOOST_REQUIRE( tx.merkle_digest() == merkle );
+   BOOST_REQUIRE( tx.sig_digest( BEARS_CHAIN_ID ) == sig_digest );
+   BOOST_REQUIRE( tx.sig_digest( chain_id_type() ) != sig_digest );
+   BOOST_REQUIRE( tx.pack() == fc::raw::pack_to_vector( tx ) );
+   BOOST_REQUIRE_EQUAL( tx.packed_size(), fc::raw::pack_size( tx ) );
+
+   // Copies carry the memoized encoding
+   signed_transaction copy = tx;
+   BOOST_REQUIRE( copy.is_memoized() );
+   BOOST_REQUIRE( copy.id() == id );
+
+   // Converting from an unsigned transaction drops it, the signatures are gone
+   signed_transaction unsigned_copy( static_cast< const transaction& >( tx ) );
+   BOOST_REQUIRE( !unsigned_copy.is_memoized() );
+
+   // Mutators invalidate the memoized encoding
+   copy.set_expiration( fc::time_point_sec( 2000000 ) );
+   BOOST_REQUIRE( !copy.is_memoized() );
+   BOOST_REQUIRE( copy.id() != id );
+
+   copy = tx;
+   copy.set_reference_block( block_id_type( "0000000a00000000000000000000000000000000" ) );
+   BOOST_REQUIRE( !copy.is_memoized() );
+   BOOST_REQUIRE( copy.id() != id );
+
+   copy = tx;
+   copy.sign( fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "alice" ) ) ), BEARS_CHAIN_ID, fc::ecc::fc_canonical );
+   BOOST_REQUIRE( !copy.is_memoized() );
+   BOOST_REQUIRE( copy.id() == id );
+   BOOST_REQUIRE( copy.merkle_digest() != merkle );
+
+   copy = tx;
+   copy.operations.push_back( op );
+   copy.invalidate_cache();
+   BOOST_REQUIRE( copy.id() != id );
+   BOOST_REQUIRE( tx.id() == id );
+
+   signed_block block;
+   block.transactions.push_back( copy );
+   block.transactions.push_back( unsigned_copy );
+   const auto root = block.calculate_merkle_root();
+   block.memoize( BEARS_CHAIN_ID );
+   BOOST_REQUIRE( block.transactions[0].is_memoized() && block.transactions[1].is_memoized() );
+   BOOST_REQUIRE( block.calculate_merkle_root() == root );
+}
+
+BOOST_AUTO_TEST_CASE( signature_cache_test )
+{
+   auto& cache = signature_cache::instance();
+   const size_t old_capacity = cache.capacity();
+   cache.set_capacity( 1000 );
+
+   auto alice_key = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "alice" ) ) );
+   auto bob_key = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "bob" ) ) );
+
+   signed_transaction tx;
+   tx.set_expiration( fc::time_point_sec( 1000000 ) );
+   transfer_operation op;
+   op.from = "alice";
+   op.to = "bob";
+   op.amount = asset( 100, BEARS_SYMBOL );
+   tx.operations.push_back( op );
+   tx.sign( alice_key, BEARS_CHAIN_ID, fc::ecc::fc_canonical );
+   tx.sign( bob_key, BEARS_CHAIN_ID, fc::ecc::fc_canonical );
+
+   flat_set< public_key_type > expected;
+   expected.insert( alice_key.get_public_key() );
+   expected.insert( bob_key.get_public_key() );
+
+   auto before = cache.get_stats();
+   BOOST_REQUIRE( tx.get_signature_keys( BEARS_CHAIN_ID, fc::ecc::fc_canonical ) == expected );
+   auto after_miss = cache.get_stats();
+   BOOST_REQUIRE_EQUAL( after_miss.misses - before.misses, 2 );
+   BOOST_REQUIRE_EQUAL( after_miss.hits - before.hits, 0 );
+   BOOST_REQUIRE_EQUAL( after_miss.size, 2 );
+
+   BOOST_REQUIRE( tx.get_signature_keys( BEARS_CHAIN_ID, fc::ecc::fc_canonical ) == expected );
+   auto after_hit = cache.get_stats();
+   BOOST_REQUIRE_EQUAL( after_hit.hits - after_miss.hits, 2 );
+   BOOST_REQUIRE_EQUAL( after_hit.misses, after_miss.misses );
+
+   // Duplicate signatures are still rejected when they are served from the cache
+   signed_transaction dup = tx;
+   dup.signatures.push_back( tx.signatures[0] );
+   BEARS_REQUIRE_THROW( dup.get_signature_keys( BEARS_CHAIN_ID, fc::ecc::fc_canonical ), tx_duplicate_sig );
+
+   // Prefetching a block recovers keys on the recovery threads ahead of the signature check
+   signed_transaction other = tx;
+   other.signatures.clear();
+   other.operations.push_back( op );
+   other.sign( alice_key, BEARS_CHAIN_ID, fc::ecc::fc_canonical );
+
+   fc::ecc::set_recovery_threads( 1 );
+   cache.prefetch( { tx, other }, BEARS_CHAIN_ID );
+   fc::ecc::set_recovery_threads( 0 );
+   BOOST_REQUIRE_EQUAL( cache.get_stats().size, 3 );
+
+   auto before_other = cache.get_stats();
+   BOOST_REQUIRE( *other.get_signature_keys( BEARS_CHAIN_ID, fc::ecc::fc_canonical ).begin() == public_key_type( alice_key.get_public_key() ) );
+   BOOST_REQUIRE_EQUAL( cache.get_stats().hits - before_other.hits, 1 );
+
+   // A capacity of 0 disables the cache
+   cache.set_capacity( 0 );
+   BOOST_REQUIRE( tx.get_signature_keys( BEARS_CHAIN_ID, fc::ecc::fc_canonical ) == expected );
+   BOOST_REQUIRE_EQUAL( cache.get_stats().size, 0 );
+
+   cache.set_capacity( old_capacity );
+}
+
+BOOST_AUTO_TEST_CASE( comment_content_store_test )
+{
+   fc::temp_directory dir( bears::utilities::temp_directory_path() );
+   auto file = dir.path() / "comment_content";
+
+   comment_content first;
+   first.title = "title";
+   first.body = std::string( 100000, 'x' );
+   first.json_metadata = "{\"tags\":[\"test\"]}";
+
+   comment_content second;
+   second.body = "body";
+
+   uint32_t first_size = 0, second_size = 0;
+   uint64_t first_pos = 0, second_pos = 0;
+   {
+      comment_content_store store;
+      store.open( file );
+      BOOST_REQUIRE( store.is_open() );
+
+      first_pos = store.append( first, first_size );
+      second_pos = store.append( second, second_size );
+      BOOST_REQUIRE_EQUAL( first_pos, 0 );
+      BOOST_REQUIRE_EQUAL( second_pos, first_size );
+
+      auto read = store.read( first_pos, first_size );
+      BOOST_REQUIRE( read.title == first.title && read.body == first.body && read.json_metadata == first.json_metadata );
+      BOOST_REQUIRE( store.read( second_pos, second_size ).body == second.body );
+
+      BEARS_REQUIRE_THROW( store.read( second_pos, second_size + 1 ), fc::exception );
+      store.close();
+   }
+
+   // Records survive reopening and new records are appended after them
+   comment_content_store store;
+   store.open( file );
+   BOOST_REQUIRE( store.read( first_pos, first_size ).body == first.body );
+
+   uint32_t third_size = 0;
+   BOOST_REQUIRE_EQUAL( store.append( second, third_size ), second_pos + second_size );
+   BOOST_REQUIRE( store.read( second_pos + second_size, third_size ).body == second.body );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
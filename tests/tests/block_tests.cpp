@@ -354,6 +354,105 @@ BOOST_AUTO_TEST_CASE( duplicate_transactions )
    }
 }
 
+BOOST_AUTO_TEST_CASE( slim_transaction_index )
+{
+   try {
+      fc::temp_directory dir( bears::utilities::temp_directory_path() );
+      database db;
+      db._log_hardforks = false;
+
+      database::open_args args;
+      args.data_dir = dir.path();
+      args.shared_mem_dir = dir.path();
+      args.initial_supply = INITIAL_TEST_SUPPLY;
+      args.shared_file_size = TEST_SHARED_MEM_SIZE;
+      args.slim_transaction_index = true;
+      db.open( args );
+
+      auto skip_sigs = database::skip_transaction_signatures | database::skip_authority_check;
+      auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
+
+      signed_transaction trx;
+      transfer_operation t;
+      t.from = BEARS_INIT_MINER_NAME;
+      t.to = BEARS_TEMP_ACCOUNT;
+      t.amount = asset(500,BEARS_SYMBOL);
+      trx.operations.push_back(t);
+      trx.set_expiration( db.head_block_time() + BEARS_MAX_TIME_UNTIL_EXPIRATION );
+      trx.sign( init_account_priv_key, db.get_chain_id(), fc::ecc::fc_canonical );
+      PUSH_TX( db, trx, skip_sigs );
+
+      const auto& dedupe_index = db.get_index< transaction_index >().indices().get< by_trx_id >();
+      auto itr = dedupe_index.find( trx.id() );
+      BOOST_REQUIRE( itr != dedupe_index.end() );
+      BOOST_REQUIRE( itr->packed_trx.empty() );
+
+      // Served from the pending transactions
+      BOOST_REQUIRE( db.get_recent_transaction( trx.id() ).id() == trx.id() );
+
+      db.generate_block( db.get_slot_time(1), db.get_scheduled_witness( 1 ), init_account_priv_key, skip_sigs );
+      itr = dedupe_index.find( trx.id() );
+      BOOST_REQUIRE( itr != dedupe_index.end() );
+      BOOST_REQUIRE_EQUAL( itr->block_num, db.head_block_num() );
+
+      // Served from the fork database
+      BOOST_REQUIRE( db.get_recent_transaction( trx.id() ).id() == trx.id() );
+      BEARS_CHECK_THROW( PUSH_TX( db, trx, skip_sigs ), fc::exception );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( import_irreversible_blocks )
+{
+   try {
+      fc::temp_directory dir1( bears::utilities::temp_directory_path() ),
+                         dir2( bears::utilities::temp_directory_path() );
+      database db1, db2;
+      db1._log_hardforks = false;
+      open_test_database( db1, dir1.path() );
+      db2._log_hardforks = false;
+      open_test_database( db2, dir2.path() );
+
+      auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
+      while( db1.get_dynamic_global_properties().last_irreversible_block_num < 50 )
+         db1.generate_block( db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing );
+
+      std::vector< char > data;
+      uint64_t first_block_pos;
+      std::vector< signed_block > first_segment;
+      uint32_t next_block_num = 1;
+      while( uint32_t count = db1.read_raw_block_log( next_block_num, 4096, data, first_block_pos ) )
+      {
+         auto blocks = block_log::unpack_raw_blocks( data, first_block_pos );
+         BOOST_REQUIRE_EQUAL( blocks.size(), count );
+         BOOST_REQUIRE_EQUAL( blocks.front().block_num(), next_block_num );
+         if( first_segment.empty() )
+            first_segment = blocks;
+
+         BOOST_REQUIRE_EQUAL( db2.import_irreversible_blocks( blocks ), next_block_num + count - 1 );
+         next_block_num += count;
+      }
+
+      BOOST_REQUIRE( first_segment.size() < next_block_num - 1 );
+      BOOST_REQUIRE_EQUAL( db2.head_block_num(), next_block_num - 1 );
+      BOOST_REQUIRE( db2.head_block_id() == db1.get_block_id_for_num( db2.head_block_num() ) );
+      BOOST_REQUIRE( db2.fetch_block_by_number( db2.head_block_num() ).valid() );
+
+      BOOST_TEST_MESSAGE( "Blocks that do not continue the chain are rejected" );
+      BEARS_REQUIRE_THROW( db2.import_irreversible_blocks( first_segment ), fc::exception );
+
+      BOOST_TEST_MESSAGE( "Reversible blocks are pushed on top of the imported ones" );
+      while( db2.head_block_num() < db1.head_block_num() )
+         db2.push_block( *db1.fetch_block_by_number( db2.head_block_num() + 1 ) );
+      BOOST_REQUIRE( db2.head_block_id() == db1.head_block_id() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( tapos )
 {
    try {
@@ -125,11 +125,12 @@ BOOST_AUTO_TEST_CASE( account_create_apply )
 
       const account_object& acct = db->get_account( "alice" );
       const account_authority_object& acct_auth = db->get< account_authority_object, by_account >( "alice" );
+      const account_metadata_object& acct_meta = db->get< account_metadata_object, by_account >( "alice" );
 
       BOOST_REQUIRE( acct.name == "alice" );
       BOOST_REQUIRE( acct_auth.owner == authority( 1, priv_key.get_public_key(), 1 ) );
       BOOST_REQUIRE( acct_auth.active == authority( 2, priv_key.get_public_key(), 2 ) );
-      BOOST_REQUIRE( acct.memo_key == priv_key.get_public_key() );
+      BOOST_REQUIRE( acct_meta.memo_key == priv_key.get_public_key() );
       BOOST_REQUIRE( acct.proxy == "" );
       BOOST_REQUIRE( acct.created == db->head_block_time() );
       BOOST_REQUIRE( acct.balance.amount.value == ASSET( "0.000 TESTS" ).amount.value );
@@ -148,7 +149,7 @@ BOOST_AUTO_TEST_CASE( account_create_apply )
       BOOST_REQUIRE( acct.name == "alice" );
       BOOST_REQUIRE( acct_auth.owner == authority( 1, priv_key.get_public_key(), 1 ) );
       BOOST_REQUIRE( acct_auth.active == authority( 2, priv_key.get_public_key(), 2 ) );
-      BOOST_REQUIRE( acct.memo_key == priv_key.get_public_key() );
+      BOOST_REQUIRE( acct_meta.memo_key == priv_key.get_public_key() );
       BOOST_REQUIRE( acct.proxy == "" );
       BOOST_REQUIRE( acct.created == db->head_block_time() );
       BOOST_REQUIRE( acct.balance.amount.value == ASSET( "0.000 TESTS " ).amount.value );
@@ -198,7 +199,7 @@ BOOST_AUTO_TEST_CASE( account_create_apply )
       tx.operations.push_back( op );
       db->push_transaction( tx, 0 );
 
-      BOOST_REQUIRE( db->get_account( "bob" ).recovery_account == account_name_type() );
+      BOOST_REQUIRE( db->get< account_metadata_object, by_account >( "bob" ).recovery_account == account_name_type() );
       validate_database();
 
    }
@@ -348,17 +349,18 @@ BOOST_AUTO_TEST_CASE( account_update_apply )
 
       const account_object& acct = db->get_account( "alice" );
       const account_authority_object& acct_auth = db->get< account_authority_object, by_account >( "alice" );
+      const account_metadata_object& acct_meta = db->get< account_metadata_object, by_account >( "alice" );
 
       BOOST_REQUIRE( acct.name == "alice" );
       BOOST_REQUIRE( acct_auth.owner == authority( 1, new_private_key.get_public_key(), 1 ) );
       BOOST_REQUIRE( acct_auth.active == authority( 2, new_private_key.get_public_key(), 2 ) );
-      BOOST_REQUIRE( acct.memo_key == new_private_key.get_public_key() );
+      BOOST_REQUIRE( acct_meta.memo_key == new_private_key.get_public_key() );
 
       /* This is being moved out of consensus
       #ifndef IS_LOW_MEM
-         BOOST_REQUIRE( acct.json_metadata == "{\"bar\":\"foo\"}" );
+         BOOST_REQUIRE( acct_meta.json_metadata == "{\"bar\":\"foo\"}" );
       #else
-         BOOST_REQUIRE( acct.json_metadata == "" );
+         BOOST_REQUIRE( acct_meta.json_metadata == "" );
       #endif
       */
 
@@ -486,6 +488,10 @@ BOOST_AUTO_TEST_CASE( comment_apply )
       BOOST_REQUIRE( alice_comment.net_rshares.value == 0 );
       BOOST_REQUIRE( alice_comment.abs_rshares.value == 0 );
       BOOST_REQUIRE( alice_comment.cashout_time == fc::time_point_sec( db->head_block_time() + fc::seconds( BEARS_CASHOUT_WINDOW_SECONDS ) ) );
+      BOOST_REQUIRE( alice_comment.permlink_hash == comment_permlink_hash( "alice", "lorem" ) );
+      BOOST_REQUIRE( &db->get< comment_object, by_permlink >( boost::make_tuple( "alice", string( "lorem" ) ) ) == &alice_comment );
+      BOOST_REQUIRE( db->find_comment( "alice", string( "lore" ) ) == nullptr );
+      BOOST_REQUIRE( db->find_comment( "bob", string( "lorem" ) ) == nullptr );
 
       #ifndef IS_LOW_MEM
          const auto& alice_comment_content = db->get< comment_content_object, by_comment >( alice_comment.id );
@@ -7506,17 +7512,18 @@ BOOST_AUTO_TEST_CASE( create_claimed_account_apply )
 
       const auto& bob = db->get_account( "bob" );
       const auto& bob_auth = db->get< account_authority_object, by_account >( "bob" );
+      const auto& bob_meta = db->get< account_metadata_object, by_account >( "bob" );
 
       BOOST_REQUIRE( bob.name == "bob" );
       BOOST_REQUIRE( bob_auth.owner == authority( 1, priv_key.get_public_key(), 1 ) );
       BOOST_REQUIRE( bob_auth.active == authority( 2, priv_key.get_public_key(), 2 ) );
       BOOST_REQUIRE( bob_auth.posting == authority( 3, priv_key.get_public_key(), 3 ) );
-      BOOST_REQUIRE( bob.memo_key == priv_key.get_public_key() );
+      BOOST_REQUIRE( bob_meta.memo_key == priv_key.get_public_key() );
 #ifndef IS_LOW_MEM // json_metadata is not stored on low memory nodes
-      BOOST_REQUIRE( bob.json_metadata == "{\"foo\":\"bar\"}" );
+      BOOST_REQUIRE( bob_meta.json_metadata == "{\"foo\":\"bar\"}" );
 #endif
       BOOST_REQUIRE( bob.proxy == "" );
-      BOOST_REQUIRE( bob.recovery_account == "alice" );
+      BOOST_REQUIRE( bob_meta.recovery_account == "alice" );
       BOOST_REQUIRE( bob.created == db->head_block_time() );
       BOOST_REQUIRE( bob.balance.amount.value == ASSET( "0.000 TESTS" ).amount.value );
       BOOST_REQUIRE( bob.bsd_balance.amount.value == ASSET( "0.000 TBD" ).amount.value );
@@ -7551,7 +7558,7 @@ BOOST_AUTO_TEST_CASE( create_claimed_account_apply )
       tx.operations.push_back( op );
       db->push_transaction( tx, 0 );
 
-      BOOST_REQUIRE( db->get_account( "charlie" ).recovery_account == account_name_type() );
+      BOOST_REQUIRE( db->get< account_metadata_object, by_account >( "charlie" ).recovery_account == account_name_type() );
       validate_database();
    }
    FC_LOG_AND_RETHROW()
@@ -0,0 +1,307 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/net/peer_connection.hpp>
+#include <graphene/net/peer_database.hpp>
+#include <graphene/net/message_oriented_connection.hpp>
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/stcp_socket.hpp>
+
+#include <bears/utilities/tempdir.hpp>
+
+#include <fc/crypto/aes.hpp>
+#include <fc/crypto/city.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/json.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace graphene::net;
+
+namespace {
+
+/** Records the messages it is handed and fails on the ones of failing_type */
+struct recording_delegate : public message_oriented_connection_delegate
+{
+   std::vector< uint32_t >  received_types;
+   uint32_t                 failing_type = 0;
+   uint32_t                 expected_messages = 0;
+   fc::thread*              delegate_thread = &fc::thread::current();
+   bool                     called_on_other_thread = false;
+   fc::promise< void >::ptr received = fc::promise< void >::ptr( new fc::promise< void >( "received" ) );
+   fc::promise< void >::ptr closed = fc::promise< void >::ptr( new fc::promise< void >( "closed" ) );
+
+   void on_message( message_oriented_connection*, const message& received_message ) override
+   {
+      called_on_other_thread |= !delegate_thread->is_current();
+      received_types.push_back( received_message.msg_type );
+      if( received_types.size() == expected_messages && !received->ready() )
+         received->set_value();
+      FC_ASSERT( received_message.msg_type != failing_type, "cannot handle this message" );
+   }
+
+   void on_connection_closed( message_oriented_connection* ) override
+   {
+      called_on_other_thread |= !delegate_thread->is_current();
+      if( !closed->ready() )
+         closed->set_value();
+   }
+};
+
+/** A connection reading on its own I/O thread and the plain connection it is talking to */
+struct connection_pair
+{
+   std::shared_ptr< fc::thread >                  io_thread = std::make_shared< fc::thread >( "p2p test io" );
+   recording_delegate                             receiver_delegate;
+   recording_delegate                             sender_delegate;
+   std::shared_ptr< message_oriented_connection > receiver;
+   std::shared_ptr< message_oriented_connection > sender;
+
+   connection_pair()
+   {
+      receiver = std::make_shared< message_oriented_connection >( &receiver_delegate, io_thread );
+      sender = std::make_shared< message_oriented_connection >( &sender_delegate );
+
+      fc::tcp_server listener;
+      listener.listen( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ) );
+      auto accepted = fc::async( [&]()
+      {
+         listener.accept( receiver->get_socket() );
+         receiver->accept();
+      }, "accept" );
+      sender->connect_to( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), listener.get_port() ) );
+      accepted.wait( fc::seconds( 10 ) );
+   }
+
+   ~connection_pair()
+   {
+      sender->destroy_connection( "connection_pair" );
+      receiver->destroy_connection( "connection_pair" );
+      io_thread->quit();
+   }
+};
+
+/** Two encrypted sockets connected to each other, both sides start with the same key */
+struct stcp_pair
+{
+   stcp_socket connecting;
+   stcp_socket accepting;
+
+   stcp_pair()
+   {
+      fc::tcp_server listener;
+      listener.listen( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ) );
+      auto accepted = fc::async( [&]()
+      {
+         listener.accept( accepting.get_socket() );
+         accepting.accept();
+      }, "accept" );
+      connecting.connect_to( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), listener.get_port() ) );
+      accepted.wait( fc::seconds( 10 ) );
+   }
+
+   ~stcp_pair()
+   {
+      connecting.close();
+      accepting.close();
+   }
+};
+
+/** Checks write_framed against copying the header and body into a zero padded buffer and writing that */
+void check_write_framed( const message_header& header, const std::vector< char >& body )
+{
+   size_t len = sizeof( header ) + body.size();
+   size_t len_with_padding = 16 * ( ( len + 15 ) / 16 );
+   std::vector< char > padded( len_with_padding, 0 );
+   memcpy( padded.data(), &header, sizeof( header ) );
+   if( body.size() )
+      memcpy( padded.data() + sizeof( header ), body.data(), body.size() );
+
+   stcp_pair sockets;
+   sockets.connecting.write_framed( (const char*)&header, sizeof( header ), body.data(), body.size() );
+   sockets.connecting.flush();
+   std::vector< char > framed( len_with_padding );
+   sockets.accepting.get_socket().read( framed.data(), framed.size() );
+
+   // The other side has not sent anything yet, so it encrypts with the same starting state
+   sockets.accepting.write( padded.data(), padded.size() );
+   sockets.accepting.flush();
+   std::vector< char > copied( len_with_padding );
+   sockets.connecting.get_socket().read( copied.data(), copied.size() );
+
+   BOOST_CHECK( framed == copied );
+
+   fc::sha512 secret = sockets.connecting.get_shared_secret();
+   fc::aes_decoder decoder;
+   decoder.init( fc::sha256::hash( (char*)&secret, sizeof( secret ) ), fc::city_hash_crc_128( (char*)&secret, sizeof( secret ) ) );
+   std::vector< char > decrypted( len_with_padding );
+   BOOST_REQUIRE_EQUAL( decoder.decode( framed.data(), framed.size(), decrypted.data() ), len_with_padding );
+   BOOST_CHECK( decrypted == padded );
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE( p2p_tests )
+
+BOOST_AUTO_TEST_CASE( io_thread_delivers_in_order )
+{
+   connection_pair connections;
+   connections.receiver_delegate.expected_messages = 3;
+
+   connections.sender->send_message( message( current_time_request_message() ) );
+   connections.sender->send_message( message( address_request_message() ) );
+   connections.sender->send_message( message( current_time_request_message() ) );
+
+   connections.receiver_delegate.received->wait( fc::seconds( 10 ) );
+   BOOST_REQUIRE_EQUAL( connections.receiver_delegate.received_types.size(), 3 );
+   BOOST_CHECK_EQUAL( connections.receiver_delegate.received_types[0], current_time_request_message_type );
+   BOOST_CHECK_EQUAL( connections.receiver_delegate.received_types[1], address_request_message_type );
+   BOOST_CHECK_EQUAL( connections.receiver_delegate.received_types[2], current_time_request_message_type );
+   BOOST_CHECK( !connections.receiver_delegate.called_on_other_thread );
+   BOOST_CHECK( !connections.receiver_delegate.closed->ready() );
+}
+
+BOOST_AUTO_TEST_CASE( failed_message_closes_connection )
+{
+   connection_pair connections;
+   connections.receiver_delegate.failing_type = address_request_message_type;
+
+   // The peer goes quiet after the message that fails, nothing else lets the read loop see the error
+   connections.sender->send_message( message( address_request_message() ) );
+
+   connections.receiver_delegate.closed->wait( fc::seconds( 10 ) );
+   BOOST_REQUIRE_EQUAL( connections.receiver_delegate.received_types.size(), 1 );
+   BOOST_CHECK( !connections.receiver_delegate.called_on_other_thread );
+   connections.sender_delegate.closed->wait( fc::seconds( 10 ) );
+}
+
+BOOST_AUTO_TEST_CASE( write_framed_round_trip )
+{
+   message_header header;
+   header.msg_type = block_message_type;
+
+   // The body ends inside a block and the header straddles into it
+   std::vector< char > body( 37 );
+   for( size_t i = 0; i < body.size(); ++i )
+      body[i] = char( i + 1 );
+   header.size = body.size();
+   check_write_framed( header, body );
+
+   // Whole blocks in the middle of the body, padding after it
+   body.resize( 1001, 'x' );
+   header.size = body.size();
+   check_write_framed( header, body );
+
+   // Header and body end on a block boundary, no padding
+   body.resize( 40 );
+   header.size = body.size();
+   check_write_framed( header, body );
+
+   // Only the header
+   body.clear();
+   header.size = 0;
+   check_write_framed( header, body );
+}
+
+BOOST_AUTO_TEST_CASE( peer_score )
+{
+   // Not measured
+   BOOST_CHECK_EQUAL( compute_peer_score( 0, 10, 0 ), 0 );
+
+   // Without failures the score is the latency
+   BOOST_CHECK_EQUAL( compute_peer_score( 1000, 0, 0 ), 1000 );
+   BOOST_CHECK_EQUAL( compute_peer_score( 1000, 10, 0 ), 1000 );
+
+   // Failing half of the requests is as bad as being twice as slow
+   BOOST_CHECK_CLOSE( compute_peer_score( 1000, 5, 5 ), 2000, 0.0001 );
+   BOOST_CHECK_CLOSE( compute_peer_score( 1000, 3, 1 ), 1000 / 0.75, 0.0001 );
+
+   // Peers that fail everything still rank, at most 10 times their latency
+   BOOST_CHECK_CLOSE( compute_peer_score( 1000, 0, 10 ), 10000, 0.0001 );
+   BOOST_CHECK_CLOSE( compute_peer_score( 1000, 1, 99 ), 10000, 0.0001 );
+}
+
+BOOST_AUTO_TEST_CASE( slow_peer_rotation )
+{
+   double median = 0;
+
+   // Fewer than three peers are never compared
+   BOOST_CHECK_EQUAL( find_slow_peer( {}, median ), -1 );
+   BOOST_CHECK_EQUAL( find_slow_peer( { 100, 10000 }, median ), -1 );
+
+   // A peer exactly at the limit stays
+   BOOST_CHECK_EQUAL( find_slow_peer( { 100, 110, 120, 120 * GRAPHENE_NET_SLOW_PEER_SCORE_FACTOR }, median ), -1 );
+   BOOST_CHECK_EQUAL( median, 120 );
+
+   // The worst peer goes once it is more than the factor times the median, wherever it is
+   BOOST_CHECK_EQUAL( find_slow_peer( { 100, 110, 120, 120 * GRAPHENE_NET_SLOW_PEER_SCORE_FACTOR + 1 }, median ), 3 );
+   BOOST_CHECK_EQUAL( median, 120 );
+   BOOST_CHECK_EQUAL( find_slow_peer( { 1000, 110, 100 }, median ), 0 );
+   BOOST_CHECK_EQUAL( median, 110 );
+
+   // Peers that are all slow are compared with each other
+   BOOST_CHECK_EQUAL( find_slow_peer( { 5000, 6000, 7000, 8000 }, median ), -1 );
+}
+
+BOOST_AUTO_TEST_CASE( peer_database_scores )
+{
+   fc::temp_directory dir( bears::utilities::temp_directory_path() );
+   auto file = dir.path() / "peers.json";
+   fc::ip::endpoint measured_endpoint( fc::ip::address( "10.0.0.1" ), 2001 );
+   fc::ip::endpoint old_endpoint( fc::ip::address( "10.0.0.2" ), 2001 );
+
+   potential_peer_record measured( measured_endpoint, fc::time_point_sec( 1000000 ), last_connection_succeeded );
+   measured.item_latency_us = 25000;
+   measured.sync_block_interval_us = 3000;
+   measured.number_of_items_received = 40;
+   measured.number_of_item_requests_failed = 2;
+
+   // A record written before the scores were saved has none of their fields
+   fc::mutable_variant_object old_record( fc::variant( potential_peer_record( old_endpoint, fc::time_point_sec( 1000000 ), last_connection_succeeded ) ).get_object() );
+   old_record.erase( "item_latency_us" );
+   old_record.erase( "sync_block_interval_us" );
+   old_record.erase( "number_of_items_received" );
+   old_record.erase( "number_of_item_requests_failed" );
+   fc::json::save_to_file( std::vector< fc::variant >{ fc::variant( measured ), fc::variant( old_record ) }, file );
+
+   {
+      peer_database db;
+      db.open( file );
+      BOOST_REQUIRE_EQUAL( db.size(), 2 );
+
+      auto loaded = db.lookup_entry_for_endpoint( measured_endpoint );
+      BOOST_REQUIRE( loaded.valid() );
+      BOOST_CHECK_EQUAL( loaded->item_latency_us, 25000 );
+      BOOST_CHECK_EQUAL( loaded->sync_block_interval_us, 3000 );
+      BOOST_CHECK_EQUAL( loaded->number_of_items_received, 40 );
+      BOOST_CHECK_EQUAL( loaded->number_of_item_requests_failed, 2 );
+
+      auto old = db.lookup_entry_for_endpoint( old_endpoint );
+      BOOST_REQUIRE( old.valid() );
+      BOOST_CHECK_EQUAL( old->item_latency_us, 0 );
+      BOOST_CHECK_EQUAL( old->sync_block_interval_us, 0 );
+      BOOST_CHECK_EQUAL( old->number_of_items_received, 0 );
+      BOOST_CHECK_EQUAL( old->number_of_item_requests_failed, 0 );
+      BOOST_CHECK_EQUAL( compute_peer_score( old->item_latency_us, old->number_of_items_received, old->number_of_item_requests_failed ), 0 );
+
+      old->item_latency_us = 50000;
+      old->number_of_items_received = 7;
+      db.update_entry( *old );
+      db.close();
+   }
+
+   // Closing writes the fields back
+   peer_database db;
+   db.open( file );
+   auto reloaded = db.lookup_entry_for_endpoint( old_endpoint );
+   BOOST_REQUIRE( reloaded.valid() );
+   BOOST_CHECK_EQUAL( reloaded->item_latency_us, 50000 );
+   BOOST_CHECK_EQUAL( reloaded->number_of_items_received, 7 );
+   BOOST_CHECK_EQUAL( db.lookup_entry_for_endpoint( measured_endpoint )->number_of_items_received, 40 );
+   db.close();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
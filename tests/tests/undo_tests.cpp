@@ -484,5 +484,85 @@ BOOST_AUTO_TEST_CASE( undo_generate_blocks )
    FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( undo_delta_members )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "--- Testing: undo_delta_members" );
+
+      BOOST_REQUIRE( chainbase::use_delta_undo< witness_object >::value );
+#ifndef BEARS_ENABLE_SMT
+      BOOST_REQUIRE( chainbase::use_delta_undo< comment_object >::value );
+#endif
+
+      undo_db udb( *db );
+      undo_scenario< witness_object > wo( *db );
+      undo_scenario< comment_object > co( *db );
+
+      const witness_object& witness = wo.create( [&]( witness_object& w )
+      {
+         w.owner = "witness00";
+         from_string( w.url, "url00" );
+         w.total_missed = 1;
+      } );
+      const comment_object& comment = co.create( [&]( comment_object& c )
+      {
+         c.author = "author00";
+         from_string( c.permlink, "permlink00" );
+         from_string( c.category, "category00" );
+         c.children = 2;
+         c.beneficiaries.push_back( beneficiary_route_type( "bene00", 100 ) );
+      } );
+
+      BOOST_TEST_MESSAGE( "--- Modifying strings, vectors and the rest of the objects" );
+      udb.undo_begin();
+
+      wo.modify( witness, [&]( witness_object& w ){ w.total_missed = 3; } );
+      wo.modify( witness, [&]( witness_object& w ){ from_string( w.url, "a url that does not fit in the string itself" ); } );
+      co.modify( comment, [&]( comment_object& c )
+      {
+         from_string( c.permlink, "permlink01" );
+         c.children = 4;
+         c.beneficiaries.push_back( beneficiary_route_type( "bene01", 200 ) );
+      } );
+      co.modify( comment, [&]( comment_object& c ){ from_string( c.category, "category01" ); c.author = "author01"; } );
+
+      BOOST_REQUIRE( to_string( witness.url ) == "a url that does not fit in the string itself" );
+      BOOST_REQUIRE( witness.total_missed == 3 );
+      BOOST_REQUIRE( to_string( comment.permlink ) == "permlink01" );
+      BOOST_REQUIRE( comment.beneficiaries.size() == 2 );
+      BOOST_REQUIRE( ( db->find< comment_object, by_permlink >( boost::make_tuple( account_name_type( "author01" ), string( "permlink01" ) ) ) == &comment ) );
+
+      udb.undo_end();
+
+      BOOST_REQUIRE( witness.owner == "witness00" );
+      BOOST_REQUIRE( to_string( witness.url ) == "url00" );
+      BOOST_REQUIRE( witness.total_missed == 1 );
+      BOOST_REQUIRE( comment.author == "author00" );
+      BOOST_REQUIRE( to_string( comment.permlink ) == "permlink00" );
+      BOOST_REQUIRE( to_string( comment.category ) == "category00" );
+      BOOST_REQUIRE( comment.children == 2 );
+      BOOST_REQUIRE( comment.beneficiaries.size() == 1 );
+      BOOST_REQUIRE( comment.beneficiaries[0].account == "bene00" );
+      BOOST_REQUIRE( comment.beneficiaries[0].weight == 100 );
+      BOOST_REQUIRE( ( db->find< comment_object, by_permlink >( boost::make_tuple( account_name_type( "author00" ), string( "permlink00" ) ) ) == &comment ) );
+      BOOST_REQUIRE( ( db->find< comment_object, by_permlink >( boost::make_tuple( account_name_type( "author01" ), string( "permlink01" ) ) ) == nullptr ) );
+
+      BOOST_TEST_MESSAGE( "--- Removing a modified object" );
+      udb.undo_begin();
+
+      wo.modify( witness, [&]( witness_object& w ){ from_string( w.url, "url01" ); w.total_missed = 5; } );
+      wo.remove( witness );
+      BOOST_REQUIRE( ( db->find< witness_object, by_name >( "witness00" ) == nullptr ) );
+
+      udb.undo_end();
+
+      const witness_object& restored = db->get< witness_object, by_name >( "witness00" );
+      BOOST_REQUIRE( to_string( restored.url ) == "url00" );
+      BOOST_REQUIRE( restored.total_missed == 1 );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif